@@ -0,0 +1,79 @@
+#pragma once
+
+#include "lomegl/gl_atom.h"
+#include "lomegl/gl_base.h"
+#include "lomegl/gl_fwd.h"
+#include "lomegl/gl_handle.h"
+#include "lomegl/gl_utility.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lomegl {
+
+// Load assets without blocking the render thread: files are read and decoded by worker threads,
+// then `update` stages the pixels in a pixel unpack buffer and uploads them within a time budget per frame.
+// Except the returned futures, everything must be used on the thread owning the OpenGL context of the world.
+class gl_asset_loader
+{
+public:
+    explicit gl_asset_loader(gl_world& world, std::size_t worker_count = 2);
+    // Jobs not finished yet are dropped, their futures report `std::future_errc::broken_promise`
+    ~gl_asset_loader();
+    gl_asset_loader(const gl_asset_loader&) = delete;
+    gl_asset_loader(gl_asset_loader&&) = delete;
+    gl_asset_loader& operator=(const gl_asset_loader&) = delete;
+    gl_asset_loader& operator=(gl_asset_loader&&) = delete;
+
+    // Create a 2D texture named `name` at once, holding a 1x1 grey placeholder so it can be referenced right away.
+    // The decoded image replaces it in a later `update`(mipmaps are generated), then `on_ready` is called.
+    // If the file can't be decoded the placeholder is kept, and the future throws.
+    std::shared_future<gl_handle<gl_texture>> load_texture(gl_name name, std::string path,
+        std::function<void(gl_texture&)> on_ready = {}, bool flip_vertically = true);
+    // Read a text file on a worker, e.g. shader sources
+    std::future<std::string> load_text(std::string path);
+
+    // Upload decoded images until `budget` is spent, at least one is uploaded if any is ready. Call it once per frame.
+    gl_asset_loader& update(std::chrono::microseconds budget = std::chrono::microseconds(2000));
+
+    // Textures requested but not uploaded yet
+    [[nodiscard]] std::size_t pending_count() const noexcept;
+
+private:
+    struct texture_job_
+    {
+        gl_handle<gl_texture> handle;
+        std::string path;
+        bool flip_vertically;
+        std::function<void(gl_texture&)> on_ready;
+        std::promise<gl_handle<gl_texture>> promise;
+        std::unique_ptr<image_data> image;
+        std::exception_ptr error;
+    };
+
+    void worker_loop_();
+    void upload_(texture_job_& job);
+
+    gl_world* world_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void()>> jobs_;            // run by the workers
+    std::deque<std::shared_ptr<texture_job_>> decoded_; // waiting for the upload
+    bool stop_ = false;
+    std::size_t pending_ = 0;  // only used on the GL thread
+    unique_vbo unpack_buffer_; // created on first upload
+    GLsizeiptr unpack_capacity_ = 0;
+};
+
+} // namespace lomegl
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace lomegl {
+
+// 32-bit FNV-1a, constexpr so literal names can be hashed at compile time
+constexpr std::uint32_t fnv1a_32(std::string_view str) noexcept
+{
+    std::uint32_t hash = 2166136261U;
+    for (char item : str)
+    {
+        hash ^= static_cast<unsigned char>(item);
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+// A null-terminated name with its precomputed hash.
+// Declare it `constexpr` to hash a literal name at compile time.
+struct gl_name
+{
+    constexpr gl_name(const char* name_str) noexcept // NOLINT(google-explicit-constructor)
+        : str(name_str), hash(fnv1a_32(name_str))
+    {
+    }
+
+    constexpr operator const char*() const noexcept // NOLINT(google-explicit-constructor)
+    {
+        return str;
+    }
+
+    [[nodiscard]] constexpr std::string_view view() const noexcept
+    {
+        return str;
+    }
+
+    const char* str;
+    std::uint32_t hash;
+};
+
+// Global table that interns names to 32-bit atoms, the same name always gets the same atom.
+// Atom 0 is the empty name. The table is thread safe, and the interned names live until the program exits.
+class gl_atom_table
+{
+public:
+    static constexpr std::uint32_t invalid_atom = 0xFFFFFFFFU;
+
+    static std::uint32_t intern(std::string_view name)
+    {
+        return intern(name, fnv1a_32(name));
+    }
+
+    static std::uint32_t intern(gl_name name)
+    {
+        return intern(name.view(), name.hash);
+    }
+
+    static std::uint32_t intern(const char* name)
+    {
+        return intern(gl_name(name));
+    }
+
+    // `hash` must equal to `fnv1a_32(name)`
+    static std::uint32_t intern(std::string_view name, std::uint32_t hash);
+
+    // Return `invalid_atom` if the name has never been interned
+    [[nodiscard]] static std::uint32_t find(std::string_view name) noexcept
+    {
+        return find(name, fnv1a_32(name));
+    }
+
+    [[nodiscard]] static std::uint32_t find(gl_name name) noexcept
+    {
+        return find(name.view(), name.hash);
+    }
+
+    [[nodiscard]] static std::uint32_t find(const char* name) noexcept
+    {
+        return find(gl_name(name));
+    }
+
+    [[nodiscard]] static std::uint32_t find(std::string_view name, std::uint32_t hash) noexcept;
+    [[nodiscard]] static const std::string& name_of(std::uint32_t atom) noexcept;
+    [[nodiscard]] static std::uint32_t hash_of(std::uint32_t atom) noexcept;
+};
+
+} // namespace lomegl
@@ -1,12 +1,18 @@
 #pragma once
 #include <glad/glad.h>
 
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 
 #include <lotools/raii_control.h>
 
+#include "lomegl/gl_atom.h"
+
 namespace lomegl {
 
 // using gl_val = lot::unique_val<unsigned int, std::function<void(unsigned int&)>>;
@@ -20,17 +26,87 @@ enum class gl_val_type
     fragment_shader, // 2
     geometry_shader, // 2
     program,         // 3
-    texture          // 4
+    texture,         // 4
+    query            // 5
+};
+
+class gl_name_owner;
+
+// The world current on the calling thread, which owns the names created now. nullptr without a current world.
+[[nodiscard]] std::shared_ptr<gl_name_owner> gl_current_name_owner();
+// Delete an OpenGL name through the deletion queue of the world which created it(`owner`), see `gl_deletion_queue`.
+// A name created without a current world is deleted at once.
+void gl_delete_val(gl_val_type type, unsigned int val, const std::shared_ptr<gl_name_owner>& owner);
+
+// An OpenGL name deleted by `gl_delete_val` when destroyed or reset, unless it's released
+template <gl_val_type val_type>
+class gl_unique_val
+{
+public:
+    gl_unique_val() = default;
+    gl_unique_val(unsigned int val) : val_(val), own_(true), owner_(gl_current_name_owner()) { } // NOLINT(google-explicit-constructor)
+    ~gl_unique_val()
+    {
+        reset();
+    }
+    gl_unique_val(const gl_unique_val&) = delete;
+    gl_unique_val(gl_unique_val&& other) noexcept : val_(other.val_), own_(std::exchange(other.own_, false)), owner_(std::move(other.owner_)) { }
+    gl_unique_val& operator=(const gl_unique_val&) = delete;
+    gl_unique_val& operator=(gl_unique_val&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            val_ = other.val_;
+            own_ = std::exchange(other.own_, false);
+            owner_ = std::move(other.owner_);
+        }
+        return *this;
+    }
+
+    [[nodiscard]] unsigned int& get() noexcept
+    {
+        return val_;
+    }
+    [[nodiscard]] const unsigned int& get() const noexcept
+    {
+        return val_;
+    }
+    // Stop owning the name, the value is kept
+    void release() noexcept
+    {
+        own_ = false;
+        owner_.reset();
+    }
+    void reset()
+    {
+        if (own_)
+            gl_delete_val(val_type, val_, owner_);
+        own_ = false;
+        owner_.reset();
+    }
+
+private:
+    unsigned int val_ = 0;
+    bool own_ = false;
+    std::shared_ptr<gl_name_owner> owner_;
 };
 
-using unique_vao = lot::fn_unique_val<unsigned int, [](unsigned int& index) { glDeleteVertexArrays(1, &index); }>;
-using unique_vbo = lot::fn_unique_val<unsigned int, [](unsigned int& index) { glDeleteBuffers(1, &index); }>;
+// Direct State Access(GL 4.5): objects are created with glCreate* and edited without being bound, so setting up
+// a resource doesn't clobber the bindings used by drawing. It's used when the context supports it, disable it to
+// force the bind-to-edit path of GL 3.3. A resource keeps the path it was created with.
+void set_dsa_enabled(bool enable) noexcept;
+[[nodiscard]] bool is_dsa_enabled() noexcept;
+
+using unique_vao = gl_unique_val<gl_val_type::vao>;
+using unique_vbo = gl_unique_val<gl_val_type::vbo>;
 using unique_ebo = unique_vbo;
-using unique_vertex_shader = lot::fn_unique_val<unsigned int, [](unsigned int& index) { glDeleteShader(index); }>;
+using unique_vertex_shader = gl_unique_val<gl_val_type::vertex_shader>;
 using unique_fragment_shader = unique_vertex_shader;
 using unique_geometry_shader = unique_vertex_shader;
-using unique_program = lot::fn_unique_val<unsigned int, [](unsigned int& index) { glDeleteProgram(index); }>;
-using unique_texture = lot::fn_unique_val<unsigned int, [](unsigned int& index) { glDeleteTextures(1, &index); }>;
+using unique_program = gl_unique_val<gl_val_type::program>;
+using unique_texture = gl_unique_val<gl_val_type::texture>;
+using unique_query = gl_unique_val<gl_val_type::query>;
 
 template <gl_val_type val_type>
 auto gl_val_factory(unsigned int val)
@@ -60,6 +136,9 @@ auto gl_val_factory(unsigned int val)
     } else if constexpr (val_type == texture)
     {
         return unique_texture { val };
+    } else if constexpr (val_type == query)
+    {
+        return unique_query { val };
     }
 }
 
@@ -70,10 +149,16 @@ auto gl_val_factory()
     using enum gl_val_type;
     if constexpr (val_type == vao)
     {
-        glGenVertexArrays(1, &val);
+        if (is_dsa_enabled())
+            glCreateVertexArrays(1, &val);
+        else
+            glGenVertexArrays(1, &val);
     } else if constexpr (val_type == vbo || val_type == ebo)
     {
-        glGenBuffers(1, &val);
+        if (is_dsa_enabled())
+            glCreateBuffers(1, &val);
+        else
+            glGenBuffers(1, &val);
     } else if constexpr (val_type == vertex_shader)
     {
         val = glCreateShader(GL_VERTEX_SHADER);
@@ -89,29 +174,45 @@ auto gl_val_factory()
     } else if constexpr (val_type == texture)
     {
         glGenTextures(1, &val);
+    } else if constexpr (val_type == query)
+    {
+        glGenQueries(1, &val);
     }
     return gl_val_factory<val_type>(val);
 }
 
+// The name of a resource, stored as an interned atom with its precomputed hash
 class string_id
 {
     friend class gl_world;
 
 public:
     string_id() = default;
-    string_id(std::string sid) : sid_(std::move(sid)) { }
+    string_id(std::string_view sid) : atom_(gl_atom_table::intern(sid)), hash_(fnv1a_32(sid)) { }
 
     [[nodiscard]] const std::string& get_id() const noexcept
     {
-        return sid_;
+        return gl_atom_table::name_of(atom_);
+    }
+
+    [[nodiscard]] std::uint32_t get_atom() const noexcept
+    {
+        return atom_;
+    }
+
+    [[nodiscard]] std::uint32_t get_hash() const noexcept
+    {
+        return hash_;
     }
 
 private:
-    void set_id(const std::string& sid) noexcept
+    void set_id(std::uint32_t atom) noexcept
     {
-        sid_ = sid;
+        atom_ = atom;
+        hash_ = gl_atom_table::hash_of(atom);
     }
-    std::string sid_;
+    std::uint32_t atom_ = 0;
+    std::uint32_t hash_ = fnv1a_32(std::string_view {});
 };
 
 } // namespace lomegl
\ No newline at end of file
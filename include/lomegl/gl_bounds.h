@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace lomegl {
+
+// Axis aligned bounding box, empty if min > max
+struct gl_aabb
+{
+    glm::vec3 min { std::numeric_limits<float>::max() };
+    glm::vec3 max { std::numeric_limits<float>::lowest() };
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    [[nodiscard]] glm::vec3 center() const noexcept
+    {
+        return (min + max) * 0.5F;
+    }
+
+    [[nodiscard]] glm::vec3 extent() const noexcept
+    {
+        return (max - min) * 0.5F;
+    }
+
+    [[nodiscard]] float surface_area() const noexcept
+    {
+        auto size = max - min;
+        return 2.0F * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    gl_aabb& merge(const glm::vec3& point) noexcept;
+    gl_aabb& merge(const gl_aabb& other) noexcept;
+    [[nodiscard]] bool overlaps(const gl_aabb& other) const noexcept;
+    // The box which contains this box transformed by `mat`
+    [[nodiscard]] gl_aabb transform(const glm::mat4& mat) const noexcept;
+};
+
+struct gl_sphere
+{
+    glm::vec3 center { 0.0F };
+    float radius = -1.0F; // negative means empty
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return radius < 0.0F;
+    }
+
+    // The sphere transformed by `mat`, the radius is scaled by the largest axis scale
+    [[nodiscard]] gl_sphere transform(const glm::mat4& mat) const noexcept;
+};
+
+// Local bounds of a mesh
+struct gl_bounds
+{
+    gl_aabb box;
+    gl_sphere sphere;
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return box.empty();
+    }
+
+    // Read vec3 positions at the beginning of every `stride` bytes
+    [[nodiscard]] static gl_bounds from_positions(const void* data, std::uint32_t count, GLsizei stride) noexcept;
+    [[nodiscard]] static gl_bounds from_aabb(const gl_aabb& box) noexcept;
+};
+
+// Six planes (ax + by + cz + d >= 0 is inside) extracted from a view-projection matrix
+class gl_frustum
+{
+public:
+    gl_frustum() = default;
+    explicit gl_frustum(const glm::mat4& view_projection) noexcept;
+
+    [[nodiscard]] bool intersects(const gl_sphere& sphere) const noexcept;
+    [[nodiscard]] bool intersects(const gl_aabb& box) const noexcept;
+
+    // Test `count` packed spheres, visible[i] is set to 1 if sphere i intersects the frustum, 0 otherwise.
+    // 4 spheres are tested at once with SSE where available.
+    void cull_spheres(const float* center_x, const float* center_y, const float* center_z, const float* radius,
+        std::uint32_t count, std::uint8_t* visible) const noexcept;
+
+    [[nodiscard]] const std::array<glm::vec4, 6>& get_planes() const noexcept
+    {
+        return planes_;
+    }
+
+private:
+    std::array<glm::vec4, 6> planes_ {}; // left, right, bottom, top, near, far
+};
+
+} // namespace lomegl
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "lomegl/gl_bounds.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace lomegl {
+
+// Bounding volume hierarchy over boxes identified by a uint32 id.
+// `build` makes a binned SAH tree, `refit` keeps the topology and only updates the boxes, which is cheaper for moving items
+// but the quality drops if they move far, rebuild it from time to time then.
+class gl_bvh
+{
+public:
+    static constexpr std::uint32_t npos = 0xFFFFFFFFU;
+    static constexpr std::uint32_t max_leaf_size = 4;
+
+    gl_bvh() = default;
+
+    // `ids` and `boxes` must have the same size
+    void build(std::vector<std::uint32_t> ids, std::vector<gl_aabb> boxes);
+    void clear() noexcept;
+
+    // Update the boxes with `get_box(id) -> gl_aabb`, then the nodes bottom-up
+    template <typename Func>
+    void refit(Func&& get_box)
+    {
+        for (std::size_t i = 0; i < ids_.size(); ++i)
+            boxes_[i] = get_box(ids_[i]);
+        refit_nodes_();
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return ids_.size();
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return ids_.empty();
+    }
+
+    [[nodiscard]] gl_aabb get_bounds() const noexcept
+    {
+        return nodes_.empty() ? gl_aabb {} : nodes_.front().box;
+    }
+
+    // Call `func(id)` for every box overlapping `box`
+    template <typename Func>
+    void query(const gl_aabb& box, Func&& func) const
+    {
+        traverse_([&](const gl_aabb& node_box) { return node_box.overlaps(box); }, func);
+    }
+
+    // Call `func(id)` for every box intersecting `frustum`
+    template <typename Func>
+    void query(const gl_frustum& frustum, Func&& func) const
+    {
+        traverse_([&](const gl_aabb& node_box) { return frustum.intersects(node_box); }, func);
+    }
+
+    // The nearest box hit by the ray in [0, max_distance], `direction` doesn't need to be normalized.
+    // Return the id and the distance in units of `direction`, id is npos if nothing is hit.
+    [[nodiscard]] std::pair<std::uint32_t, float> raycast(const glm::vec3& origin, const glm::vec3& direction,
+        float max_distance = std::numeric_limits<float>::max()) const noexcept;
+
+private:
+    // Leaf if count != 0, items are [first, first + count), otherwise the children are first and first + 1
+    struct node_
+    {
+        gl_aabb box;
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    template <typename Test, typename Func>
+    void traverse_(Test&& test, Func&& func) const
+    {
+        if (nodes_.empty())
+            return;
+
+        std::uint32_t stack[64];
+        std::uint32_t top = 0;
+        stack[top++] = 0;
+        while (top != 0)
+        {
+            const auto& node = nodes_[stack[--top]];
+            if (!test(node.box))
+                continue;
+
+            if (node.count != 0)
+            {
+                for (auto i = node.first; i < node.first + node.count; ++i)
+                {
+                    if (test(boxes_[i]))
+                        func(ids_[i]);
+                }
+            } else {
+                stack[top++] = node.first;
+                stack[top++] = node.first + 1;
+            }
+        }
+    }
+
+    void build_node_(std::uint32_t node_index, std::uint32_t first, std::uint32_t count, std::uint32_t depth);
+    void refit_nodes_() noexcept;
+
+    std::vector<node_> nodes_; // children are always after their parent
+    std::vector<std::uint32_t> ids_;
+    std::vector<gl_aabb> boxes_;
+    std::vector<glm::vec3> centers_; // only used by build
+};
+
+} // namespace lomegl
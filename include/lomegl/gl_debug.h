@@ -0,0 +1,99 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace lomegl {
+
+struct gl_debug_message
+{
+    GLenum source = 0;
+    GLenum type = 0;
+    GLuint id = 0;
+    GLenum severity = 0;
+    std::array<char, 256> text {}; // truncated, null terminated
+
+    [[nodiscard]] std::string_view get_text() const noexcept;
+};
+
+// OpenGL debug output, an alternative to polling glGetError(needs GL 4.3).
+// The driver calls back into a lock-free ring buffer, which is drained on any thread with `pop` or `check_errors`.
+// Once installed, `set_gl_error_policy(gl_error_policy::off)` drops the glGetError calls of `lomeglcall`.
+// Request a debug context(the GLFW_OPENGL_DEBUG_CONTEXT hint) to get every message, other contexts may report nothing.
+class gl_debug_output
+{
+public:
+    // `capacity` is rounded up to a power of 2, messages are dropped while the buffer is full
+    explicit gl_debug_output(std::size_t capacity = 1024);
+    // Uninstall the callback, so it must be destroyed while the context is alive
+    ~gl_debug_output();
+    gl_debug_output(const gl_debug_output&) = delete;
+    gl_debug_output(gl_debug_output&&) = delete;
+    gl_debug_output& operator=(const gl_debug_output&) = delete;
+    gl_debug_output& operator=(gl_debug_output&&) = delete;
+
+    [[nodiscard]] static bool is_supported() noexcept;
+
+    // Register the callback to the current context and enable GL_DEBUG_OUTPUT, return false if it's not supported.
+    // A synchronous output calls back on the thread of the failing call before it returns, that's easier to debug
+    // but slower. Notification messages are filtered out, see `set_filter`.
+    bool install(bool synchronous = false);
+    // The debug output is only disabled if the callback of the context is still this one
+    gl_debug_output& uninstall() noexcept;
+    [[nodiscard]] bool is_installed() const noexcept;
+
+    // Enable or disable the messages of a source and a severity in the driver, GL_DONT_CARE matches any of them
+    gl_debug_output& set_filter(GLenum source, GLenum severity, bool enable);
+
+    // Take the oldest message, return false if there is none. Thread safe.
+    bool pop(gl_debug_message& message) noexcept;
+    // Take every message and throw a `gl_error` listing those of type GL_DEBUG_TYPE_ERROR, others are discarded
+    void check_errors();
+    // Messages lost because the buffer was full
+    [[nodiscard]] std::size_t get_dropped_count() const noexcept;
+
+private:
+    struct slot_
+    {
+        std::atomic<std::size_t> sequence = 0;
+        gl_debug_message message;
+    };
+
+    static void APIENTRY callback_(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+        const GLchar* message, const void* user_param);
+    void push_(GLenum source, GLenum type, GLuint id, GLenum severity, std::string_view text) noexcept;
+
+    std::unique_ptr<slot_[]> slots_; // NOLINT(cppcoreguidelines-avoid-c-arrays)
+    std::size_t mask_ = 0;
+    std::atomic<std::size_t> write_pos_ = 0;
+    std::atomic<std::size_t> read_pos_ = 0;
+    std::atomic<std::size_t> dropped_ = 0;
+    bool installed_ = false;
+};
+
+// Name a section of GL commands for debuggers and profilers, with glPushDebugGroup/glPopDebugGroup.
+// Does nothing without GL 4.3.
+class gl_debug_group
+{
+public:
+    explicit gl_debug_group(std::string_view name);
+    ~gl_debug_group();
+    gl_debug_group(const gl_debug_group&) = delete;
+    gl_debug_group(gl_debug_group&&) = delete;
+    gl_debug_group& operator=(const gl_debug_group&) = delete;
+    gl_debug_group& operator=(gl_debug_group&&) = delete;
+
+private:
+    bool pushed_ = false;
+};
+
+// Attach a label to an OpenGL object with glObjectLabel, `identifier` is GL_TEXTURE, GL_BUFFER...
+// The object must exist, names from glGen* only become objects when they're bound for the first time.
+// Does nothing if `label` is empty or without GL 4.3.
+void gl_object_label(GLenum identifier, GLuint name, std::string_view label);
+
+} // namespace lomegl
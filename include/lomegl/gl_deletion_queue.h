@@ -0,0 +1,89 @@
+#pragma once
+#include "lomegl/gl_base.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lomegl {
+
+class gl_deletion_queue;
+class gl_state_cache;
+
+// The world which created a name, shared by the names and the deletion queue of the world
+class gl_name_owner
+{
+    friend class gl_deletion_queue;
+    friend void gl_delete_val(gl_val_type type, unsigned int val, const std::shared_ptr<gl_name_owner>& owner);
+
+    std::mutex mutex_;
+    gl_deletion_queue* queue_ = nullptr; // nullptr once the world is destroyed, guarded by the mutex
+};
+
+// OpenGL names waiting to be deleted in batches at a frame boundary.
+// The deleters of `unique_vao`, `unique_texture`... send their names to the queue of the world which was current
+// when they were created, whichever world is current when they're destroyed. While enabled, names are deleted by
+// `end_frame`, so resources can be destroyed in the middle of a frame or on any thread.
+// While disabled(the default), names are deleted at once if the world is current on the calling thread, otherwise
+// they wait for the world to be made current. Names released after the world is destroyed are dropped with its context.
+class gl_deletion_queue
+{
+    friend class gl_world;
+    friend std::shared_ptr<gl_name_owner> gl_current_name_owner();
+    friend void gl_delete_val(gl_val_type type, unsigned int val, const std::shared_ptr<gl_name_owner>& owner);
+
+public:
+    // Deleted names are forgotten by `cache`, the state cache of the same world
+    explicit gl_deletion_queue(gl_state_cache& cache);
+    // The queued names are deleted at once, so it must be destroyed while the context is alive
+    ~gl_deletion_queue();
+    gl_deletion_queue(const gl_deletion_queue&) = delete;
+    gl_deletion_queue(gl_deletion_queue&&) = delete;
+    gl_deletion_queue& operator=(const gl_deletion_queue&) = delete;
+    gl_deletion_queue& operator=(gl_deletion_queue&&) = delete;
+
+    // Disabling deletes the queued names at once
+    gl_deletion_queue& set_enabled(bool enable);
+    [[nodiscard]] bool is_enabled() const noexcept;
+
+    // Thread safe, 0 is ignored
+    void push(gl_val_type type, unsigned int name);
+
+    // Call it on the GL thread once per frame after the last draw.
+    // The names queued since the last call are put behind a fence, the names behind signaled fences are deleted
+    // with one `glDelete*` call per type. Fences are polled without waiting.
+    gl_deletion_queue& end_frame();
+    // Delete every queued name at once, without waiting for the fences
+    gl_deletion_queue& flush() noexcept;
+
+    // Names queued or waiting for their fence
+    [[nodiscard]] std::size_t pending_count() const;
+
+private:
+    static constexpr std::size_t type_count_ = static_cast<std::size_t>(gl_val_type::query) + 1;
+    using names_ = std::array<std::vector<unsigned int>, type_count_>;
+
+    struct batch_
+    {
+        GLsync fence;
+        names_ names;
+    };
+
+    // Delete the names released on other threads if disabled, the world has just been made current
+    void delete_released_() noexcept;
+    void delete_names_(names_& names) noexcept;
+    static void delete_now_(gl_state_cache& cache, gl_val_type type, GLsizei count, const unsigned int* names) noexcept;
+
+    gl_state_cache* cache_;
+    std::shared_ptr<gl_name_owner> owner_;
+    mutable std::mutex mutex_;
+    names_ queued_;             // pushed since the last `end_frame`, guarded by the mutex
+    std::deque<batch_> fenced_; // only used on the GL thread
+    std::atomic<bool> enabled_ = false;
+};
+
+} // namespace lomegl
@@ -1,13 +1,18 @@
 #pragma once
 #include <glad/glad.h>
 
+#include <atomic>
 #include <cassert>
 #include <exception>
-#include <sstream>
 #include <stdexcept>
 
 #include <lotools/errors.h>
 
+// Initial runtime policy of `lomeglcall`, one of the `gl_error_policy` values
+#ifndef LOMEGL_DEFAULT_GL_ERROR_POLICY
+#define LOMEGL_DEFAULT_GL_ERROR_POLICY strict
+#endif
+
 namespace lomegl {
 
 struct gl_error : std::runtime_error
@@ -15,15 +20,62 @@ struct gl_error : std::runtime_error
     using std::runtime_error::runtime_error;
 };
 
-// The follwing macro will throw a 'gl_error' exception if glGetError() does't equals zero
+// How `lomeglcall` checks OpenGL errors.
+// Define LOMEGL_NO_GL_ERROR_CHECK to compile the checks out, then `lomeglcall` is a plain call whatever the policy is.
+enum class gl_error_policy
+{
+    off,       // never call glGetError
+    per_frame, // only `check_gl_errors` calls it, call that once per frame
+    sampled,   // check after every Nth call of each thread, see `set_gl_error_policy`
+    strict     // check after every call, the error is thrown with the failed call
+};
+
+namespace detail {
+    inline std::atomic<gl_error_policy> gl_error_policy_value { gl_error_policy::LOMEGL_DEFAULT_GL_ERROR_POLICY }; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    inline std::atomic<unsigned int> gl_error_sample_interval { 64 };                                              // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+    [[noreturn]] void throw_gl_error(unsigned int error_code, const char* filename, int line, const char* funcname);
+
+    inline void check_gl_call(const char* filename, int line, const char* funcname)
+    {
+        switch (gl_error_policy_value.load(std::memory_order_relaxed))
+        {
+        case gl_error_policy::sampled:
+        {
+            thread_local unsigned int call_count = 0;
+            if (++call_count < gl_error_sample_interval.load(std::memory_order_relaxed))
+                return;
+            call_count = 0;
+            break;
+        }
+        case gl_error_policy::strict:
+            break;
+        default:
+            return;
+        }
+
+        auto error_code = glGetError();
+        if (error_code != 0) [[unlikely]]
+            throw_gl_error(error_code, filename, line, funcname);
+    }
+} // namespace detail
+
+// `sample_interval` is only used by `gl_error_policy::sampled`, it must not be 0
+void set_gl_error_policy(gl_error_policy policy, unsigned int sample_interval = 64) noexcept;
+[[nodiscard]] gl_error_policy get_gl_error_policy() noexcept;
+// Throw a `gl_error` listing the errors recorded since the last check, whatever the policy is.
+// With `gl_error_policy::per_frame` or `sampled` the failed call is unknown, only the error codes are reported.
+void check_gl_errors();
+
+// The follwing macro will throw a 'gl_error' exception if glGetError() does't equals zero, according to the `gl_error_policy`
+#ifdef LOMEGL_NO_GL_ERROR_CHECK
+// NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
+#define lomeglcall(func, ...) func(__VA_ARGS__)
+#else
 // NOLINTNEXTLINE(cppcoreguidelines-macro-usage)
-#define lomeglcall(func, ...) lotcall([](auto) {}, [](const char* filename, int line, const char* funcname, auto) {auto error_code = glGetError(); \
-    if (error_code != 0) {                                                   \
-        std::stringstream out;                                              \
-        out << funcname << " (" << filename << ":" << line << ") " << ::lomegl::get_error_content(error_code) << "\n";\
-        throw ::lomegl::gl_error(out.str());\
-        } }, \
+#define lomeglcall(func, ...) lotcall([](auto) {}, [](const char* filename, int line, const char* funcname, auto) { ::lomegl::detail::check_gl_call(filename, line, funcname); }, \
     [](auto) constexpr { return true; }, func, ##__VA_ARGS__)
+#endif
 
 constexpr const char* get_error_content(unsigned int error_code)
 {
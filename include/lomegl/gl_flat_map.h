@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lomegl {
+
+// Fibonacci hashing for integral keys, atoms and handle values are small sequential numbers
+template <typename Key>
+struct gl_flat_hash
+{
+    static_assert(std::is_integral_v<Key>, "Key must be integral type, or provide a hash");
+    constexpr std::uint64_t operator()(Key key) const noexcept
+    {
+        return static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ULL;
+    }
+};
+
+// Open addressing hash map with linear probing and backward shift deletion.
+// Keys and values are stored in one contiguous array, so a lookup usually touches one cache line.
+// Pointers returned by `find` or `emplace` are invalidated by any insertion or erasure.
+template <typename Key, typename Value, typename Hash = gl_flat_hash<Key>>
+class gl_flat_map
+{
+public:
+    struct entry
+    {
+        Key key;
+        Value value;
+    };
+
+    gl_flat_map() = default;
+
+    [[nodiscard]] Value* find(const Key& key) noexcept
+    {
+        return const_cast<Value*>(static_cast<const gl_flat_map*>(this)->find(key)); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+    }
+
+    [[nodiscard]] const Value* find(const Key& key) const noexcept
+    {
+        if (size_ == 0)
+            return nullptr;
+        for (auto pos = home_(key);; pos = (pos + 1) & mask_)
+        {
+            if (!used_[pos])
+                return nullptr;
+            if (entries_[pos].key == key)
+                return &entries_[pos].value;
+        }
+    }
+
+    [[nodiscard]] bool contains(const Key& key) const noexcept
+    {
+        return find(key) != nullptr;
+    }
+
+    // Return the value of key and whether it is inserted, an existing value is not overwritten
+    template <typename... Args>
+    std::pair<Value*, bool> emplace(const Key& key, Args&&... args)
+    {
+        if ((size_ + 1) * 8 > entries_.size() * 7)
+            rehash_(entries_.empty() ? 16 : entries_.size() * 2);
+
+        auto pos = home_(key);
+        for (; used_[pos]; pos = (pos + 1) & mask_)
+        {
+            if (entries_[pos].key == key)
+                return { &entries_[pos].value, false };
+        }
+        entries_[pos] = entry { key, Value(std::forward<Args>(args)...) };
+        used_[pos] = 1;
+        ++size_;
+        return { &entries_[pos].value, true };
+    }
+
+    Value& operator[](const Key& key)
+    {
+        return *emplace(key).first;
+    }
+
+    bool erase(const Key& key)
+    {
+        if (size_ == 0)
+            return false;
+
+        auto pos = home_(key);
+        for (;; pos = (pos + 1) & mask_)
+        {
+            if (!used_[pos])
+                return false;
+            if (entries_[pos].key == key)
+                break;
+        }
+
+        // Shift the following entries of the probe chain back, so no tombstone is needed
+        auto hole = pos;
+        for (auto next = (hole + 1) & mask_; used_[next]; next = (next + 1) & mask_)
+        {
+            auto home = home_(entries_[next].key);
+            // Move the entry if its home is not in (hole, next]
+            if (((next - home) & mask_) >= ((next - hole) & mask_))
+            {
+                entries_[hole] = std::move(entries_[next]);
+                hole = next;
+            }
+        }
+        entries_[hole] = entry {};
+        used_[hole] = 0;
+        --size_;
+        return true;
+    }
+
+    void reserve(std::size_t count)
+    {
+        std::size_t capacity = 16;
+        while (capacity * 7 < count * 8)
+            capacity *= 2;
+        if (capacity > entries_.size())
+            rehash_(capacity);
+    }
+
+    void clear() noexcept
+    {
+        entries_.clear();
+        used_.clear();
+        mask_ = 0;
+        size_ = 0;
+    }
+
+    // Call `func(key, value)` for every entry
+    template <typename Func>
+    void for_each(Func&& func) const
+    {
+        for (std::size_t i = 0; i < entries_.size(); ++i)
+        {
+            if (used_[i])
+                func(entries_[i].key, entries_[i].value);
+        }
+    }
+
+    template <typename Func>
+    void for_each(Func&& func)
+    {
+        for (std::size_t i = 0; i < entries_.size(); ++i)
+        {
+            if (used_[i])
+                func(static_cast<const Key&>(entries_[i].key), entries_[i].value);
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+private:
+    [[nodiscard]] std::size_t home_(const Key& key) const noexcept
+    {
+        // The high bits of fibonacci hashing are the best distributed
+        return static_cast<std::size_t>(Hash {}(key) >> 32) & mask_;
+    }
+
+    void rehash_(std::size_t capacity)
+    {
+        std::vector<entry> old_entries(capacity);
+        std::vector<std::uint8_t> old_used(capacity, 0);
+        old_entries.swap(entries_);
+        old_used.swap(used_);
+        mask_ = capacity - 1;
+
+        for (std::size_t i = 0; i < old_entries.size(); ++i)
+        {
+            if (!old_used[i])
+                continue;
+            auto pos = home_(old_entries[i].key);
+            while (used_[pos])
+                pos = (pos + 1) & mask_;
+            entries_[pos] = std::move(old_entries[i]);
+            used_[pos] = 1;
+        }
+    }
+
+    std::vector<entry> entries_;
+    std::vector<std::uint8_t> used_;
+    std::size_t mask_ = 0;
+    std::size_t size_ = 0;
+};
+
+} // namespace lomegl
@@ -7,7 +7,12 @@ class gl_object;
 class gl_shader;
 class gl_texture;
 class gl_vertex;
+class gl_mesh_pool;
 class gl_entity;
+class gl_render_queue;
+class gl_occlusion_culler;
+struct gl_occluder_mesh;
+class gl_occlusion_queries;
 struct shader_error;
 
 } // namespace lomegl
\ No newline at end of file
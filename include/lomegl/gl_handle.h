@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lomegl {
+
+// A typed 32-bit generational handle, the low bits is a slot index and the high bits is the generation of the slot.
+// A default constructed handle is null, because generation 0 is never handed out.
+template <typename T>
+class gl_handle
+{
+public:
+    static constexpr std::uint32_t index_bits = 20;
+    static constexpr std::uint32_t index_mask = (1U << index_bits) - 1;
+    static constexpr std::uint32_t generation_mask = (1U << (32 - index_bits)) - 1;
+
+    constexpr gl_handle() noexcept = default;
+    constexpr gl_handle(std::uint32_t index, std::uint32_t generation) noexcept
+        : value_(((generation & generation_mask) << index_bits) | (index & index_mask))
+    {
+    }
+
+    // A handle of derived type can be used as a handle of its base type
+    template <typename U>
+    requires std::is_convertible_v<U*, T*>
+    constexpr gl_handle(gl_handle<U> other) noexcept : value_(other.value()) // NOLINT(google-explicit-constructor)
+    {
+    }
+
+    [[nodiscard]] static constexpr gl_handle from_value(std::uint32_t value) noexcept
+    {
+        gl_handle result;
+        result.value_ = value;
+        return result;
+    }
+
+    [[nodiscard]] constexpr std::uint32_t index() const noexcept
+    {
+        return value_ & index_mask;
+    }
+
+    [[nodiscard]] constexpr std::uint32_t generation() const noexcept
+    {
+        return value_ >> index_bits;
+    }
+
+    [[nodiscard]] constexpr std::uint32_t value() const noexcept
+    {
+        return value_;
+    }
+
+    constexpr explicit operator bool() const noexcept
+    {
+        return value_ != 0;
+    }
+
+    constexpr bool operator==(const gl_handle&) const noexcept = default;
+
+private:
+    std::uint32_t value_ = 0;
+};
+
+// Dense slot storage addressed by `gl_handle`, a lookup is one array index plus a generation compare.
+// Removed slots bump their generation and are recycled, so old handles of that slot become stale.
+template <typename T>
+class gl_slot_map
+{
+public:
+    template <typename U>
+    gl_handle<U> insert(std::shared_ptr<U> item)
+    {
+        static_assert(std::is_convertible_v<U*, T*>, "U must be or derived from T");
+        std::uint32_t index = 0;
+        if (!free_.empty())
+        {
+            index = free_.back();
+            free_.pop_back();
+        } else {
+            if (items_.size() > gl_handle<T>::index_mask) [[unlikely]]
+                throw std::runtime_error("Too many items in slot map");
+            index = static_cast<std::uint32_t>(items_.size());
+            items_.emplace_back();
+            generations_.push_back(1);
+        }
+        items_[index] = std::move(item);
+        ++size_;
+        return gl_handle<U>(index, generations_[index]);
+    }
+
+    // Return nullptr if the handle is null or stale
+    [[nodiscard]] T* get(std::uint32_t handle_value) const noexcept
+    {
+        const auto& item = get_shared(handle_value);
+        return item.get();
+    }
+
+    [[nodiscard]] const std::shared_ptr<T>& get_shared(std::uint32_t handle_value) const noexcept
+    {
+        static const std::shared_ptr<T> null_item;
+        auto handle = gl_handle<T>::from_value(handle_value);
+        auto index = handle.index();
+        if (index >= items_.size() || generations_[index] != handle.generation())
+            return null_item;
+        return items_[index];
+    }
+
+    [[nodiscard]] bool contains(std::uint32_t handle_value) const noexcept
+    {
+        return get(handle_value) != nullptr;
+    }
+
+    bool erase(std::uint32_t handle_value)
+    {
+        if (!contains(handle_value))
+            return false;
+
+        auto index = gl_handle<T>::from_value(handle_value).index();
+        items_[index].reset();
+        // Generation 0 is reserved for null handle
+        generations_[index] = (generations_[index] + 1) & gl_handle<T>::generation_mask;
+        if (generations_[index] == 0)
+            generations_[index] = 1;
+        free_.push_back(index);
+        --size_;
+        return true;
+    }
+
+    // Call `func(handle_value, item)` for every live item
+    template <typename Func>
+    void for_each(Func&& func) const
+    {
+        for (std::uint32_t i = 0; i < items_.size(); ++i)
+        {
+            if (items_[i])
+                func(gl_handle<T>(i, generations_[i]).value(), *items_[i]);
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    // Generations are kept, so handles taken before clear() stay stale
+    void clear()
+    {
+        for (std::uint32_t i = 0; i < items_.size(); ++i)
+        {
+            if (items_[i])
+                erase(gl_handle<T>(i, generations_[i]).value());
+        }
+    }
+
+private:
+    std::vector<std::shared_ptr<T>> items_;
+    std::vector<std::uint32_t> generations_;
+    std::vector<std::uint32_t> free_;
+    std::size_t size_ = 0;
+};
+
+} // namespace lomegl
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lomegl {
+
+// Contents of a resource evicted from GPU memory, kept in CPU memory or spilled to a file
+class gl_evicted_copy
+{
+public:
+    gl_evicted_copy() = default;
+    // The spill file belongs to the copy and is removed with it
+    ~gl_evicted_copy();
+    gl_evicted_copy(const gl_evicted_copy&) = delete;
+    gl_evicted_copy(gl_evicted_copy&& other) noexcept;
+    gl_evicted_copy& operator=(const gl_evicted_copy&) = delete;
+    gl_evicted_copy& operator=(gl_evicted_copy&& other) noexcept;
+
+    // Keep `data`, or write it to `spill_path` and drop it if the path is not empty. Throw if the file can't be written.
+    void store(std::vector<unsigned char> data, const std::string& spill_path);
+    // Return the stored contents and forget them, the spill file is removed
+    [[nodiscard]] std::vector<unsigned char> take();
+
+private:
+    void remove_spill_() noexcept;
+
+    std::vector<unsigned char> data_;
+    std::string spill_path_; // empty if the data is in memory
+};
+
+// Estimated bytes of one texel of a sized or base internal format, 4 if the format is unknown
+[[nodiscard]] std::size_t get_texel_size(int internal_format) noexcept;
+// Bytes of one pixel of client data passed to `glTexImage2D`
+[[nodiscard]] std::size_t get_pixel_size(unsigned int format, unsigned int type) noexcept;
+
+} // namespace lomegl
@@ -0,0 +1,77 @@
+#pragma once
+#include "lomegl/gl_vertex.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace lomegl {
+
+// A mesh stored in a `gl_mesh_pool`, index_count 0 means the whole vertex is drawn
+struct gl_mesh_range
+{
+    std::uint32_t first_index = 0;
+    std::uint32_t index_count = 0;
+    std::int32_t base_vertex = 0;
+    std::uint32_t vertex_count = 0;
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return index_count == 0;
+    }
+
+    [[nodiscard]] bool operator==(const gl_mesh_range&) const noexcept = default;
+};
+
+// First-fit allocator over a range of elements, adjacent free blocks are merged
+class gl_range_allocator
+{
+public:
+    static constexpr std::uint32_t npos = 0xFFFFFFFFU;
+
+    gl_range_allocator() = default;
+    explicit gl_range_allocator(std::uint32_t capacity);
+
+    // Return the offset of the block, npos if there is no free block large enough
+    [[nodiscard]] std::uint32_t allocate(std::uint32_t count);
+    void free(std::uint32_t offset, std::uint32_t count);
+
+    [[nodiscard]] std::uint32_t capacity() const noexcept;
+    [[nodiscard]] std::uint32_t used() const noexcept;
+
+private:
+    struct block_
+    {
+        std::uint32_t offset;
+        std::uint32_t count;
+    };
+
+    std::vector<block_> free_; // sorted by offset
+    std::uint32_t capacity_ = 0;
+    std::uint32_t used_ = 0;
+};
+
+// A vertex whose vbo and ebo are shared by many meshes, so draws of different meshes need no VAO change
+// and can be submitted with one `glMultiDrawElementsIndirect`(see `gl_render_queue`).
+// Set the attribute layout once with `vertex_attrib_pointer` after construction, every mesh uses the same layout.
+// Indices are `GLuint` and relative to the mesh's own vertices.
+class gl_mesh_pool : public gl_vertex
+{
+public:
+    // Must be constructed with a current GL context, the storage is fixed
+    gl_mesh_pool(GLsizei vertex_stride, std::uint32_t vertex_capacity, std::uint32_t index_capacity);
+
+    // Throw if the pool is out of space
+    [[nodiscard]] gl_mesh_range add_mesh(const void* vertices, std::uint32_t vertex_count, const GLuint* indices, std::uint32_t index_count);
+    gl_mesh_pool& remove_mesh(const gl_mesh_range& range);
+
+    [[nodiscard]] GLsizei vertex_stride() const noexcept;
+    [[nodiscard]] const gl_range_allocator& vertex_allocator() const noexcept;
+    [[nodiscard]] const gl_range_allocator& index_allocator() const noexcept;
+
+private:
+    GLsizei vertex_stride_;
+    gl_range_allocator vertices_;
+    gl_range_allocator indices_;
+};
+
+} // namespace lomegl
@@ -4,10 +4,13 @@
 
 #include "lomegl/gl_base.h"
 #include "lomegl/gl_fwd.h"
+#include "lomegl/gl_mesh_pool.h"
+#include "lomegl/gl_transform.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include <cstdint>
 #include <functional>
 #include <initializer_list>
 #include <memory>
@@ -17,18 +20,25 @@
 
 namespace lomegl {
 
+// The transform of an object lives in one slot of a `gl_transform_store`.
+// An object created by `gl_world` uses the store of the world(if enabled), otherwise it owns a single slot store.
+// Objects in the same store can form a hierarchy, see `set_parent`.
+// Note that references returned by the getters may be invalidated when another object is created in the same store.
 class gl_object : public string_id
 {
+    friend class gl_world;
+
 public:
     gl_object();
     gl_object(const glm::vec3& pos);
     gl_object(const glm::vec3& pos, const glm::vec3& angle);
     gl_object(const glm::vec3& pos, const glm::vec3& angle, const glm::vec3& scale);
     virtual ~gl_object();
-    gl_object(const gl_object&) = default;
-    gl_object& operator=(const gl_object&) = default;
-    gl_object(gl_object&&) = default;
-    gl_object& operator=(gl_object&&) = default;
+    // A copy owns its own slot, unless `gl_world` creates it
+    gl_object(const gl_object& other);
+    gl_object& operator=(const gl_object& other);
+    gl_object(gl_object&& other) noexcept;
+    gl_object& operator=(gl_object&& other) noexcept;
 
     // x, y, z
     static constexpr glm::vec3 world_up = glm::vec3(0, 1, 0);
@@ -42,6 +52,12 @@ public:
     glm::vec3 to_world(const glm::vec3& local_pos);
     void update_matrix();
 
+    // Attach this object to `parent`, pass nullptr to detach. Both objects must be in the same transform store.
+    // After attached, the position, angle and scale of this object are local to the parent, and the matrices are world matrices.
+    gl_object& set_parent(gl_object* parent);
+    [[nodiscard]] bool has_parent() const noexcept;
+    [[nodiscard]] glm::vec3 get_world_pos();
+
     [[nodiscard]] glm::vec3& get_pos() noexcept;
     gl_object& set_pos(const glm::vec3& new_pos) noexcept;
     gl_object& add_pos(const glm::vec3& pos) noexcept;
@@ -92,43 +108,139 @@ public:
     gl_object& add_scale_z(float scale_z) noexcept;
 
 private:
-    bool is_transform_ = true;
-    glm::vec3 pos_;            // world cood
-    glm::vec3 obj_front_;      // object front
-    glm::vec3 obj_right_;      // object right
-    glm::vec3 obj_up_;         // object up
-    glm::quat rotate_;         // rotate quaternion
-    glm::vec3 scale_;          // scale
-    glm::mat4 model_no_scale_; // model matrix(local -> world), no scale
-    glm::mat4 model_;          // model matrix(local -> world), with scale
-    glm::mat4 view_;           // view matrix(world -> local), no scale
+    // While alive, the next object constructed on this thread takes its slot from `store`
+    // instead of allocating a store of its own, see `gl_world::create_handle`
+    class store_scope_
+    {
+    public:
+        explicit store_scope_(gl_transform_store* store) noexcept;
+        ~store_scope_();
+        store_scope_(const store_scope_&) = delete;
+        store_scope_(store_scope_&&) = delete;
+        store_scope_& operator=(const store_scope_&) = delete;
+        store_scope_& operator=(store_scope_&&) = delete;
+    };
+
+    // Move the transform to a slot of `store`, the old slot is released
+    void attach_transform_store_(gl_transform_store& store);
+    void release_slot_() noexcept;
+    // The store of a new object, the one of a `store_scope_` or a new own store
+    [[nodiscard]] gl_transform_store* take_store_();
+    void init_transform_(const glm::vec3& pos, const glm::vec3& angle, const glm::vec3& scale);
+
+    std::unique_ptr<gl_transform_store> own_store_; // only used when the object is not in a world's store
+    gl_transform_store* store_ = nullptr;
+    std::uint32_t slot_ = 0;
+};
+
+// How `gl_entity` picks its LOD level
+enum class gl_lod_metric
+{
+    distance,   // level i is used from `threshold` units away from the camera
+    screen_size // level i is used once the bounding sphere covers at most `threshold` of the screen height
+};
+
+struct gl_lod_level
+{
+    std::weak_ptr<gl_vertex> vertex;
+    gl_mesh_range mesh_range;
+    float threshold;
 };
 
 // TODO: normal object which has texture, shader, vertex.
+// The overloads without a `gl_world` parameter use the current world of the calling thread.
 class gl_entity : public gl_object
 {
 public:
     gl_entity() = default;
     gl_entity(const char* vertex, std::initializer_list<const char*> texture_list);
+    gl_entity(gl_world& world, const char* vertex, std::initializer_list<const char*> texture_list);
 
     [[nodiscard]] const std::weak_ptr<gl_vertex>& get_vertex() const noexcept;
     [[nodiscard]] const std::vector<std::weak_ptr<gl_texture>>& get_texture_list() const noexcept;
     gl_entity& set_vertex(const char* vertex);
+    gl_entity& set_vertex(gl_world& world, const char* vertex);
     gl_entity& add_texture(const char* new_texture);
+    gl_entity& add_texture(gl_world& world, const char* new_texture);
     gl_entity& remove_texture(int texture_index);
     gl_entity& replace_texture(const char* new_texture, int texture_index);
+    gl_entity& replace_texture(gl_world& world, const char* new_texture, int texture_index);
     gl_entity& clear_texture() noexcept;
 
-    // Draw this entity, if the vertex is not use EBO, second param is ignored
+    // Draw only `range` of the vertex, which is usually a `gl_mesh_pool`. An empty range draws the whole vertex.
+    [[nodiscard]] const gl_mesh_range& get_mesh_range() const noexcept;
+    gl_entity& set_mesh_range(const gl_mesh_range& range) noexcept;
+
+    // Local bounds of this entity, the bounds of the vertex are used if they're not set
+    [[nodiscard]] const gl_bounds& get_bounds() const noexcept;
+    gl_entity& set_bounds(const gl_bounds& bounds) noexcept;
+    // Bounding sphere in world space, empty if no bounds are known
+    [[nodiscard]] gl_sphere get_world_sphere();
+    [[nodiscard]] gl_aabb get_world_aabb();
+
+    // Static entities are put in the SAH tree of the world's spatial index, which is not refitted when they move.
+    // A change takes effect at the next `gl_world::rebuild_spatial_index`.
+    [[nodiscard]] bool is_static() const noexcept;
+    gl_entity& set_static(bool is_static) noexcept;
+
+    // Coarser meshes of this entity, level 0 is the vertex and mesh range set above.
+    // Thresholds must grow with the level for `gl_lod_metric::distance`, and shrink for `gl_lod_metric::screen_size`.
+    gl_entity& add_lod(const char* vertex, float threshold, const gl_mesh_range& range = {});
+    gl_entity& add_lod(gl_world& world, const char* vertex, float threshold, const gl_mesh_range& range = {});
+    gl_entity& clear_lod() noexcept;
+    [[nodiscard]] const std::vector<gl_lod_level>& get_lod_levels() const noexcept;
+    gl_entity& set_lod_metric(gl_lod_metric metric) noexcept;
+    // Relative margin around each threshold, so an entity near a threshold doesn't switch back and forth
+    gl_entity& set_lod_hysteresis(float hysteresis) noexcept;
+    // Cross-fade the old and the new level over `frames` updates, 0 switches at once.
+    // Only drawn with shaders declaring `lod_fade`, see `gl_shader::lod_fade_name`.
+    gl_entity& set_lod_fade_frames(unsigned int frames) noexcept;
+
+    // Select the level for a camera and advance the fade, call it once per frame.
+    // `projection_scale` is `projection[1][1]`, only used by `gl_lod_metric::screen_size`.
+    gl_entity& update_lod(const glm::vec3& camera_pos, float projection_scale);
+    // Same with the current camera of the world, the fade advances once per frame of the world(see `gl_world::next_frame`),
+    // or on every call until the world starts its first new frame. `draw` and `gl_render_queue::push` call it, so every pass may do it.
+    gl_entity& update_lod(gl_world& world);
+    [[nodiscard]] std::size_t get_lod() const noexcept;
+    // The level fading out and the fade progress in (0, 1), the progress is 0 if no fade is running
+    [[nodiscard]] std::size_t get_lod_fade_from() const noexcept;
+    [[nodiscard]] float get_lod_fade() const noexcept;
+    [[nodiscard]] const std::weak_ptr<gl_vertex>& get_lod_vertex(std::size_t level) const noexcept;
+    [[nodiscard]] const gl_mesh_range& get_lod_mesh_range(std::size_t level) const noexcept;
+
+    // Draw this entity, if the vertex is not use EBO or the mesh range is set, second param is ignored.
+    // Nothing is drawn if the entity is culled by the current world(opt-in), see `gl_world::is_visible`.
+    // The current LOD level is drawn, both levels are drawn during a fade.
     // Your shader need a uniform value 'model', the model mat of this entity will be passed
     gl_entity& draw(unsigned int draw_type, unsigned int elem_index_type = 0);
+    gl_entity& draw(gl_world& world, unsigned int draw_type, unsigned int elem_index_type = 0);
 
     // You need pass a custom function, this will call it after bind everythins needed.
     gl_entity& draw(const std::function<void(gl_entity*)>& func, unsigned int draw_type, unsigned int elem_index_type = 0);
+    gl_entity& draw(gl_world& world, const std::function<void(gl_entity*)>& func, unsigned int draw_type, unsigned int elem_index_type = 0);
 
 private:
+    // Distance like value of the threshold of `level`, bigger is coarser
+    [[nodiscard]] float lod_coarseness_(std::size_t level) const noexcept;
+    void select_lod_(const glm::vec3& camera_pos, float projection_scale);
+    void advance_lod_fade_() noexcept;
+    void draw_level_(gl_world& world, std::size_t level, const std::function<void(gl_entity*)>& func, unsigned int draw_type, unsigned int elem_index_type);
+
     std::weak_ptr<gl_vertex> vertex_;
     std::vector<std::weak_ptr<gl_texture>> texture_;
+    gl_mesh_range mesh_range_;
+    gl_bounds bounds_;
+    bool is_static_ = false;
+
+    std::vector<gl_lod_level> lod_;
+    gl_lod_metric lod_metric_ = gl_lod_metric::distance;
+    float lod_hysteresis_ = 0.1F;
+    unsigned int lod_fade_frames_ = 0;
+    std::size_t lod_level_ = 0;
+    std::size_t lod_fade_from_ = 0; // equal to lod_level_ if no fade is running
+    float lod_fade_ = 0.0F;
+    std::uint64_t lod_fade_frame_ = 0; // 1 + the frame of the world when the fade last advanced, 0 if never
 };
 
 } // namespace lomegl
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "lomegl/gl_bounds.h"
+#include "lomegl/gl_thread_pool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lomegl {
+
+// CPU copy of a simplified mesh used to occlude others, usually a few large triangles inside a building or wall
+struct gl_occluder_mesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<std::uint32_t> indices;
+};
+
+// Software occlusion culling: occluders are rasterized into a low resolution depth buffer on the CPU,
+// then bounding boxes are tested against a hierarchical max-depth pyramid(Hi-Z) of it.
+// Depth is the window depth in [0, 1], smaller is nearer. Triangles crossing the near plane are skipped,
+// so every test result is conservative: a box is only reported occluded if it's behind rasterized occluders.
+//
+// Usage per frame: `begin_frame` -> `add_occluder`... -> `rasterize` -> `is_visible`...
+class gl_occlusion_culler
+{
+public:
+    static constexpr int tile_size = 32;
+
+    // The size is rounded up to a multiple of tile_size
+    explicit gl_occlusion_culler(int width = 256, int height = 128, std::size_t worker_count = gl_thread_pool::default_worker_count());
+
+    gl_occlusion_culler& begin_frame(const glm::mat4& view_projection);
+    gl_occlusion_culler& add_occluder(const gl_occluder_mesh& mesh, const glm::mat4& model);
+    // Rasterize the occluders tile by tile on the workers, and build the Hi-Z pyramid
+    gl_occlusion_culler& rasterize();
+
+    // Always true before the first `rasterize` of the frame
+    [[nodiscard]] bool is_visible(const gl_aabb& world_box) const noexcept;
+    [[nodiscard]] bool is_ready() const noexcept;
+
+    [[nodiscard]] int width() const noexcept;
+    [[nodiscard]] int height() const noexcept;
+    [[nodiscard]] std::size_t triangle_count() const noexcept;
+    // Level 0 is the full resolution depth buffer, row-major with row 0 at the bottom
+    [[nodiscard]] const std::vector<float>& get_depth(int level = 0) const noexcept;
+    [[nodiscard]] int level_count() const noexcept;
+
+private:
+    // Screen space triangle, edges are A * x + B * y + C >= 0 inside, depth is z0 + dzdx * x + dzdy * y
+    struct triangle_
+    {
+        float edge_a[3];
+        float edge_b[3];
+        float edge_c[3];
+        float z0;
+        float dzdx;
+        float dzdy;
+        int min_x, min_y, max_x, max_y;
+    };
+
+    void setup_triangle_(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2);
+    void rasterize_tile_(std::size_t tile) noexcept;
+    void build_hi_z_() noexcept;
+
+    int width_;
+    int height_;
+    int tiles_x_;
+    int tiles_y_;
+    glm::mat4 view_projection_ { 1.0F };
+    std::vector<triangle_> triangles_;
+    std::vector<std::vector<std::uint32_t>> bins_; // triangles overlapping each tile
+    std::vector<std::vector<float>> levels_;       // Hi-Z pyramid, each texel is the max depth of the 2x2 texels below
+    std::vector<std::pair<int, int>> level_sizes_;
+    bool ready_ = false;
+    std::unique_ptr<gl_thread_pool> workers_;
+};
+
+} // namespace lomegl
@@ -0,0 +1,89 @@
+#pragma once
+#include "lomegl/gl_base.h"
+#include "lomegl/gl_flat_map.h"
+#include "lomegl/gl_fwd.h"
+#include "lomegl/gl_uniform.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace lomegl {
+
+// Recycle query objects instead of generating and deleting them every frame
+class gl_query_pool
+{
+public:
+    gl_query_pool() = default;
+    gl_query_pool(const gl_query_pool&) = delete;
+    gl_query_pool(gl_query_pool&&) = default;
+    gl_query_pool& operator=(const gl_query_pool&) = delete;
+    gl_query_pool& operator=(gl_query_pool&&) = default;
+
+    [[nodiscard]] unsigned int acquire();
+    // The query must not be active or pending any more
+    void release(unsigned int query);
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+private:
+    std::vector<unique_query> queries_;
+    std::vector<unsigned int> free_;
+};
+
+// Hardware occlusion queries of entity bounding boxes.
+// Results are read back one or more frames later without stalling, so visibility lags behind by the GPU latency.
+// Entities are keyed by their name in the world.
+//
+// Usage per frame: `begin_frame` -> draws skipping entities where `was_visible` is false -> `query_bounds` for the tested entities.
+// `gl_render_queue::set_occlusion_queries` does it for the packets of a queue.
+class gl_occlusion_queries
+{
+public:
+    explicit gl_occlusion_queries(gl_world& world);
+    ~gl_occlusion_queries();
+    gl_occlusion_queries(const gl_occlusion_queries&) = delete;
+    gl_occlusion_queries(gl_occlusion_queries&&) = delete;
+    gl_occlusion_queries& operator=(const gl_occlusion_queries&) = delete;
+    gl_occlusion_queries& operator=(gl_occlusion_queries&&) = delete;
+
+    // Collect the available results, drop the entities removed from the world
+    gl_occlusion_queries& begin_frame();
+
+    // The last known result, true if the entity has never been tested
+    [[nodiscard]] bool was_visible(const gl_entity& entity) const noexcept;
+
+    // Draw the world box of each entity inside a query, with color and depth writes disabled.
+    // Entities whose last query is still pending are skipped. The current shader of the world is restored.
+    gl_occlusion_queries& query_bounds(const std::vector<gl_entity*>& entities);
+
+    // Run `func` under conditional rendering of the latest query of `entity`, the GPU skips it if the box was hidden.
+    // `func` runs unconditionally if the entity has never been queried.
+    gl_occlusion_queries& draw_conditional(const gl_entity& entity, const std::function<void()>& func);
+
+    [[nodiscard]] std::size_t pending_count() const noexcept;
+
+private:
+    struct state_
+    {
+        unsigned int query = 0;      // 0 if no query is in flight
+        unsigned int last_query = 0; // latest query for conditional rendering, kept alive until the next one
+        bool visible = true;
+    };
+
+    void create_box_resources_();
+
+    gl_world* world_;
+    gl_query_pool pool_;
+    gl_flat_map<std::uint32_t, state_> states_; // entity atom -> state
+    std::vector<std::uint32_t> removed_;
+    std::vector<unsigned int> orphaned_; // in-flight queries of removed entities, released to the pool once available
+    std::size_t pending_ = 0;
+    unsigned int target_ = 0;
+    std::unique_ptr<gl_shader> box_shader_;
+    gl_uniform_slot<glm::mat4> box_mvp_slot_;
+    std::unique_ptr<gl_vertex> box_vertex_;
+};
+
+} // namespace lomegl
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "lomegl/gl_base.h"
+#include "lomegl/gl_flat_map.h"
+#include "lomegl/gl_fwd.h"
+#include "lomegl/gl_handle.h"
+#include "lomegl/gl_mesh_pool.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace lomegl {
+
+// One draw of an entity, gathered by `gl_render_queue`
+struct gl_draw_packet
+{
+    std::uint64_t key;
+    gl_entity* entity;
+    gl_shader* shader;
+    gl_handle<gl_shader> shader_handle;
+    gl_vertex* vertex;
+    std::uint32_t texture_set; // index of the texture set of the queue
+    unsigned int draw_type;
+    unsigned int elem_index_type;
+    gl_mesh_range mesh_range; // the elem index type is GL_UNSIGNED_INT if it's not empty
+    float lod_fade;           // value of the `lod_fade` uniform, 0 if the entity is not fading between LOD levels
+};
+
+// Layout of `DrawElementsIndirectCommand`
+struct gl_draw_indirect_command
+{
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+// Gather draws of entities, sort them by a 64-bit state key and submit them with minimal state changes.
+// The key is (from high to low) shader: 10 bits, vertex: 16 bits, texture set: 14 bits, depth: 24 bits,
+// so draws sharing the same program, VAO and textures are adjacent, and they are drawn front to back.
+//
+// Texture `i` of an entity is bound to texture unit `GL_TEXTURE0 + i`.
+// If the shader declares `in mat4 instance_model;`(see `gl_shader::instance_model_name`), adjacent draws sharing the same
+// shader, vertex, textures and draw type are merged into one instanced draw, the model matrices are fed through
+// the instance buffer of the vertex. Such shaders don't need the `model` uniform.
+// When those draws use mesh ranges of a `gl_mesh_pool`, they are encoded into an indirect buffer and submitted with
+// one `glMultiDrawElementsIndirect`(GL 4.3). The base instance of each command points to its matrices in the instance buffer.
+// The LOD level of an entity is selected when it's pushed, an entity fading between two levels pushes a packet for each.
+// The queue holds raw pointers, so entities and their resources must not be removed before `submit`.
+class gl_render_queue
+{
+public:
+    static constexpr int shader_bits = 10;
+    static constexpr int vertex_bits = 16;
+    static constexpr int texture_set_bits = 14;
+    static constexpr int depth_bits = 24;
+
+    explicit gl_render_queue(gl_world& world);
+
+    // Push a draw with the current shader of the world, see `gl_entity::draw` for the params
+    gl_render_queue& push(gl_entity& entity, unsigned int draw_type, unsigned int elem_index_type = 0);
+    gl_render_queue& push(gl_entity& entity, gl_handle<gl_shader> shader, unsigned int draw_type, unsigned int elem_index_type = 0);
+
+    // Drop the packets culled by the frustum of the world, then radix sort the rest by key. `submit` calls it if needed.
+    gl_render_queue& sort();
+    // Draw every packet, then clear the queue. The current shader of the world is changed as needed.
+    gl_render_queue& submit();
+    gl_render_queue& clear() noexcept;
+
+    // Skip entities hidden in the last available query results, and query the boxes of the tested entities after `submit` draws.
+    // `gl_occlusion_queries::begin_frame` should be called once per frame before. nullptr disables it.
+    gl_render_queue& set_occlusion_queries(gl_occlusion_queries* queries) noexcept;
+    // Without GL 4.3 or when disabled, the commands are drawn one by one with base instance(GL 4.2)
+    gl_render_queue& set_multi_draw_enabled(bool enabled) noexcept;
+
+    [[nodiscard]] const std::vector<gl_draw_packet>& get_packets() const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept;
+    // Number of packets culled by the last `sort`
+    [[nodiscard]] std::size_t get_culled_count() const noexcept;
+
+private:
+    struct sort_item_
+    {
+        std::uint64_t key;
+        std::uint32_t index;
+    };
+
+    // Test the world spheres of all packets at once, see `gl_frustum::cull_spheres`
+    void cull_();
+    void cull_frustum_();
+    [[nodiscard]] std::uint32_t get_texture_set_(const gl_entity& entity);
+    [[nodiscard]] std::uint64_t make_key_(const gl_draw_packet& packet, float depth);
+    void push_level_(gl_entity& entity, gl_handle<gl_shader> shader, std::size_t level, unsigned int draw_type, unsigned int elem_index_type,
+        float depth, float lod_fade);
+    void set_lod_fade_(const gl_draw_packet& packet);
+    // Set the `lod_fade` of the bound `shader` back to 0 if needed
+    void reset_lod_fade_(gl_shader* shader);
+    void draw_packet_(const gl_draw_packet& packet);
+    // Draw sorted_[first, last) with one instanced call
+    void draw_instanced_(std::size_t first, std::size_t last);
+    void draw_indirect_(const gl_draw_packet& packet);
+    [[nodiscard]] static bool can_instance_(const gl_draw_packet& lhs, const gl_draw_packet& rhs) noexcept;
+
+    gl_world* world_;
+    std::vector<gl_draw_packet> packets_;
+    std::vector<sort_item_> sorted_;
+    std::vector<sort_item_> scratch_;
+    bool is_sorted_ = true;
+    std::size_t culled_count_ = 0;
+    std::vector<float> cull_spheres_; // x, y, z and radius arrays of packets_.size() each
+    std::vector<std::uint8_t> cull_visible_;
+    gl_occlusion_queries* occlusion_queries_ = nullptr;
+    std::vector<gl_entity*> occlusion_tested_;
+    std::vector<glm::mat4> instance_models_;
+    std::vector<gl_draw_indirect_command> commands_;
+    unique_vbo indirect_buffer_; // created on first multi draw
+    GLsizeiptr indirect_capacity_ = 0;
+    bool multi_draw_enabled_ = true;
+
+    // Dense ids of the key fields, assigned in first-seen order and reset by `clear`
+    gl_flat_map<std::uint32_t, std::uint32_t> shader_ids_;
+    gl_flat_map<std::uint32_t, std::uint32_t> vertex_ids_;
+    gl_flat_map<std::uint64_t, std::uint32_t> texture_set_ids_; // hash of texture list -> index of texture_sets_
+    std::vector<std::vector<gl_texture*>> texture_sets_;
+};
+
+} // namespace lomegl
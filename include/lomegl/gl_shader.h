@@ -1,11 +1,18 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <vector>
 
+#include "lomegl/gl_atom.h"
 #include "lomegl/gl_base.h"
+#include "lomegl/gl_flat_map.h"
+#include "lomegl/gl_state_cache.h"
+#include "lomegl/gl_uniform.h"
 
 namespace lomegl {
 
@@ -15,6 +22,28 @@ struct shader_error : std::runtime_error
     using std::runtime_error::runtime_error;
 };
 
+enum class gl_shader_resource_kind
+{
+    uniform,
+    uniform_block,
+    attribute,
+    storage_block // needs GL 4.3
+};
+
+// An active resource of a linked program, reflected by `gl_shader` at link time
+struct gl_shader_resource
+{
+    gl_shader_resource_kind kind = gl_shader_resource_kind::uniform;
+    std::uint32_t atom = 0; // interned name, arrays are named without `[0]`
+    GLenum type = 0;        // GLSL type of a uniform or an attribute, 0 for blocks
+    GLint location = -1;    // -1 for blocks and the uniforms of blocks
+    GLint array_size = 1;
+    GLint offset = -1;      // byte offset of a uniform in its block, -1 in the default block
+    GLint block_index = -1; // block of a uniform, -1 for the default block
+    GLint binding = -1;     // buffer binding of a block
+    GLint data_size = 0;    // bytes of a block
+};
+
 // This class manage shader program.
 class gl_shader : public string_id
 {
@@ -29,42 +58,146 @@ public:
     [[nodiscard]] bool is_vaild() const noexcept;
     [[nodiscard]] unsigned int shader() const noexcept;
     [[nodiscard]] int get_uniform_loc(const char* uniform_name) const noexcept;
+    // Location of the `instance_model` attribute, -1 if the program doesn't declare it
+    [[nodiscard]] int get_instance_model_loc() const noexcept;
+    // Location of the `lod_fade` uniform, -1 if the program doesn't declare it
+    [[nodiscard]] int get_lod_fade_loc() const noexcept;
     gl_shader& add_vertex(const char* vertex_source);
     gl_shader& add_geometry(const char* geometry_source);
     gl_shader& add_fragment(const char* fragment_source);
     gl_shader& link_shader();
     gl_shader& use();
 
-    template <typename Func, typename... Args>
-    gl_shader& uniform(Func func, const char* uniform_name, Args&&... args)
+    // Link from a binary returned by `get_binary`, return false if the driver rejects it(e.g. the driver was updated)
+    bool load_binary(unsigned int binary_format, const void* binary, int size);
+    // Empty if program binaries are not supported(GL 4.1)
+    [[nodiscard]] std::vector<unsigned char> get_binary(unsigned int& binary_format) const;
+    // Keep the sources of a program loaded by `load_binary`, so it can be rebuilt if the binary is rejected later
+    gl_shader& set_sources(std::string vertex_source, std::string geometry_source, std::string fragment_source);
+    // Sources passed to `add_*`, kept to rebuild the program if its binary is rejected
+    [[nodiscard]] const std::string& get_vertex_source() const noexcept;
+    [[nodiscard]] const std::string& get_geometry_source() const noexcept;
+    [[nodiscard]] const std::string& get_fragment_source() const noexcept;
+    // Label the program with `get_id()` for debuggers and profilers, see `gl_object_label`
+    gl_shader& label_objects();
+
+    // Active uniforms, uniform blocks, attributes and storage blocks, sorted by kind and atom
+    [[nodiscard]] const std::vector<gl_shader_resource>& get_resources() const noexcept;
+    // nullptr if the program has no such active resource
+    [[nodiscard]] const gl_shader_resource* find_resource(gl_shader_resource_kind kind, gl_name name) const noexcept;
+
+    // Resolve a uniform of the default block once, throw if the program doesn't declare it.
+    // Its type is checked against `T` in debug builds.
+    template <typename T>
+    [[nodiscard]] gl_uniform_slot<T> find_uniform(gl_name uniform_name) const
     {
         assert(is_vaild());
-        // Must call use() first
-        assert([this] {
-            int current_program = 0;
-            glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
-            return !(current_program == 0 || current_program != shader_program_.get());
-        }());
-
-        auto iter = uniform_loc_map.find(uniform_name);
-        if (iter != uniform_loc_map.end())
+        auto index = find_resource_index_(gl_shader_resource_kind::uniform, uniform_name);
+        if (index == gl_uniform_slot<T>::invalid_index || resources_[index].location == -1)
+            throw shader_error(std::string("Can't find uniform name ") + uniform_name.str);
+        assert(is_uniform_type_of<T>(resources_[index].type) && "The type of the uniform doesn't match");
+        return gl_uniform_slot<T>(index, shader_program_.get());
+    }
+
+    // Set the uniform of a slot of this program, which must be current without DSA(see `upload_uniform`).
+    // The slot is checked in debug builds.
+    // The program keeps a copy of the values, so an upload of the values it already holds is skipped.
+    template <typename T>
+    gl_shader& set_uniform(gl_uniform_slot<T> slot, const T& value)
+    {
+        return set_uniform(slot, &value, 1);
+    }
+
+    template <typename T>
+    gl_shader& set_uniform(gl_uniform_slot<T> slot, const T* values, GLsizei count)
+    {
+        assert(slot.get_program() == shader_program_.get() && "The slot belongs to another program");
+        assert(slot.get_index() < resources_.size() && resources_[slot.get_index()].kind == gl_shader_resource_kind::uniform);
+        assert(is_uniform_type_of<T>(resources_[slot.get_index()].type) && "The type of the uniform doesn't match");
+        assert(count <= resources_[slot.get_index()].array_size);
+        assert(is_dsa_enabled() || gl_state_cache::get().is_program_current(shader_program_.get()));
+        auto& value = uniform_values_[slot.get_index()];
+        auto size = sizeof(T) * static_cast<std::size_t>(count);
+        auto* shadow = uniform_bytes_.data() + value.offset;
+        auto cached = value.element_size == sizeof(T);
+        if (cached && count <= value.known_count && uniform_value_equal(shadow, values, size))
+        {
+            ++uniform_stats_.skipped;
+            return *this;
+        }
+
+        upload_uniform(shader_program_.get(), resources_[slot.get_index()].location, count, values);
+        ++uniform_stats_.issued;
+        if (cached)
         {
-            func(iter->second, std::forward<Args>(args)...);
-        } else {
-            auto loc = get_uniform_loc(uniform_name);
-            if (loc == -1)
-                throw shader_error(std::string("Can't find uniform name ") + uniform_name);
-            uniform_loc_map.emplace(uniform_name, loc);
-            func(loc, std::forward<Args>(args)...);
+            std::memcpy(shadow, values, size);
+            value.known_count = std::max(value.known_count, count);
         }
         return *this;
     }
 
-    static constexpr const char* model_name = "model";
-    static constexpr const char* view_name = "view";
-    static constexpr const char* projection_name = "projection";
+    [[nodiscard]] const gl_uniform_stats& get_uniform_stats() const noexcept;
+    gl_shader& reset_uniform_stats() noexcept;
+    // Forget the values kept by `set_uniform`, call it after setting uniforms of this program outside lomegl
+    gl_shader& invalidate_uniform_values() noexcept;
+
+    // Slots of `model_name`, `view_name` and `projection_name`, throw if the program doesn't declare it
+    [[nodiscard]] gl_uniform_slot<glm::mat4> get_model_slot() const;
+    [[nodiscard]] gl_uniform_slot<glm::mat4> get_view_slot() const;
+    [[nodiscard]] gl_uniform_slot<glm::mat4> get_projection_slot() const;
+    // Slot of `lod_fade_name`, invalid if the program doesn't declare it
+    [[nodiscard]] gl_uniform_slot<float> get_lod_fade_slot() const noexcept;
+
+    template <typename Func, typename... Args>
+    gl_shader& uniform(Func func, gl_name uniform_name, Args&&... args)
+    {
+        assert(is_vaild());
+        // Must call use() first
+        assert(gl_state_cache::get().is_program_current(shader_program_.get()));
+        auto loc = find_uniform_loc_(uniform_name);
+        func(loc, std::forward<Args>(args)...);
+        forget_uniform_value_(loc);
+        return *this;
+    }
+
+    // Same as `uniform` with a glProgramUniform* function, the program doesn't need to be current(GL 4.1).
+    // So uniforms can be set up in any order without changing the program used by drawing.
+    template <typename Func, typename... Args>
+    gl_shader& program_uniform(Func func, gl_name uniform_name, Args&&... args)
+    {
+        assert(is_vaild() && GLAD_GL_VERSION_4_1 != 0);
+        auto loc = find_uniform_loc_(uniform_name);
+        func(shader_program_.get(), loc, std::forward<Args>(args)...);
+        forget_uniform_value_(loc);
+        return *this;
+    }
+
+    static constexpr gl_name model_name = "model";
+    static constexpr gl_name view_name = "view";
+    static constexpr gl_name projection_name = "projection";
+    // Programs declaring `in mat4 instance_model;` take the model matrix per instance instead of the `model` uniform
+    static constexpr gl_name instance_model_name = "instance_model";
+    // Programs declaring `uniform float lod_fade;` can cross-fade LOD levels with a dither, see `gl_entity::set_lod_fade_frames`.
+    // 0 means no fade, t in (0, 1) keeps the fragments whose dither value is below t, and -t keeps the others:
+    // `if (lod_fade > 0.0 ? dither >= lod_fade : dither < -lod_fade) discard;`
+    static constexpr gl_name lod_fade_name = "lod_fade";
 
 private:
+    // Fill the resource table after the program is linked
+    void reflect_();
+    // With glGetProgramInterfaceiv and glGetProgramResourceiv(GL 4.3)
+    void reflect_interfaces_();
+    // With glGetActiveUniform, glGetActiveUniformBlockiv and glGetActiveAttrib, storage blocks are not reflected
+    void reflect_active_();
+    [[nodiscard]] std::uint32_t find_resource_index_(gl_shader_resource_kind kind, gl_name name) const noexcept;
+    [[nodiscard]] gl_uniform_slot<glm::mat4> get_matrix_slot_(std::uint32_t index, gl_name uniform_name) const;
+    // Cached location of a uniform, throw if the program doesn't declare it
+    [[nodiscard]] int find_uniform_loc_(gl_name uniform_name);
+    // Lay out the copies of the uniform values after reflecting the program
+    void reset_uniform_values_();
+    // The uniform covering `location` was set without `set_uniform`, its value is unknown
+    void forget_uniform_value_(int location) noexcept;
+
     template <typename T>
     void add_source_(T& shader_index, const char* shader_name, const char* source) // NOLINT(bugprone-easily-swappable-parameters)
     {
@@ -98,7 +231,34 @@ private:
     unique_fragment_shader fragment_shader_;
     unique_geometry_shader geometry_shader_;
     bool is_linked_ = false;
-    std::unordered_map<std::string, int> uniform_loc_map;
+    std::string vertex_source_;
+    std::string geometry_source_;
+    std::string fragment_source_;
+    int instance_model_loc_ = -1;
+    int lod_fade_loc_ = -1;
+    struct uniform_loc_
+    {
+        std::string name; // tells names of the same hash apart
+        int location = -1;
+    };
+    gl_flat_map<std::uint32_t, uniform_loc_> uniform_loc_map; // hash of the name -> location
+    std::vector<gl_shader_resource> resources_;
+    std::uint32_t model_index_ = gl_uniform_slot<glm::mat4>::invalid_index;
+    std::uint32_t view_index_ = gl_uniform_slot<glm::mat4>::invalid_index;
+    std::uint32_t projection_index_ = gl_uniform_slot<glm::mat4>::invalid_index;
+    std::uint32_t lod_fade_index_ = gl_uniform_slot<float>::invalid_index;
+
+    // Copy of the value of a uniform in `uniform_bytes_`, indexed like `resources_`
+    struct uniform_value_
+    {
+        std::uint32_t offset = 0;
+        std::uint32_t element_size = 0; // 0 if the value isn't kept
+        GLsizei known_count = 0;        // leading elements which hold the copy
+    };
+    std::vector<uniform_value_> uniform_values_;
+    std::vector<unsigned char> uniform_bytes_;
+    std::vector<std::uint32_t> location_indices_; // location -> index of the uniform covering it, invalid_index if none
+    gl_uniform_stats uniform_stats_;
 };
 
 } // namespace lomegl
\ No newline at end of file
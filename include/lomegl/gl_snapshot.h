@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace lomegl {
+
+// Read-only memory mapping of a whole file
+class gl_mapped_file
+{
+public:
+    gl_mapped_file() = default;
+    // Throw if the file can't be opened or mapped
+    explicit gl_mapped_file(const std::string& path);
+    ~gl_mapped_file();
+    gl_mapped_file(const gl_mapped_file&) = delete;
+    gl_mapped_file(gl_mapped_file&& other) noexcept;
+    gl_mapped_file& operator=(const gl_mapped_file&) = delete;
+    gl_mapped_file& operator=(gl_mapped_file&& other) noexcept;
+
+    [[nodiscard]] const unsigned char* data() const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept;
+
+private:
+    void close_() noexcept;
+
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+// On-disk layout of `gl_world::save_snapshot`, in native byte order.
+// The file is: header | record tables | blobs, every table and blob is aligned to `gl_snapshot::alignment`.
+// Records only hold fixed-size fields, variable data(names, pixels, buffers...) are referenced by offset from the file start,
+// so a mapped file is used in place without parsing.
+namespace gl_snapshot {
+
+    constexpr char magic[8] = { 'L', 'O', 'M', 'E', 'G', 'L', 'S', 'N' };
+    constexpr std::uint32_t version = 1;
+    constexpr std::uint32_t byte_order_mark = 0x01020304U;
+    constexpr std::uint32_t npos = 0xFFFFFFFFU;
+    constexpr std::size_t alignment = 16;
+    constexpr std::size_t max_attribs = 16;
+
+    struct blob_ref
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    // A table of `count` records
+    struct table_ref
+    {
+        std::uint64_t offset;
+        std::uint32_t count;
+        std::uint32_t reserved;
+    };
+
+    struct header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order_mark;
+        std::uint64_t file_size;
+        table_ref textures;
+        table_ref shaders;
+        table_ref vertices;
+        table_ref objects;
+        blob_ref current_camera; // names of the current camera and shader, empty if not set
+        blob_ref current_shader;
+    };
+
+    struct texture_level
+    {
+        std::int32_t width;
+        std::int32_t height;
+        std::uint32_t internal_format;
+        std::uint32_t format; // 0 if the pixels are compressed
+        std::uint32_t type;
+        std::uint32_t reserved;
+        blob_ref pixels;
+    };
+
+    // Only GL_TEXTURE_2D textures can be saved
+    struct texture
+    {
+        blob_ref name;
+        std::uint32_t target;
+        std::int32_t min_filter;
+        std::int32_t mag_filter;
+        std::int32_t wrap_s;
+        std::int32_t wrap_t;
+        std::uint32_t level_count;
+        std::uint64_t levels; // offset of `level_count` texture_level
+    };
+
+    struct shader
+    {
+        blob_ref name;
+        std::uint32_t binary_format;
+        std::uint32_t reserved;
+        blob_ref binary; // empty if program binaries are not supported
+        blob_ref vertex_source;
+        blob_ref geometry_source;
+        blob_ref fragment_source;
+    };
+
+    struct attrib
+    {
+        std::uint32_t index;
+        std::int32_t size;
+        std::uint32_t type;
+        std::uint32_t normalized;
+        std::int32_t stride;
+        std::uint32_t offset;
+    };
+
+    struct bounds
+    {
+        float box_min[3];
+        float box_max[3];
+        float sphere_center[3];
+        float sphere_radius;
+    };
+
+    struct vertex
+    {
+        blob_ref name;
+        std::int32_t vbo_counts;
+        std::int32_t ebo_counts;
+        blob_ref vbo;
+        blob_ref ebo; // empty if the vertex has no EBO
+        std::uint32_t attrib_count;
+        std::uint32_t reserved;
+        attrib attribs[max_attribs];
+        bounds local_bounds;
+    };
+
+    struct mesh_range
+    {
+        std::uint32_t first_index;
+        std::uint32_t index_count;
+        std::int32_t base_vertex;
+        std::uint32_t vertex_count;
+    };
+
+    struct lod_level
+    {
+        std::uint32_t vertex; // index in the vertex table
+        float threshold;
+        mesh_range range;
+    };
+
+    enum object_kind : std::uint32_t
+    {
+        object_kind_object = 0,
+        object_kind_entity = 1
+    };
+
+    // Transforms are local to the parent if it has one, like `gl_transform_store`
+    struct object
+    {
+        blob_ref name;
+        std::uint32_t kind;
+        std::uint32_t parent; // index in the object table, npos if it's a root
+        float pos[3];
+        float front[3];
+        float right[3];
+        float up[3];
+        float rotate[4]; // x, y, z, w
+        float scale[3];
+        // The rest is only used by entities
+        std::uint32_t vertex; // index in the vertex table, npos if unset
+        std::uint32_t is_static;
+        std::uint32_t texture_count;
+        std::uint32_t lod_count;
+        std::uint64_t textures; // offset of `texture_count` uint32 indices in the texture table
+        std::uint64_t lods;     // offset of `lod_count` lod_level
+        mesh_range range;
+        bounds local_bounds;
+    };
+
+    static_assert(std::is_trivially_copyable_v<header> && std::is_trivially_copyable_v<texture_level>
+        && std::is_trivially_copyable_v<texture> && std::is_trivially_copyable_v<shader> && std::is_trivially_copyable_v<vertex>
+        && std::is_trivially_copyable_v<lod_level> && std::is_trivially_copyable_v<object>);
+
+} // namespace gl_snapshot
+
+} // namespace lomegl
@@ -0,0 +1,129 @@
+#pragma once
+#include "lomegl/gl_base.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lomegl {
+
+// How the binding preconditions of lomegl are checked in builds with asserts enabled
+enum class gl_validation_mode
+{
+    shadow, // against the state cache of the current world, without any driver query(the default)
+    driver  // query the driver with glGet*, each check stalls the pipeline
+};
+
+struct gl_state_stats
+{
+    std::uint64_t issued = 0; // calls passed to OpenGL
+    std::uint64_t elided = 0; // calls skipped because the state was already set
+};
+
+// Shadow copy of the OpenGL binding and render state, calls which don't change anything are skipped.
+// Every bind of lomegl goes through the cache of the current world, see `get`.
+// State changed by OpenGL calls outside lomegl is not seen, call `invalidate` after them.
+// The state belongs to the context while the cache belongs to a world, so it's invalidated when the world is made current
+// after another one(or none) on the thread, see `gl_world::set_current_world`.
+// The shadow state is kept even when the cache is disabled, so it also serves the validation of lomegl.
+class gl_state_cache
+{
+public:
+    gl_state_cache() = default;
+    gl_state_cache(const gl_state_cache&) = delete;
+    gl_state_cache(gl_state_cache&&) = delete;
+    gl_state_cache& operator=(const gl_state_cache&) = delete;
+    gl_state_cache& operator=(gl_state_cache&&) = delete;
+
+    // The cache of the current world of the calling thread.
+    // Without a current world, a disabled instance of the thread which issues every call.
+    [[nodiscard]] static gl_state_cache& get() noexcept;
+
+    // A disabled cache issues every call but still records the state(enabled by default)
+    gl_state_cache& set_enabled(bool enable) noexcept;
+    [[nodiscard]] bool is_enabled() const noexcept;
+    // Forget the whole state, the next call of each kind is issued
+    gl_state_cache& invalidate() noexcept;
+    // Forget the bindings of deleted names, OpenGL unbinds them or may reuse the names.
+    // The deleters of lomegl do it, see `gl_delete_val`.
+    gl_state_cache& forget(gl_val_type type, GLsizei count, const unsigned int* names) noexcept;
+
+    gl_state_cache& use_program(GLuint program);
+    // The element array buffer binding is a state of the vao, so it's forgotten when the vao changes
+    gl_state_cache& bind_vertex_array(GLuint vao);
+    // Only GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER and GL_PIXEL_UNPACK_BUFFER are cached, other targets are always issued
+    gl_state_cache& bind_buffer(GLenum target, GLuint buffer);
+    // `unit` is GL_TEXTUREi
+    gl_state_cache& active_texture(GLenum unit);
+    // Bind to the active texture unit
+    gl_state_cache& bind_texture(GLenum target, GLuint texture);
+    // Only GL_BLEND, GL_DEPTH_TEST and GL_CULL_FACE are cached, other capabilities are always issued
+    gl_state_cache& set_capability(GLenum capability, bool enable);
+    gl_state_cache& blend_func(GLenum source_factor, GLenum destination_factor);
+    gl_state_cache& depth_func(GLenum func);
+    gl_state_cache& depth_mask(bool enable);
+    gl_state_cache& color_mask(bool red, bool green, bool blue, bool alpha);
+    gl_state_cache& cull_face(GLenum mode);
+    gl_state_cache& unpack_alignment(GLint alignment);
+
+    // Current render state, the driver is only queried while the state is unknown to the cache(and then recorded).
+    // So code which changes and restores a state doesn't stall the pipeline.
+    [[nodiscard]] bool is_capability_enabled(GLenum capability);
+    [[nodiscard]] bool get_depth_mask();
+    [[nodiscard]] std::array<bool, 4> get_color_mask();
+    [[nodiscard]] GLint get_unpack_alignment();
+    [[nodiscard]] GLuint get_unpack_buffer();
+    // Bound to the active texture unit, `target` must be one of the cached targets(not GL_TEXTURE_CUBE_MAP_POSITIVE_X...)
+    [[nodiscard]] GLuint get_texture_binding(GLenum target);
+
+    [[nodiscard]] const gl_state_stats& get_stats() const noexcept;
+    gl_state_cache& reset_stats() noexcept;
+
+    // Process wide, `gl_validation_mode::shadow` by default
+    static void set_validation_mode(gl_validation_mode mode) noexcept;
+    [[nodiscard]] static gl_validation_mode get_validation_mode() noexcept;
+    // Preconditions checked by the asserts of lomegl. A name must not be 0.
+    // In `gl_validation_mode::shadow` a binding which is unknown to the cache(e.g. after `invalidate`) passes.
+    [[nodiscard]] bool is_program_current(GLuint program) const;
+    [[nodiscard]] bool is_vertex_array_bound(GLuint vao) const;
+    // Only GL_ARRAY_BUFFER and GL_ELEMENT_ARRAY_BUFFER
+    [[nodiscard]] bool is_buffer_bound(GLenum target, GLuint buffer) const;
+    // Bound to the active texture unit
+    [[nodiscard]] bool is_texture_bound(GLenum target, GLuint texture) const;
+
+private:
+    static constexpr GLuint unknown_ = 0xFFFFFFFFU;
+    static constexpr std::size_t texture_target_count_ = 11;
+    using unit_bindings_ = std::array<GLuint, texture_target_count_>;
+
+    // Return true if `value` differs from the cached `state`(or the cache is disabled), and update it
+    [[nodiscard]] bool change_(GLuint& state, GLuint value) noexcept;
+    [[nodiscard]] static std::size_t texture_target_index_(GLenum target) noexcept;
+    [[nodiscard]] static std::size_t capability_index_(GLenum capability) noexcept;
+    // Compare a binding with the shadow state or the driver, see `gl_validation_mode`
+    [[nodiscard]] static bool check_binding_(GLuint state, GLenum pname, GLuint name);
+
+    static inline std::atomic<gl_validation_mode> validation_mode_ = gl_validation_mode::shadow;
+
+    bool enabled_ = true;
+    gl_state_stats stats_;
+    GLuint program_ = unknown_;
+    GLuint vao_ = unknown_;
+    GLuint array_buffer_ = unknown_;
+    GLuint element_buffer_ = unknown_;
+    GLuint unpack_buffer_ = unknown_;
+    GLuint active_unit_ = unknown_; // index, not GL_TEXTUREi
+    std::vector<unit_bindings_> textures_;
+    std::array<GLuint, 3> capabilities_ { unknown_, unknown_, unknown_ };
+    GLuint blend_source_ = unknown_;
+    GLuint blend_destination_ = unknown_;
+    GLuint depth_func_ = unknown_;
+    GLuint depth_mask_ = unknown_;
+    GLuint color_mask_ = unknown_; // one bit per channel
+    GLuint cull_face_ = unknown_;
+    GLuint unpack_alignment_ = unknown_;
+};
+
+} // namespace lomegl
@@ -1,6 +1,13 @@
 #pragma once
 
 #include "lomegl/gl_base.h"
+#include "lomegl/gl_memory.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace lomegl {
 
@@ -16,20 +23,81 @@ public:
 
     [[nodiscard]] const unique_texture& get_texture() const noexcept;
     [[nodiscard]] unique_texture& get_texture() noexcept;
+    [[nodiscard]] unsigned int get_texture_type() const noexcept;
+    // Whether the texture is edited with DSA, see `is_dsa_enabled`. Images still get mutable storage unless immutable storage
+    // is allocated first by `allocate_storage`, the calls without a DSA form restore the binding of the active unit after them.
+    [[nodiscard]] bool uses_dsa() const noexcept;
     gl_texture& active_texture_unit(unsigned int texture_unit);
     gl_texture& bind();
     gl_texture& tex_parameteri(unsigned int pname, int param);
+    // With DSA, allocate immutable storage of `levels` levels for a 2D texture, the images added later are uploaded into it
+    // without binding and must fit it. Use it for textures which keep their size and format, they can't be evicted.
+    // A base format(GL_RGBA...) is mapped to a sized one. Without DSA or for other targets it does nothing.
+    gl_texture& allocate_storage(int levels, int internal_format, int width, int height);
+    [[nodiscard]] bool has_immutable_storage() const noexcept;
     gl_texture& add_image_data_to(int level, int internal_format,
         int width, int height, int dummy, unsigned int data_format,
         unsigned int data_type, const void* image);
+    gl_texture& add_compressed_image_data_to(int level, unsigned int internal_format,
+        int width, int height, int image_size, const void* image);
     gl_texture& generate_mipmap();
 
+    // Estimated GPU memory of the images added(and the generated mipmaps), even if the texture is evicted
+    [[nodiscard]] std::size_t get_memory_size() const noexcept;
+    [[nodiscard]] bool is_resident() const noexcept;
+    // Copy the images to CPU memory(or to `spill_path` if it's not empty) and free their GPU storage.
+    // The texture object and its parameters are kept, without DSA the texture is bound.
+    // Only 2D textures without immutable storage can be evicted.
+    gl_texture& evict(const std::string& spill_path = {});
+    // Upload the evicted images again, without DSA the texture is bound
+    gl_texture& make_resident();
+    // Frame of `gl_world` in which the texture was last drawn, see `gl_world::trim_memory`
+    [[nodiscard]] std::uint64_t get_last_used_frame() const noexcept;
+    gl_texture& set_last_used_frame(std::uint64_t frame) noexcept;
+    // A pinned texture is never evicted by `gl_world::trim_memory`, e.g. a framebuffer attachment or a texture bound by hand(not pinned by default)
+    gl_texture& set_pinned(bool pinned) noexcept;
+    [[nodiscard]] bool is_pinned() const noexcept;
+    // Label the texture with `get_id()` for debuggers and profilers, see `gl_object_label`.
+    // A texture only exists in OpenGL once it's bound, so the label is attached by the next `bind`.
+    gl_texture& label_objects() noexcept;
+
 private:
+    // Parameters of an image added by `add_image_data_to` or `add_compressed_image_data_to`
+    struct level_
+    {
+        int internal_format = 0;
+        int width = 0; // 0 if the level is not added
+        int height = 0;
+        unsigned int data_format = 0; // 0 if the image is compressed
+        unsigned int data_type = 0;
+        int compressed_size = 0;
+    };
+
+    void set_level_(int level, const level_& info);
+    // Number of levels holding storage, including the generated mipmaps
+    [[nodiscard]] int storage_level_count_() const noexcept;
+
+    // Throw if the image doesn't fit the immutable storage
+    void check_storage_(int level, int internal_format, int width, int height) const;
+
     bool check_texture_bind_();
     [[nodiscard]] static constexpr unsigned int get_texture_pname_from_type_(unsigned int target_type);
+    [[nodiscard]] static unique_texture create_texture_(unsigned int texture_type, bool dsa);
 
+    bool dsa_ = false; // created by glCreateTextures, edited without binding
     unique_texture texture_;
     unsigned int texture_type_ = 0;
+    std::vector<level_> levels_;
+    bool has_mipmap_ = false;
+    bool resident_ = true;
+    gl_evicted_copy evicted_;
+    std::uint64_t last_used_frame_ = 0;
+    bool pinned_ = false;
+    int storage_levels_ = 0; // levels of the immutable storage, 0 if not allocated
+    int storage_format_ = 0;
+    int storage_width_ = 0;
+    int storage_height_ = 0;
+    bool label_pending_ = false;
 };
 
 } // namespace lomegl
\ No newline at end of file
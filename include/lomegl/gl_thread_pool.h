@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lomegl {
+
+// Fixed set of worker threads for data parallel CPU work, no OpenGL function may be called by the workers
+class gl_thread_pool
+{
+public:
+    // 0 workers runs everything on the calling thread
+    explicit gl_thread_pool(std::size_t worker_count = default_worker_count());
+    ~gl_thread_pool();
+    gl_thread_pool(const gl_thread_pool&) = delete;
+    gl_thread_pool(gl_thread_pool&&) = delete;
+    gl_thread_pool& operator=(const gl_thread_pool&) = delete;
+    gl_thread_pool& operator=(gl_thread_pool&&) = delete;
+
+    // Call `func(i)` for every i in [0, count), the calling thread takes part too.
+    // Return after all calls are done, the first exception thrown by `func` is rethrown.
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& func);
+
+    [[nodiscard]] std::size_t worker_count() const noexcept;
+    [[nodiscard]] static std::size_t default_worker_count() noexcept;
+
+private:
+    void worker_loop_();
+    void run_job_() noexcept;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(std::size_t)>* job_ = nullptr;
+    std::size_t job_count_ = 0;
+    std::atomic<std::size_t> next_index_ = 0;
+    std::size_t pending_workers_ = 0; // workers which have not finished the current job
+    std::uint64_t generation_ = 0;
+    std::exception_ptr error_;
+    bool stop_ = false;
+};
+
+} // namespace lomegl
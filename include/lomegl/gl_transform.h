@@ -0,0 +1,120 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace lomegl {
+
+// Instruction sets of the batched transform kernels
+enum class gl_simd_level
+{
+    scalar,
+    sse2, // 4 objects per batch
+    avx2  // 8 objects per batch
+};
+
+// Structure-of-arrays storage of object transforms.
+// Each `gl_object` is a view onto one slot, so updating the transforms of a whole world streams through contiguous arrays.
+// References returned by the accessors are invalidated when a new slot is allocated.
+//
+// A slot can have a parent slot, then its position and basis vectors are local to the parent(expressed along the parent's
+// right, up and front), and its matrices are world matrices. Scale is not inherited.
+class gl_transform_store
+{
+public:
+    static constexpr std::uint32_t npos = 0xFFFFFFFFU;
+
+    gl_transform_store() = default;
+    ~gl_transform_store() = default;
+    gl_transform_store(const gl_transform_store&) = delete;
+    gl_transform_store(gl_transform_store&&) = default;
+    gl_transform_store& operator=(const gl_transform_store&) = delete;
+    gl_transform_store& operator=(gl_transform_store&&) = default;
+
+    // Allocate a slot with identity transform, it is marked as transformed
+    std::uint32_t allocate();
+    // Allocate a slot and copy the transform of `slot` in `other` to it
+    std::uint32_t allocate_copy(const gl_transform_store& other, std::uint32_t slot);
+    void release(std::uint32_t slot) noexcept;
+    void copy(const gl_transform_store& other, std::uint32_t other_slot, std::uint32_t slot) noexcept;
+
+    // Set `parent` as the parent of `slot`, or detach it if `parent` is npos. Throw if it makes a cycle.
+    // The current transform of `slot` is kept as its local transform.
+    void set_parent(std::uint32_t slot, std::uint32_t parent);
+    [[nodiscard]] std::uint32_t get_parent(std::uint32_t slot) const noexcept
+    {
+        return parent_[slot];
+    }
+
+    // Update matrices of one slot if it or any of its ancestors is transformed
+    void update(std::uint32_t slot);
+    // Update matrices of every slot that is marked as transformed, in batches of 4/8 with the widest supported kernel.
+    // Children of transformed slots are updated too, in one pass over the depth-first order.
+    void update_all();
+
+    // The kernel level is detected from the CPU on first use, `set_simd_level` can only lower it
+    [[nodiscard]] static gl_simd_level get_simd_level() noexcept;
+    static void set_simd_level(gl_simd_level level) noexcept;
+
+    [[nodiscard]] bool is_transform(std::uint32_t slot) const noexcept
+    {
+        return ((dirty_[slot / 64] >> (slot % 64)) & 1U) != 0;
+    }
+
+    void mark_transform(std::uint32_t slot) noexcept
+    {
+        dirty_[slot / 64] |= (std::uint64_t { 1 } << (slot % 64));
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return pos_.size() - free_.size();
+    }
+
+    [[nodiscard]] glm::vec3& pos(std::uint32_t slot) noexcept { return pos_[slot]; }
+    [[nodiscard]] glm::vec3& front(std::uint32_t slot) noexcept { return front_[slot]; }
+    [[nodiscard]] glm::vec3& right(std::uint32_t slot) noexcept { return right_[slot]; }
+    [[nodiscard]] glm::vec3& up(std::uint32_t slot) noexcept { return up_[slot]; }
+    [[nodiscard]] glm::quat& rotate(std::uint32_t slot) noexcept { return rotate_[slot]; }
+    [[nodiscard]] glm::vec3& scale(std::uint32_t slot) noexcept { return scale_[slot]; }
+    [[nodiscard]] glm::mat4& model(std::uint32_t slot) noexcept { return model_[slot]; }
+    [[nodiscard]] glm::mat4& model_no_scale(std::uint32_t slot) noexcept { return model_no_scale_[slot]; }
+    [[nodiscard]] glm::mat4& view(std::uint32_t slot) noexcept { return view_[slot]; }
+
+private:
+    void clear_transform_(std::uint32_t slot) noexcept
+    {
+        dirty_[slot / 64] &= ~(std::uint64_t { 1 } << (slot % 64));
+    }
+
+    // Turn the local matrices of `slot` into world matrices
+    void apply_parent_(std::uint32_t slot) noexcept;
+    void rebuild_order_();
+
+    std::vector<glm::vec3> pos_;            // world cood
+    std::vector<glm::vec3> front_;          // object front
+    std::vector<glm::vec3> right_;          // object right
+    std::vector<glm::vec3> up_;             // object up
+    std::vector<glm::quat> rotate_;         // rotate quaternion
+    std::vector<glm::vec3> scale_;          // scale
+    std::vector<glm::mat4> model_no_scale_; // model matrix(local -> world), no scale
+    std::vector<glm::mat4> model_;          // model matrix(local -> world), with scale
+    std::vector<glm::mat4> view_;           // view matrix(world -> local), no scale
+    std::vector<std::uint64_t> dirty_;      // one bit per slot, set when the matrices are out of date
+    std::vector<std::uint32_t> free_;
+    std::vector<std::uint32_t> batch_; // dirty slots collected by update_all
+
+    std::vector<std::uint8_t> alive_;
+    std::vector<std::uint32_t> parent_;         // npos if the slot is a root
+    std::vector<std::uint32_t> child_count_;    // number of direct children
+    std::vector<std::uint32_t> version_;        // bumped every time the world matrices of the slot are updated
+    std::vector<std::uint32_t> parent_version_; // version of the parent when the slot was updated
+    std::vector<std::uint32_t> order_;          // live slots in depth-first order, parents before children
+    std::size_t parent_count_ = 0;              // number of slots that have a parent
+    bool order_dirty_ = true;
+};
+
+} // namespace lomegl
@@ -0,0 +1,223 @@
+#pragma once
+#include <glad/glad.h>
+
+#include "lomegl/gl_base.h"
+#include "lomegl/gl_exception.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace lomegl {
+
+class gl_shader;
+
+// A uniform of the default block of a linked `gl_shader`, resolved once by `gl_shader::find_uniform`.
+// It indexes the reflected resource table of the shader, so setting a value doesn't look anything up.
+template <typename T>
+class gl_uniform_slot
+{
+    friend class gl_shader;
+
+public:
+    static constexpr std::uint32_t invalid_index = 0xFFFFFFFFU;
+
+    gl_uniform_slot() = default;
+
+    [[nodiscard]] bool is_valid() const noexcept
+    {
+        return index_ != invalid_index;
+    }
+
+    [[nodiscard]] std::uint32_t get_index() const noexcept
+    {
+        return index_;
+    }
+
+    // The program which resolved the slot, a slot only indexes the resources of that program
+    [[nodiscard]] unsigned int get_program() const noexcept
+    {
+        return program_;
+    }
+
+private:
+    gl_uniform_slot(std::uint32_t index, unsigned int program) noexcept : index_(index), program_(program) { }
+
+    std::uint32_t index_ = invalid_index;
+    unsigned int program_ = 0;
+};
+
+// Uploads through `gl_shader::set_uniform`
+struct gl_uniform_stats
+{
+    std::uint64_t issued = 0;  // calls passed to OpenGL
+    std::uint64_t skipped = 0; // calls skipped because the program already holds the value
+};
+
+// Samplers and images, they're set from an int like glUniform1i
+constexpr bool is_opaque_uniform_type(GLenum type) noexcept
+{
+    return (type >= GL_SAMPLER_1D && type <= GL_SAMPLER_2D_RECT_SHADOW)
+        || (type >= GL_SAMPLER_1D_ARRAY && type <= GL_SAMPLER_CUBE_SHADOW)
+        || (type >= GL_INT_SAMPLER_1D && type <= GL_UNSIGNED_INT_SAMPLER_BUFFER)
+        || (type >= GL_SAMPLER_CUBE_MAP_ARRAY && type <= GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY)
+        || (type >= GL_SAMPLER_2D_MULTISAMPLE && type <= GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY)
+        || (type >= GL_IMAGE_1D && type <= GL_UNSIGNED_INT_IMAGE_2D_MULTISAMPLE_ARRAY);
+}
+
+// Whether a uniform of the reflected GLSL `type` can be set from values of `T`
+template <typename T>
+constexpr bool is_uniform_type_of(GLenum type) noexcept
+{
+    if constexpr (std::is_same_v<T, float>)
+        return type == GL_FLOAT;
+    else if constexpr (std::is_same_v<T, glm::vec2>)
+        return type == GL_FLOAT_VEC2;
+    else if constexpr (std::is_same_v<T, glm::vec3>)
+        return type == GL_FLOAT_VEC3;
+    else if constexpr (std::is_same_v<T, glm::vec4>)
+        return type == GL_FLOAT_VEC4;
+    else if constexpr (std::is_same_v<T, int>)
+        return type == GL_INT || type == GL_BOOL || is_opaque_uniform_type(type);
+    else if constexpr (std::is_same_v<T, glm::ivec2>)
+        return type == GL_INT_VEC2 || type == GL_BOOL_VEC2;
+    else if constexpr (std::is_same_v<T, glm::ivec3>)
+        return type == GL_INT_VEC3 || type == GL_BOOL_VEC3;
+    else if constexpr (std::is_same_v<T, glm::ivec4>)
+        return type == GL_INT_VEC4 || type == GL_BOOL_VEC4;
+    else if constexpr (std::is_same_v<T, unsigned int>)
+        return type == GL_UNSIGNED_INT;
+    else if constexpr (std::is_same_v<T, glm::uvec2>)
+        return type == GL_UNSIGNED_INT_VEC2;
+    else if constexpr (std::is_same_v<T, glm::uvec3>)
+        return type == GL_UNSIGNED_INT_VEC3;
+    else if constexpr (std::is_same_v<T, glm::uvec4>)
+        return type == GL_UNSIGNED_INT_VEC4;
+    else if constexpr (std::is_same_v<T, glm::mat2>)
+        return type == GL_FLOAT_MAT2;
+    else if constexpr (std::is_same_v<T, glm::mat3>)
+        return type == GL_FLOAT_MAT3;
+    else if constexpr (std::is_same_v<T, glm::mat4>)
+        return type == GL_FLOAT_MAT4;
+    else
+        static_assert(!std::is_same_v<T, T>, "T must be float, int, unsigned int, or a glm vector or square matrix of them");
+}
+
+// Bytes of one value of the reflected GLSL `type` as `upload_uniform` reads it, 0 for the types it doesn't upload
+constexpr std::size_t get_uniform_type_size(GLenum type) noexcept
+{
+    switch (type)
+    {
+    case GL_FLOAT:
+    case GL_INT:
+    case GL_BOOL:
+    case GL_UNSIGNED_INT:
+        return 4;
+    case GL_FLOAT_VEC2:
+    case GL_INT_VEC2:
+    case GL_BOOL_VEC2:
+    case GL_UNSIGNED_INT_VEC2:
+        return 8;
+    case GL_FLOAT_VEC3:
+    case GL_INT_VEC3:
+    case GL_BOOL_VEC3:
+    case GL_UNSIGNED_INT_VEC3:
+        return 12;
+    case GL_FLOAT_VEC4:
+    case GL_INT_VEC4:
+    case GL_BOOL_VEC4:
+    case GL_UNSIGNED_INT_VEC4:
+    case GL_FLOAT_MAT2:
+        return 16;
+    case GL_FLOAT_MAT3:
+        return 36;
+    case GL_FLOAT_MAT4:
+        return 64;
+    default:
+        return is_opaque_uniform_type(type) ? 4 : 0;
+    }
+}
+
+// Compare the bytes of two uniform values, with SSE2 from 16 bytes on(a mat4 is 4 compares)
+[[nodiscard]] bool uniform_value_equal(const void* lhs, const void* rhs, std::size_t size) noexcept;
+
+// Upload `count` values to `location` of `program`. With DSA(see `is_dsa_enabled`) it's done by glProgramUniform*,
+// otherwise by glUniform* and `program` must be current.
+template <typename T>
+void upload_uniform(GLuint program, GLint location, GLsizei count, const T* values)
+{
+    if (is_dsa_enabled())
+    {
+        if constexpr (std::is_same_v<T, float>)
+            lomeglcall(glProgramUniform1fv, program, location, count, values);
+        else if constexpr (std::is_same_v<T, glm::vec2>)
+            lomeglcall(glProgramUniform2fv, program, location, count, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, glm::vec3>)
+            lomeglcall(glProgramUniform3fv, program, location, count, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, glm::vec4>)
+            lomeglcall(glProgramUniform4fv, program, location, count, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, int>)
+            lomeglcall(glProgramUniform1iv, program, location, count, values);
+        else if constexpr (std::is_same_v<T, glm::ivec2>)
+            lomeglcall(glProgramUniform2iv, program, location, count, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, glm::ivec3>)
+            lomeglcall(glProgramUniform3iv, program, location, count, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, glm::ivec4>)
+            lomeglcall(glProgramUniform4iv, program, location, count, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, unsigned int>)
+            lomeglcall(glProgramUniform1uiv, program, location, count, values);
+        else if constexpr (std::is_same_v<T, glm::uvec2>)
+            lomeglcall(glProgramUniform2uiv, program, location, count, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, glm::uvec3>)
+            lomeglcall(glProgramUniform3uiv, program, location, count, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, glm::uvec4>)
+            lomeglcall(glProgramUniform4uiv, program, location, count, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, glm::mat2>)
+            lomeglcall(glProgramUniformMatrix2fv, program, location, count, GL_FALSE, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, glm::mat3>)
+            lomeglcall(glProgramUniformMatrix3fv, program, location, count, GL_FALSE, glm::value_ptr(*values));
+        else if constexpr (std::is_same_v<T, glm::mat4>)
+            lomeglcall(glProgramUniformMatrix4fv, program, location, count, GL_FALSE, glm::value_ptr(*values));
+        else
+            static_assert(!std::is_same_v<T, T>, "T must be float, int, unsigned int, or a glm vector or square matrix of them");
+        return;
+    }
+
+    if constexpr (std::is_same_v<T, float>)
+        lomeglcall(glUniform1fv, location, count, values);
+    else if constexpr (std::is_same_v<T, glm::vec2>)
+        lomeglcall(glUniform2fv, location, count, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, glm::vec3>)
+        lomeglcall(glUniform3fv, location, count, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, glm::vec4>)
+        lomeglcall(glUniform4fv, location, count, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, int>)
+        lomeglcall(glUniform1iv, location, count, values);
+    else if constexpr (std::is_same_v<T, glm::ivec2>)
+        lomeglcall(glUniform2iv, location, count, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, glm::ivec3>)
+        lomeglcall(glUniform3iv, location, count, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, glm::ivec4>)
+        lomeglcall(glUniform4iv, location, count, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, unsigned int>)
+        lomeglcall(glUniform1uiv, location, count, values);
+    else if constexpr (std::is_same_v<T, glm::uvec2>)
+        lomeglcall(glUniform2uiv, location, count, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, glm::uvec3>)
+        lomeglcall(glUniform3uiv, location, count, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, glm::uvec4>)
+        lomeglcall(glUniform4uiv, location, count, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, glm::mat2>)
+        lomeglcall(glUniformMatrix2fv, location, count, GL_FALSE, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, glm::mat3>)
+        lomeglcall(glUniformMatrix3fv, location, count, GL_FALSE, glm::value_ptr(*values));
+    else if constexpr (std::is_same_v<T, glm::mat4>)
+        lomeglcall(glUniformMatrix4fv, location, count, GL_FALSE, glm::value_ptr(*values));
+    else
+        static_assert(!std::is_same_v<T, T>, "T must be float, int, unsigned int, or a glm vector or square matrix of them");
+}
+
+} // namespace lomegl
@@ -21,6 +21,7 @@ struct image_data
     image_info info;
 };
 
+// These functions are thread safe, the flip flag is per thread
 std::string get_content_from_file(const char* path);
 
 image_data get_image_from_file(const char* path, bool flip_vertically = true);
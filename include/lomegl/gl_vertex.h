@@ -1,14 +1,33 @@
 #pragma once
 #include "lomegl/gl_base.h"
+#include "lomegl/gl_bounds.h"
+#include "lomegl/gl_memory.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
 
 namespace lomegl {
 
+// An attribute sourced from the vbo, as given to `gl_vertex::vertex_attrib_pointer`
+struct gl_vertex_attrib
+{
+    GLuint index = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    GLboolean normalized = GL_FALSE;
+    GLsizei stride = 0;
+    std::uintptr_t offset = 0;
+    bool enabled = false;
+};
+
 // The class which manage how vertex array data input to vertex shader.
 class gl_vertex : public string_id
 {
 public:
     gl_vertex();
-    ~gl_vertex();
+    virtual ~gl_vertex();
     gl_vertex(const gl_vertex&) = delete;
     gl_vertex(gl_vertex&&) = default;
     gl_vertex& operator=(const gl_vertex&) = delete;
@@ -21,25 +40,75 @@ public:
     [[nodiscard]] bool is_ebo_binded() const noexcept;
     [[nodiscard]] int ebo_counts() const noexcept;
     [[nodiscard]] int vbo_counts() const noexcept;
+    // Whether the objects are edited with DSA, see `is_dsa_enabled`
+    [[nodiscard]] bool uses_dsa() const noexcept;
+    // Local bounds used for culling, empty if unknown
+    [[nodiscard]] const gl_bounds& get_bounds() const noexcept;
+    gl_vertex& set_bounds(const gl_bounds& bounds) noexcept;
 
-    // Before any operation, call this function
+    // Bind the vao for drawing. Without DSA(see `is_dsa_enabled`), call it before any other operation.
     gl_vertex& bind_this();
     gl_vertex& bind_elemnt_buffer_data(const void* ebo_data, GLsizeiptr size, GLenum usage, int elemnt_counts);
-    gl_vertex& bind_array_buffer_data(const void* vbo_data, GLsizeiptr size, GLenum usage, int vertex_counts);
+    // If `position_stride` is not 0, the bounds are computed from the vec3 position at the beginning of every `position_stride` bytes
+    gl_vertex& bind_array_buffer_data(const void* vbo_data, GLsizeiptr size, GLenum usage, int vertex_counts, GLsizei position_stride = 0);
     gl_vertex& vertex_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* start_offset);
     gl_vertex& enable_vertex_attrib_array(GLuint index);
+    // Attributes set by `vertex_attrib_pointer`, ordered by index
+    [[nodiscard]] const std::vector<gl_vertex_attrib>& get_attribs() const noexcept;
+
+    // Upload `count` column-major 4x4 matrices to the per-instance buffer, and make it feed the mat4 attribute at `location`
+    // (which takes `location` to `location + 3`) with divisor 1. The array buffer binding is restored to the vbo.
+    gl_vertex& upload_instance_models(const float* models, int count, GLuint location);
+
+    // GPU memory of the vbo and ebo given to the functions above, even if the vertex is evicted.
+    // The per-instance buffer is not counted.
+    [[nodiscard]] std::size_t get_memory_size() const noexcept;
+    [[nodiscard]] bool is_resident() const noexcept;
+    // Copy the vbo and ebo to CPU memory(or to `spill_path` if it's not empty) and free their GPU storage.
+    // The buffer objects and the attribute layout are kept. Without DSA the vao is bound.
+    gl_vertex& evict(const std::string& spill_path = {});
+    // Upload the evicted buffers again, without DSA the vao is bound
+    gl_vertex& make_resident();
+    // Frame of `gl_world` in which the vertex was last drawn, see `gl_world::trim_memory`
+    [[nodiscard]] std::uint64_t get_last_used_frame() const noexcept;
+    gl_vertex& set_last_used_frame(std::uint64_t frame) noexcept;
+    // A pinned vertex is never evicted by `gl_world::trim_memory`, e.g. a vertex drawn by hand(not pinned by default)
+    gl_vertex& set_pinned(bool pinned) noexcept;
+    [[nodiscard]] bool is_pinned() const noexcept;
+    // Label the vao, vbo(`.vbo`) and ebo(`.ebo`) with `get_id()` for debuggers and profilers, see `gl_object_label`.
+    // The objects only exist in OpenGL once they're bound, so they're labeled by the next `bind_this` or upload.
+    gl_vertex& label_objects() noexcept;
 
 private:
     bool check_vao_bind_();
     bool check_vbo_bind_();
+    gl_vertex_attrib& find_attrib_(GLuint index);
+    // Disable the per-instance attributes at `instance_loc_` and reset their divisors
+    void reset_instance_attribs_();
 
     unique_vao VAO_;
     unique_vbo VBO_;
     unique_ebo EBO_;
+    unique_vbo instance_VBO_; // created on first upload_instance_models
+    GLsizeiptr instance_capacity_ = 0;
+    GLint instance_loc_ = -1;
     bool is_vbo_binded_ = false;
     bool is_ebo_binded_ = false;
     int ebo_counts_ = 0;
     int vbo_counts_ = 0;
+    GLsizeiptr vbo_size_ = 0;
+    GLsizeiptr ebo_size_ = 0;
+    GLenum vbo_usage_ = GL_STATIC_DRAW;
+    GLenum ebo_usage_ = GL_STATIC_DRAW;
+    bool resident_ = true;
+    gl_evicted_copy evicted_;
+    std::uint64_t last_used_frame_ = 0;
+    bool pinned_ = false;
+    bool labeled_ = false;
+    bool label_pending_ = false; // the vao isn't labeled yet
+    gl_bounds bounds_;
+    std::vector<gl_vertex_attrib> attribs_;
+    bool dsa_ = false; // created by glCreate*, edited without binding
 };
 
 } // namespace lomegl
\ No newline at end of file
@@ -1,18 +1,39 @@
 #pragma once
 
+#include "lomegl/gl_atom.h"
+#include "lomegl/gl_bounds.h"
+#include "lomegl/gl_bvh.h"
+#include "lomegl/gl_debug.h"
+#include "lomegl/gl_deletion_queue.h"
+#include "lomegl/gl_flat_map.h"
 #include "lomegl/gl_fwd.h"
+#include "lomegl/gl_handle.h"
+#include "lomegl/gl_state_cache.h"
+#include "lomegl/gl_transform.h"
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <lotools/utility.h>
 
 namespace lomegl {
+
+struct gl_ray_hit
+{
+    gl_handle<gl_object> object;
+    float distance; // to the bounding box of the object
+};
+
 class gl_world
 {
 public:
@@ -22,139 +43,399 @@ public:
     gl_world& operator=(const gl_world&) = delete;
     gl_world& operator=(gl_world&&) = delete;
 
-    // Create a world instance, and set it to current world. **Only one instance is allowd at the same time!!**.
+    // Create a world instance, and set it to the current world of the calling thread.
+    // Any number of worlds can live at the same time, e.g. one per OpenGL context. A world is not thread safe,
+    // and its OpenGL objects belong to the context which was current when they were created.
     // Note that the lifetime of `gl_world` should be smaller than the lifetime of OpenGL.
     // If you use GLFW, make sure to destroy the `gl_world` instance before the GLFW is destroyed.
     // This is because `gl_world` need to call the OpengL function to destroy the internal OpenGL object.
     static std::unique_ptr<gl_world> make_world()
     {
-        assert(get_current_world_() == nullptr);
         auto new_world = std::unique_ptr<gl_world>(new gl_world);
         get_current_world_() = new_world.get();
         return new_world;
     }
 
+    // The current world is per thread, it's used by the APIs which don't take a world explicitly
     static gl_world* get_current_world() noexcept
     {
         return get_current_world_();
     }
 
-    gl_world& set_current_camera(const char* obj_name);
+    // Pass nullptr to clear the current world of the calling thread.
+    // A world destroyed while current on other threads leaves them dangling, clear it there first.
+    // Switching to another world invalidates its state cache, the context may have been changed through the other world.
+    static void set_current_world(gl_world* world) noexcept
+    {
+        auto*& current = get_current_world_();
+        if (world != nullptr && world != current)
+            world->state_cache_.invalidate();
+        current = world;
+        if (world != nullptr)
+            world->deletion_queue_.delete_released_();
+    }
+
+    gl_world& make_current() noexcept
+    {
+        set_current_world(this);
+        return *this;
+    }
+
+    gl_world& set_current_camera(gl_name obj_name);
+    gl_world& set_current_camera(gl_handle<gl_object> obj);
     gl_world& set_screen_size(int width, int height) noexcept;
     [[nodiscard]] gl_shader& get_current_shader();
     [[nodiscard]] gl_object& get_current_camera();
     [[nodiscard]] std::string get_current_shader_name() noexcept;
     [[nodiscard]] std::string get_current_camera_name() noexcept;
+    [[nodiscard]] gl_handle<gl_shader> get_current_shader_handle() const noexcept;
+    [[nodiscard]] gl_handle<gl_object> get_current_camera_handle() const noexcept;
     [[nodiscard]] std::pair<int, int> get_screen_size() noexcept;
     [[nodiscard]] int get_screen_width() const noexcept;
     [[nodiscard]] int get_screen_height() const noexcept;
     gl_world& set_current_shader_view_mat();
     gl_world& set_current_shader_projection_mat(float fov = 45.0F, float near = 0.1F, float far = 100.0F);
-    gl_world& use_shader(const char* shader_name);
+    // The last matrices passed by the two functions above
+    [[nodiscard]] const glm::mat4& get_view_mat() const noexcept;
+    [[nodiscard]] const glm::mat4& get_projection_mat() const noexcept;
+
+    // The frustum of the last view and projection matrices, only valid after both of them are set
+    [[nodiscard]] bool has_frustum() const noexcept;
+    [[nodiscard]] const gl_frustum& get_frustum() const noexcept;
+    // Entities are culled against the frustum when drawn(disabled by default).
+    // Enable it only if entities are drawn with the view and projection matrices set through the world.
+    gl_world& set_frustum_culling_enabled(bool enable) noexcept;
+    [[nodiscard]] bool is_frustum_culling_enabled() const noexcept;
+    // False only if culling is active and the world bounds of `entity` are outside of the frustum or occluded
+    [[nodiscard]] bool is_visible(gl_entity& entity);
+
+    // CPU occlusion culling(disabled by default), see `gl_occlusion_culler`.
+    // Call `update_occlusion` once per frame after the view and projection matrices are set.
+    gl_world& set_occlusion_culling_enabled(bool enable, int width = 256, int height = 128);
+    // nullptr if occlusion culling is disabled
+    [[nodiscard]] gl_occlusion_culler* get_occlusion_culler() noexcept;
+    // Rasterize `mesh` at the transform of `entity` as an occluder, removed entities are dropped automatically
+    gl_world& add_occluder(gl_handle<gl_object> entity, std::shared_ptr<const gl_occluder_mesh> mesh);
+    gl_world& remove_occluder(gl_handle<gl_object> entity);
+    // Rasterize the occluders inside the frustum into the depth buffer of the culler
+    gl_world& update_occlusion();
+    gl_world& use_shader(gl_name shader_name);
+    gl_world& use_shader(gl_handle<gl_shader> shader);
+
+    // Objects created after enabled store their transforms in the world's `gl_transform_store`(enabled by default)
+    gl_world& set_transform_store_enabled(bool enable) noexcept;
+    // Update the matrices of every transformed object in the world's store
+    gl_world& update_all_transforms();
+    [[nodiscard]] gl_transform_store& get_transform_store() noexcept;
+
+    // Spatial index over the entities which have bounds, see `gl_entity::get_bounds`.
+    // Static entities are in a SAH tree, the others in a tree refitted by `update_spatial_index`.
+    // It's rebuilt lazily after objects are created or removed, or explicitly by `rebuild_spatial_index`.
+    gl_world& rebuild_spatial_index();
+    // Refit the tree of dynamic entities to their current transforms, call it once per frame before queries
+    gl_world& update_spatial_index();
+    [[nodiscard]] std::vector<gl_handle<gl_object>> query_objects(const gl_frustum& frustum);
+    [[nodiscard]] std::vector<gl_handle<gl_object>> query_objects(const gl_aabb& box);
+    // The nearest entity whose bounding box is hit by the ray
+    [[nodiscard]] std::optional<gl_ray_hit> raycast(const glm::vec3& origin, const glm::vec3& direction,
+        float max_distance = std::numeric_limits<float>::max());
+    // Cast a ray from the current view through a point of the screen(in pixels, origin at top left), for mouse picking
+    [[nodiscard]] std::optional<gl_ray_hit> pick(float screen_x, float screen_y);
+
+    // Write every texture, shader, vertex and object of the world to one binary file, see `gl_snapshot`.
+    // Buffers and textures are read back from OpenGL, programs are saved as driver binaries along with their sources.
+    // Only 2D textures are supported, objects of derived types are saved as `gl_object` or `gl_entity`,
+    // and a `gl_mesh_pool` is saved as a plain vertex holding its buffers.
+    gl_world& save_snapshot(const std::string& path);
+    // Create the resources of a snapshot in this world, their names must not exist yet.
+    // The file is mapped, and buffers and pixels are uploaded straight from the mapping.
+    // A program binary rejected by the driver falls back to compiling the saved sources.
+    gl_world& load_snapshot(const std::string& path);
+
+    // Limit the GPU memory of the textures and vertices to `bytes`, 0 is unlimited(the default).
+    // `trim_memory` evicts the least recently drawn ones over the budget to CPU memory, or to files in `spill_directory` if it's not empty.
+    // Evicted resources are uploaded again when they're drawn by `gl_entity::draw` or pushed to a `gl_render_queue`.
+    gl_world& set_memory_budget(std::size_t bytes, std::string spill_directory = {});
+    [[nodiscard]] std::size_t get_memory_budget() const noexcept;
+    // GPU memory of the resident textures and vertices
+    [[nodiscard]] std::size_t get_resident_memory() const;
+    // Call it once per frame after drawing, it evicts resources until the budget is met and then calls `next_frame`.
+    // Resources used in the current frame or pinned(see `gl_texture::set_pinned`) are never evicted,
+    // so the budget may be exceeded by a single frame's working set.
+    gl_world& trim_memory();
+    // Start a new frame, call it once per frame after drawing unless `trim_memory` is called.
+    // Per frame progress such as LOD fades advances at most once per frame, however many passes draw an entity.
+    gl_world& next_frame() noexcept;
+    [[nodiscard]] std::uint64_t get_frame() const noexcept;
+    // Mark a resource as used in the current frame, and upload it again if it's evicted.
+    // Call it for resources used outside `gl_entity::draw` and `gl_render_queue`, or pin them.
+    gl_world& use_resource(gl_texture& texture);
+    gl_world& use_resource(gl_vertex& vertex);
+
+    // Deletion of the OpenGL names created while this world is current, deferred to `end_frame` if enabled(disabled by default).
+    // When enabled, call `end_frame` of the queue once per frame.
+    [[nodiscard]] gl_deletion_queue& get_deletion_queue() noexcept;
+    // Shadow of the OpenGL state of the context of this world, binds of lomegl skip the calls which change nothing
+    [[nodiscard]] gl_state_cache& get_state_cache() noexcept;
+    // Debug output of the context of this world, not installed by default
+    [[nodiscard]] gl_debug_output& get_debug_output() noexcept;
 
     template <typename T, typename... Args>
-    constexpr auto& create(const char* obj_name, Args&&... args)
+    constexpr auto& create(gl_name obj_name, Args&&... args)
     {
-        auto* map = get_map_from_derived_type_<T>();
+        return get(create_handle<T>(obj_name, std::forward<Args>(args)...));
+    }
 
-        assert(map->find(obj_name) == map->cend());
-        auto&& item = map->emplace(obj_name, std::make_shared<T>(std::forward<Args>(args)...));
-        if (!item.second)
-            throw std::runtime_error(std::string("emplace texture ") + obj_name + " fails!");
-        item.first->second->set_id(obj_name);
-        return static_cast<T&>(*item.first->second.get());
+    // Same as `create`, but return a handle of the new resource.
+    // A handle stays valid until the resource is removed, use it to avoid looking up the name every frame.
+    template <typename T, typename... Args>
+    gl_handle<T> create_handle(gl_name obj_name, Args&&... args)
+    {
+        auto* registry = get_registry_from_derived_type_<T>();
+        auto atom = gl_atom_table::intern(obj_name);
+
+        assert(!registry->names.contains(atom));
+        if (registry->names.contains(atom))
+            throw std::runtime_error(std::string("emplace ") + obj_name.str + " fails!");
+
+        std::shared_ptr<T> new_obj;
+        if constexpr (std::is_base_of_v<gl_object, T>)
+        {
+            // The slot is allocated in the store of the world, no store of its own is created
+            typename T::store_scope_ scope(transform_store_enabled_ ? &transforms_ : nullptr);
+            new_obj = std::make_shared<T>(std::forward<Args>(args)...);
+        }
+        else
+            new_obj = std::make_shared<T>(std::forward<Args>(args)...);
+        new_obj->set_id(atom);
+        if constexpr (!std::is_base_of_v<gl_object, T>)
+            new_obj->label_objects();
+        if constexpr (std::is_base_of_v<gl_object, T>)
+        {
+            if (transform_store_enabled_)
+                new_obj->attach_transform_store_(transforms_);
+            spatial_index_dirty_ = true;
+        }
+        // A resource isn't evicted before it's drawn for the first time
+        if constexpr (std::is_base_of_v<gl_texture, T> || std::is_base_of_v<gl_vertex, T>)
+            new_obj->set_last_used_frame(frame_);
+        auto handle = registry->slots.insert(std::move(new_obj));
+        registry->names.emplace(atom, handle.value());
+        return handle;
+    }
+
+    // Resolve a name to a handle, throw if the name is not exists or the resource is not a `T`
+    template <typename T>
+    [[nodiscard]] gl_handle<T> get_handle(gl_name obj_name) const
+    {
+        const auto* registry = get_registry_from_derived_type_<T>();
+        const auto* result = find_name_<T>(obj_name);
+
+        if (result == nullptr)
+            throw std::runtime_error(std::string("Can't find key ") + obj_name.str);
+
+        if constexpr (!is_base_type_<T>())
+        {
+            if (dynamic_cast<T*>(registry->slots.get(*result)) == nullptr)
+                throw std::runtime_error(std::string("Wrong type of key ") + obj_name.str);
+        }
+        return gl_handle<T>::from_value(*result);
     }
 
     // For safety purposes, this function should be used only for a short period of time to use the resource
     // and to ensure that no resources are deleted within the scope of use.
     // To keep a long period reference to a resource, it is highly recommended to set `safety_ref` to true.
     template <typename T, bool safety_ref = false>
-    [[nodiscard]] constexpr decltype(auto) get(const char* obj_name)
+    [[nodiscard]] constexpr decltype(auto) get(gl_name obj_name)
     {
-        auto* map = get_map_from_derived_type_<T>();
-        auto&& result = map->find(obj_name);
+        const auto* registry = get_registry_from_derived_type_<T>();
+        const auto* result = find_name_<T>(obj_name);
+
+        if (result == nullptr)
+            throw std::runtime_error(std::string("Can't find key ") + obj_name.str);
 
-        if (result == map->cend())
-            throw std::runtime_error(std::string("Can't find key ") + obj_name);
+        const auto& item = registry->slots.get_shared(*result);
 
         // If T equal to base_type, then the type conversion is not necessary
-        using TestType = lot::any_type_true_t<true, std::is_same, T, gl_texture, gl_shader, gl_vertex, gl_object>;
-        if constexpr (std::is_same_v<TestType, void>) // derived
+        if constexpr (!is_base_type_<T>()) // derived
         {
             if constexpr (safety_ref)
-                return std::weak_ptr { std::dynamic_pointer_cast<T>(result->second) };
+                return std::weak_ptr { std::dynamic_pointer_cast<T>(item) };
             else
-                return *(dynamic_cast<T*>(result->second.get()));
+                return *(dynamic_cast<T*>(item.get()));
 
         } else {
             if constexpr (safety_ref)
-                return std::weak_ptr { result->second };
+                return std::weak_ptr { item };
             else
-                return *(result->second.get());
+                return *(item.get());
         }
     }
 
+    // Throw if the handle is null or stale(the resource has been removed)
+    template <typename T, bool safety_ref = false>
+    [[nodiscard]] constexpr decltype(auto) get(gl_handle<T> handle)
+    {
+        const auto* registry = get_registry_from_derived_type_<T>();
+        const auto& item = registry->slots.get_shared(handle.value());
+
+        if (!item) [[unlikely]]
+            throw std::runtime_error("Handle is null or stale");
+
+        // The handle was checked when it was created, so static_cast is enough
+        if constexpr (safety_ref)
+            return std::weak_ptr { std::static_pointer_cast<T>(item) };
+        else
+            return static_cast<T&>(*item);
+    }
+
+    template <typename T>
+    constexpr auto remove(gl_name obj_name)
+    {
+        auto* registry = get_registry_from_derived_type_<T>();
+        auto atom = gl_atom_table::find(obj_name);
+        const auto* result = registry->names.find(atom);
+        if (atom == gl_atom_table::invalid_atom || result == nullptr)
+            return static_cast<std::size_t>(0);
+
+        registry->slots.erase(*result);
+        registry->names.erase(atom);
+        if constexpr (std::is_base_of_v<gl_object, T>)
+            spatial_index_dirty_ = true;
+        return static_cast<std::size_t>(1);
+    }
+
+    template <typename T>
+    constexpr bool remove(gl_handle<T> handle)
+    {
+        auto* registry = get_registry_from_derived_type_<T>();
+        auto* item = registry->slots.get(handle.value());
+        if (item == nullptr)
+            return false;
+
+        registry->names.erase(item->get_atom());
+        if constexpr (std::is_base_of_v<gl_object, T>)
+            spatial_index_dirty_ = true;
+        return registry->slots.erase(handle.value());
+    }
+
     template <typename T>
-    constexpr auto remove(const char* obj_name)
+    [[nodiscard]] constexpr bool exists(gl_name obj_name) const
     {
-        auto* map = get_map_from_derived_type_<T>();
-        return map->erase(obj_name);
+        return find_name_<T>(obj_name) != nullptr;
     }
 
+    // Same as `exists(gl_name)` with the atom of the name, nothing is hashed
     template <typename T>
-    [[nodiscard]] constexpr bool exists(const char* obj_name) const
+    [[nodiscard]] constexpr bool exists_atom(std::uint32_t atom) const noexcept
     {
-        auto* map = get_map_from_derived_type_<T>();
-        return map->contains(obj_name);
+        return get_registry_from_derived_type_<T>()->names.contains(atom);
+    }
+
+    // Return false if the handle is null or stale
+    template <typename T>
+    [[nodiscard]] constexpr bool exists(gl_handle<T> handle) const noexcept
+    {
+        const auto* registry = get_registry_from_derived_type_<T>();
+        return registry->slots.contains(handle.value());
     }
 
 private:
     gl_world();
 
+    void ensure_spatial_index_();
+
     static gl_world*& get_current_world_() noexcept
     {
-        static gl_world* current_world_ = nullptr; // NOLINT
+        thread_local gl_world* current_world_ = nullptr; // NOLINT
         return current_world_;
     }
 
+    // Resources of one base type, the name is a thin layer to the handle
+    template <typename T>
+    struct registry_
+    {
+        gl_slot_map<T> slots;
+        gl_flat_map<std::uint32_t, std::uint32_t> names; // atom -> handle value
+    };
+
+    // Return the handle value of the name, or nullptr if the name is not exists
+    template <typename T>
+    [[nodiscard]] const std::uint32_t* find_name_(gl_name obj_name) const noexcept
+    {
+        auto atom = gl_atom_table::find(obj_name);
+        if (atom == gl_atom_table::invalid_atom)
+            return nullptr;
+        return get_registry_from_derived_type_<T>()->names.find(atom);
+    }
+
+    template <typename T>
+    static constexpr bool is_base_type_() noexcept
+    {
+        using TestType = lot::any_type_true_t<true, std::is_same, T, gl_texture, gl_shader, gl_vertex, gl_object>;
+        return !std::is_same_v<TestType, void>;
+    }
+
     template <typename T>
-    constexpr auto* get_map_from_derived_type_() const noexcept
+    constexpr auto* get_registry_from_derived_type_() const noexcept
     {
         using BaseType = lot::any_type_true_t<false, std::is_base_of, T, gl_texture, gl_shader, gl_vertex, gl_object>;
         static_assert(!std::is_same_v<BaseType, void>, "T must be or derived from gl_texture, gl_shader, gl_vertex, or gl_object");
 
-        const std::unordered_map<std::string, std::shared_ptr<BaseType>>* map = nullptr;
+        const registry_<BaseType>* registry = nullptr;
         if constexpr (std::is_base_of_v<gl_texture, T>)
         {
-            map = &texture_;
+            registry = &texture_;
         } else if constexpr (std::is_base_of_v<gl_shader, T>)
         {
-            map = &shader_;
+            registry = &shader_;
         } else if constexpr (std::is_base_of_v<gl_vertex, T>)
         {
-            map = &vertex_;
+            registry = &vertex_;
         } else if constexpr (std::is_base_of_v<gl_object, T>)
         {
-            map = &object_;
+            registry = &object_;
         }
-        return map;
+        return registry;
     }
 
     template <typename T>
-    constexpr auto* get_map_from_derived_type_() noexcept
+    constexpr auto* get_registry_from_derived_type_() noexcept
     {
         using BaseType = lot::any_type_true_t<false, std::is_base_of, T, gl_texture, gl_shader, gl_vertex, gl_object>;
         static_assert(!std::is_same_v<BaseType, void>, "T must be or derived from gl_texture, gl_shader, gl_vertex, or gl_object");
-        return const_cast<std::unordered_map<std::string, std::shared_ptr<BaseType>>*>(static_cast<const gl_world*>(this)->get_map_from_derived_type_<T>()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+        return const_cast<registry_<BaseType>*>(static_cast<const gl_world*>(this)->get_registry_from_derived_type_<T>()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
     }
 
-    std::unordered_map<std::string, std::shared_ptr<gl_texture>> texture_;
-    std::unordered_map<std::string, std::shared_ptr<gl_shader>> shader_;
-    std::unordered_map<std::string, std::shared_ptr<gl_vertex>> vertex_;
-    std::unordered_map<std::string, std::shared_ptr<gl_object>> object_;
-    std::string current_camera_;
-    std::string current_shader_;
+    // Must be declared before the registries, resources release their names and slots when destroyed
+    gl_state_cache state_cache_; // names deleted by the queue are forgotten here
+    gl_deletion_queue deletion_queue_ { state_cache_ };
+    gl_debug_output debug_output_;
+    gl_transform_store transforms_;
+    bool transform_store_enabled_ = true;
+    registry_<gl_texture> texture_;
+    registry_<gl_shader> shader_;
+    registry_<gl_vertex> vertex_;
+    registry_<gl_object> object_;
+    gl_handle<gl_object> current_camera_;
+    gl_handle<gl_shader> current_shader_;
     std::pair<int, int> screen_size_ = { 0, 0 };
+    glm::mat4 view_mat_ { 1.0F };
+    glm::mat4 projection_mat_ { 1.0F };
+    bool has_view_mat_ = false;
+    bool has_projection_mat_ = false;
+    gl_frustum frustum_;
+    bool frustum_culling_enabled_ = false;
+    gl_bvh static_tree_;  // ids are handle values of gl_entity
+    gl_bvh dynamic_tree_; // ids are handle values of gl_entity
+    bool spatial_index_dirty_ = true;
+    std::unique_ptr<gl_occlusion_culler> occlusion_culler_;
+    std::vector<std::pair<gl_handle<gl_object>, std::shared_ptr<const gl_occluder_mesh>>> occluders_;
+    std::size_t memory_budget_ = 0;
+    std::string spill_directory_;
+    std::uint64_t frame_ = 0;
+    std::uint64_t serial_ = ++world_count_; // names the spill files, unlike the address it's never reused
+    static inline std::atomic<std::uint64_t> world_count_ = 0;
 };
 
 } // namespace lomegl
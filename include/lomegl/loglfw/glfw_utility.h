@@ -5,20 +5,29 @@
 #include <lotools/raii_control.h>
 #include <string_view>
 
+#include "lomegl/gl_fwd.h"
+
 namespace lomegl {
 
 using glfw_control = lot::raii_control<glfwInit, glfwTerminate>;
 
 struct glfw_utility
 {
-    // Create a glfw window, and load opengl function
-    static GLFWwindow* init(std::string_view title_name, int width, int height, GLFWmonitor* monitor = nullptr, GLFWwindow* share = nullptr, int major_version = 3, int minor_version = 3);
+    // Create a glfw window, and load opengl function.
+    // If `no_error` is true, a GL_KHR_no_error context is requested and the error policy is set to `gl_error_policy::off`,
+    // errors of such a context are undefined behavior instead of being reported.
+    static GLFWwindow* init(std::string_view title_name, int width, int height, GLFWmonitor* monitor = nullptr, GLFWwindow* share = nullptr,
+        int major_version = 3, int minor_version = 3, bool no_error = false);
     static void on_window_size_change(GLFWwindow* /*window*/, int width, int height);
+    // Move the current camera of `world`, the overloads without it use the current world of the calling thread
     static void process_input(GLFWwindow* window);
+    static void process_input(GLFWwindow* window, gl_world& world);
+    // Per thread, so worlds running on several threads each time their own frames
     static void calulate_frame_time();
     static void mouse_callback(GLFWwindow* window, double xpos, double ypos);
-    static float delta_time;      // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
-    static float last_frame_time; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    static void mouse_callback(GLFWwindow* window, gl_world& world, double xpos, double ypos);
+    static thread_local float delta_time;      // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+    static thread_local float last_frame_time; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
 };
 
 } // namespace lomegl
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "lomegl/gl_asset_loader.h"
+#include "lomegl/gl_exception.h"
+#include "lomegl/gl_object.h"
+#include "lomegl/gl_shader.h"
+#include "lomegl/gl_state_cache.h"
+#include "lomegl/gl_texture.h"
+#include "lomegl/gl_vertex.h"
+#include "lomegl/gl_world.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace lomegl {
+
+gl_asset_loader::gl_asset_loader(gl_world& world, std::size_t worker_count) : world_(&world),
+                                                                                  unpack_buffer_(gl_val_factory<gl_val_type::vbo>(0))
+{
+    // 0 is a invaild value
+    unpack_buffer_.release();
+
+    assert(worker_count > 0);
+    workers_.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; ++i)
+        workers_.emplace_back([this] { worker_loop_(); });
+}
+
+gl_asset_loader::~gl_asset_loader()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+std::shared_future<gl_handle<gl_texture>> gl_asset_loader::load_texture(gl_name name, std::string path,
+    std::function<void(gl_texture&)> on_ready, bool flip_vertically)
+{
+    static constexpr unsigned char placeholder[4] = { 128, 128, 128, 255 };
+
+    auto handle = world_->create_handle<gl_texture>(name, GL_TEXTURE_2D);
+    auto& texture = world_->get(handle);
+    if (!texture.uses_dsa())
+        texture.bind();
+    // Without mipmaps the default GL_NEAREST_MIPMAP_LINEAR would leave it incomplete, sampling black
+    texture.add_image_data_to(0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder)
+        .tex_parameteri(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    auto job = std::make_shared<texture_job_>();
+    job->handle = handle;
+    job->path = std::move(path);
+    job->flip_vertically = flip_vertically;
+    job->on_ready = std::move(on_ready);
+    auto future = job->promise.get_future().share();
+    ++pending_;
+
+    {
+        std::lock_guard lock(mutex_);
+        jobs_.emplace_back([this, job] {
+            try
+            {
+                job->image = std::make_unique<image_data>(get_image_from_file(job->path.c_str(), job->flip_vertically));
+            } catch (...)
+            {
+                job->error = std::current_exception();
+            }
+            std::lock_guard lock(mutex_);
+            decoded_.push_back(job);
+        });
+    }
+    wake_.notify_one();
+    return future;
+}
+
+std::future<std::string> gl_asset_loader::load_text(std::string path)
+{
+    auto task = std::make_shared<std::packaged_task<std::string()>>([path = std::move(path)] {
+        return get_content_from_file(path.c_str());
+    });
+    auto future = task->get_future();
+    {
+        std::lock_guard lock(mutex_);
+        jobs_.emplace_back([task] { (*task)(); });
+    }
+    wake_.notify_one();
+    return future;
+}
+
+gl_asset_loader& gl_asset_loader::update(std::chrono::microseconds budget)
+{
+    auto deadline = std::chrono::steady_clock::now() + budget;
+    do
+    {
+        std::shared_ptr<texture_job_> job;
+        {
+            std::lock_guard lock(mutex_);
+            if (decoded_.empty())
+                break;
+            job = std::move(decoded_.front());
+            decoded_.pop_front();
+        }
+        --pending_;
+        upload_(*job);
+    } while (std::chrono::steady_clock::now() < deadline);
+    return *this;
+}
+
+[[nodiscard]] std::size_t gl_asset_loader::pending_count() const noexcept
+{
+    return pending_;
+}
+
+void gl_asset_loader::worker_loop_()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+            if (stop_)
+                return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+void gl_asset_loader::upload_(texture_job_& job)
+{
+    if (job.error)
+    {
+        job.promise.set_exception(job.error);
+        return;
+    }
+    if (!world_->exists(job.handle))
+    {
+        job.promise.set_exception(std::make_exception_ptr(std::runtime_error("Texture " + job.path + " is removed before it's loaded")));
+        return;
+    }
+
+    const auto& info = job.image->info;
+    unsigned int format = 0;
+    int internal_format = 0;
+    switch (info.channel)
+    {
+    case 1:
+        format = GL_RED;
+        internal_format = GL_R8;
+        break;
+    case 2:
+        format = GL_RG;
+        internal_format = GL_RG8;
+        break;
+    case 3:
+        format = GL_RGB;
+        internal_format = GL_RGB8;
+        break;
+    default:
+        format = GL_RGBA;
+        internal_format = GL_RGBA8;
+        break;
+    }
+
+    // Restoring an evicted texture uploads from client memory, so it must happen before the unpack buffer is bound
+    auto& texture = world_->get(job.handle);
+    if (!texture.uses_dsa())
+        texture.bind();
+    texture.make_resident();
+    // The caller may have changed the filter in the meantime; only the placeholder's own is replaced
+    GLint min_filter = 0;
+    if (texture.uses_dsa())
+        lomeglcall(glGetTextureParameteriv, texture.get_texture().get(), GL_TEXTURE_MIN_FILTER, &min_filter);
+    else
+        lomeglcall(glGetTexParameteriv, texture.get_texture_type(), GL_TEXTURE_MIN_FILTER, &min_filter);
+
+    auto size = static_cast<GLsizeiptr>(info.width) * info.height * info.channel;
+    if (unpack_buffer_.get() == 0)
+        unpack_buffer_ = gl_val_factory<gl_val_type::vbo>();
+    gl_state_cache::get().bind_buffer(GL_PIXEL_UNPACK_BUFFER, unpack_buffer_.get());
+    if (size > unpack_capacity_)
+    {
+        unpack_capacity_ = std::max(size, unpack_capacity_ * 2);
+        lomeglcall(glBufferData, GL_PIXEL_UNPACK_BUFFER, unpack_capacity_, nullptr, GL_STREAM_DRAW);
+    }
+    // Invalidating orphans the old storage, so staging doesn't wait for the previous upload to be consumed
+    auto* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (staging == nullptr) [[unlikely]]
+    {
+        gl_state_cache::get().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        throw gl_error("Map pixel unpack buffer fails");
+    }
+    std::memcpy(staging, job.image->data.get(), static_cast<std::size_t>(size));
+    lomeglcall(glUnmapBuffer, GL_PIXEL_UNPACK_BUFFER);
+    job.image.reset();
+
+    auto& cache = gl_state_cache::get();
+    auto unpack_alignment = cache.get_unpack_alignment();
+    cache.unpack_alignment(1);
+    // The pixels are read from offset 0 of the bound unpack buffer
+    texture.add_image_data_to(0, internal_format, info.width, info.height, 0, format, GL_UNSIGNED_BYTE, nullptr)
+        .generate_mipmap();
+    // The image has mipmaps, so the placeholder's filter goes back to the default
+    if (min_filter == GL_LINEAR)
+        texture.tex_parameteri(GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+    cache.unpack_alignment(unpack_alignment).bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (job.on_ready)
+        job.on_ready(texture);
+    job.promise.set_value(job.handle);
+}
+
+} // namespace lomegl
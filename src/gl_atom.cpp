@@ -0,0 +1,117 @@
+#include "lomegl/gl_atom.h"
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace lomegl {
+
+namespace {
+
+    // Open addressing index over the interned names, each slot stores `atom + 1`, 0 means empty.
+    // The stored hashes make growing the index free of string hashing.
+    struct atom_storage
+    {
+        atom_storage()
+        {
+            index.resize(1024, 0);
+            insert(std::string_view {}, fnv1a_32(std::string_view {}));
+        }
+
+        [[nodiscard]] std::uint32_t lookup(std::string_view name, std::uint32_t hash) const noexcept
+        {
+            auto mask = index.size() - 1;
+            for (auto pos = hash & mask;; pos = (pos + 1) & mask)
+            {
+                auto slot = index[pos];
+                if (slot == 0)
+                    return gl_atom_table::invalid_atom;
+                auto atom = slot - 1;
+                if (hashes[atom] == hash && names[atom] == name)
+                    return atom;
+            }
+        }
+
+        std::uint32_t insert(std::string_view name, std::uint32_t hash)
+        {
+            if ((names.size() + 1) * 2 > index.size())
+                grow();
+
+            auto atom = static_cast<std::uint32_t>(names.size());
+            names.emplace_back(name);
+            hashes.push_back(hash);
+            place(atom);
+            return atom;
+        }
+
+        void place(std::uint32_t atom) noexcept
+        {
+            auto mask = index.size() - 1;
+            auto pos = hashes[atom] & mask;
+            while (index[pos] != 0)
+                pos = (pos + 1) & mask;
+            index[pos] = atom + 1;
+        }
+
+        void grow()
+        {
+            index.assign(index.size() * 2, 0);
+            for (std::uint32_t atom = 0; atom < names.size(); ++atom)
+                place(atom);
+        }
+
+        mutable std::shared_mutex mutex;
+        std::deque<std::string> names; // deque keeps references stable
+        std::vector<std::uint32_t> hashes;
+        std::vector<std::uint32_t> index;
+    };
+
+    atom_storage& get_storage()
+    {
+        static atom_storage storage;
+        return storage;
+    }
+
+} // namespace
+
+std::uint32_t gl_atom_table::intern(std::string_view name, std::uint32_t hash)
+{
+    auto& storage = get_storage();
+    {
+        std::shared_lock lock(storage.mutex);
+        auto atom = storage.lookup(name, hash);
+        if (atom != invalid_atom)
+            return atom;
+    }
+
+    std::unique_lock lock(storage.mutex);
+    // Another thread may intern it between the two locks
+    auto atom = storage.lookup(name, hash);
+    if (atom != invalid_atom)
+        return atom;
+    return storage.insert(name, hash);
+}
+
+[[nodiscard]] std::uint32_t gl_atom_table::find(std::string_view name, std::uint32_t hash) noexcept
+{
+    auto& storage = get_storage();
+    std::shared_lock lock(storage.mutex);
+    return storage.lookup(name, hash);
+}
+
+[[nodiscard]] const std::string& gl_atom_table::name_of(std::uint32_t atom) noexcept
+{
+    auto& storage = get_storage();
+    std::shared_lock lock(storage.mutex);
+    return storage.names[atom];
+}
+
+[[nodiscard]] std::uint32_t gl_atom_table::hash_of(std::uint32_t atom) noexcept
+{
+    auto& storage = get_storage();
+    std::shared_lock lock(storage.mutex);
+    return storage.hashes[atom];
+}
+
+} // namespace lomegl
@@ -2,6 +2,22 @@
 
 #include "lomegl/gl_base.h"
 
+#include <atomic>
+
 namespace lomegl {
 
+namespace {
+    std::atomic<bool> dsa_enabled = true; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+} // namespace
+
+void set_dsa_enabled(bool enable) noexcept
+{
+    dsa_enabled = enable;
+}
+
+[[nodiscard]] bool is_dsa_enabled() noexcept
+{
+    return GLAD_GL_VERSION_4_5 != 0 && dsa_enabled.load(std::memory_order_relaxed);
+}
+
 } // namespace lomegl
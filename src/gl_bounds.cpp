@@ -0,0 +1,150 @@
+#include "lomegl/gl_bounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    define LOMEGL_BOUNDS_X86 1
+#    include <immintrin.h>
+#endif
+
+namespace lomegl {
+
+gl_aabb& gl_aabb::merge(const glm::vec3& point) noexcept
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+    return *this;
+}
+
+gl_aabb& gl_aabb::merge(const gl_aabb& other) noexcept
+{
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+    return *this;
+}
+
+[[nodiscard]] bool gl_aabb::overlaps(const gl_aabb& other) const noexcept
+{
+    return min.x <= other.max.x && max.x >= other.min.x
+        && min.y <= other.max.y && max.y >= other.min.y
+        && min.z <= other.max.z && max.z >= other.min.z;
+}
+
+[[nodiscard]] gl_aabb gl_aabb::transform(const glm::mat4& mat) const noexcept
+{
+    if (empty())
+        return *this;
+
+    // Transform the center, and project the extent onto the new axes
+    auto new_center = glm::vec3(mat * glm::vec4(center(), 1.0F));
+    auto old_extent = extent();
+    auto new_extent = glm::abs(glm::vec3(mat[0])) * old_extent.x
+        + glm::abs(glm::vec3(mat[1])) * old_extent.y
+        + glm::abs(glm::vec3(mat[2])) * old_extent.z;
+    return { new_center - new_extent, new_center + new_extent };
+}
+
+[[nodiscard]] gl_sphere gl_sphere::transform(const glm::mat4& mat) const noexcept
+{
+    if (empty())
+        return *this;
+
+    auto scale = std::max({ glm::length(glm::vec3(mat[0])), glm::length(glm::vec3(mat[1])), glm::length(glm::vec3(mat[2])) });
+    return { glm::vec3(mat * glm::vec4(center, 1.0F)), radius * scale };
+}
+
+[[nodiscard]] gl_bounds gl_bounds::from_positions(const void* data, std::uint32_t count, GLsizei stride) noexcept
+{
+    gl_bounds result;
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    auto read = [&](std::uint32_t i) {
+        float pos[3];
+        std::memcpy(pos, bytes + static_cast<std::size_t>(i) * stride, sizeof(pos));
+        return glm::vec3(pos[0], pos[1], pos[2]);
+    };
+
+    for (std::uint32_t i = 0; i < count; ++i)
+        result.box.merge(read(i));
+    if (result.box.empty())
+        return result;
+
+    // Centered on the box, tighter than the sphere of the box for most meshes
+    float radius2 = 0.0F;
+    auto center = result.box.center();
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        auto offset = read(i) - center;
+        radius2 = std::max(radius2, glm::dot(offset, offset));
+    }
+    result.sphere = { center, std::sqrt(radius2) };
+    return result;
+}
+
+[[nodiscard]] gl_bounds gl_bounds::from_aabb(const gl_aabb& box) noexcept
+{
+    if (box.empty())
+        return {};
+    return { box, { box.center(), glm::length(box.extent()) } };
+}
+
+gl_frustum::gl_frustum(const glm::mat4& view_projection) noexcept
+{
+    auto row = [&](int i) {
+        return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+    };
+
+    planes_ = { row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(3) + row(2), row(3) - row(2) };
+    for (auto& plane : planes_)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+[[nodiscard]] bool gl_frustum::intersects(const gl_sphere& sphere) const noexcept
+{
+    return std::all_of(planes_.begin(), planes_.end(), [&](const glm::vec4& plane) {
+        return glm::dot(glm::vec3(plane), sphere.center) + plane.w >= -sphere.radius;
+    });
+}
+
+[[nodiscard]] bool gl_frustum::intersects(const gl_aabb& box) const noexcept
+{
+    auto center = box.center();
+    auto extent = box.extent();
+    return std::all_of(planes_.begin(), planes_.end(), [&](const glm::vec4& plane) {
+        auto normal = glm::vec3(plane);
+        return glm::dot(normal, center) + plane.w >= -glm::dot(glm::abs(normal), extent);
+    });
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void gl_frustum::cull_spheres(const float* center_x, const float* center_y, const float* center_z, const float* radius,
+    std::uint32_t count, std::uint8_t* visible) const noexcept
+{
+    std::uint32_t i = 0;
+#ifdef LOMEGL_BOUNDS_X86
+    for (; i + 4 <= count; i += 4)
+    {
+        auto x = _mm_loadu_ps(center_x + i);
+        auto y = _mm_loadu_ps(center_y + i);
+        auto z = _mm_loadu_ps(center_z + i);
+        auto neg_r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+        auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& plane : planes_)
+        {
+            auto dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, neg_r));
+        }
+
+        auto mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; ++lane)
+            visible[i + lane] = static_cast<std::uint8_t>((mask >> lane) & 1);
+    }
+#endif
+    for (; i < count; ++i)
+        visible[i] = intersects(gl_sphere { { center_x[i], center_y[i], center_z[i] }, radius[i] }) ? 1 : 0;
+}
+
+} // namespace lomegl
@@ -0,0 +1,226 @@
+#include "lomegl/gl_bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <numeric>
+
+namespace lomegl {
+
+namespace {
+
+    constexpr std::uint32_t bin_count = 12;
+    // Keeps the traversal stack of 64 entries enough
+    constexpr std::uint32_t max_depth = 48;
+    // Nodes larger than this are always split, even if SAH prefers a leaf
+    constexpr std::uint32_t max_sah_leaf_size = 16;
+
+    // Distance where the ray enters the box, infinity if it misses
+    float ray_box(const gl_aabb& box, const glm::vec3& origin, const glm::vec3& inv_direction, float max_distance) noexcept
+    {
+        auto t0 = (box.min - origin) * inv_direction;
+        auto t1 = (box.max - origin) * inv_direction;
+        auto near = std::max({ std::min(t0.x, t1.x), std::min(t0.y, t1.y), std::min(t0.z, t1.z), 0.0F });
+        auto far = std::min({ std::max(t0.x, t1.x), std::max(t0.y, t1.y), std::max(t0.z, t1.z), max_distance });
+        return near <= far ? near : std::numeric_limits<float>::infinity();
+    }
+
+} // namespace
+
+void gl_bvh::build(std::vector<std::uint32_t> ids, std::vector<gl_aabb> boxes)
+{
+    assert(ids.size() == boxes.size());
+    ids_ = std::move(ids);
+    boxes_ = std::move(boxes);
+    nodes_.clear();
+    if (ids_.empty())
+        return;
+
+    centers_.resize(boxes_.size());
+    std::transform(boxes_.begin(), boxes_.end(), centers_.begin(), [](const gl_aabb& box) { return box.center(); });
+
+    nodes_.reserve(ids_.size() * 2);
+    nodes_.emplace_back();
+    build_node_(0, 0, static_cast<std::uint32_t>(ids_.size()), 0);
+    centers_.clear();
+}
+
+void gl_bvh::clear() noexcept
+{
+    nodes_.clear();
+    ids_.clear();
+    boxes_.clear();
+}
+
+[[nodiscard]] std::pair<std::uint32_t, float> gl_bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance) const noexcept
+{
+    std::pair<std::uint32_t, float> result { npos, max_distance };
+    if (nodes_.empty())
+        return result;
+
+    auto inv_direction = glm::vec3(1.0F / direction.x, 1.0F / direction.y, 1.0F / direction.z);
+    std::uint32_t stack[64];
+    std::uint32_t top = 0;
+    stack[top++] = 0;
+    while (top != 0)
+    {
+        const auto& node = nodes_[stack[--top]];
+        if (ray_box(node.box, origin, inv_direction, result.second) == std::numeric_limits<float>::infinity())
+            continue;
+
+        if (node.count != 0)
+        {
+            for (auto i = node.first; i < node.first + node.count; ++i)
+            {
+                auto distance = ray_box(boxes_[i], origin, inv_direction, result.second);
+                if (distance < result.second || (distance == result.second && result.first == npos))
+                    result = { ids_[i], distance };
+            }
+            continue;
+        }
+
+        // Visit the nearer child first, so the farther one is more likely to be pruned
+        auto left = ray_box(nodes_[node.first].box, origin, inv_direction, result.second);
+        auto right = ray_box(nodes_[node.first + 1].box, origin, inv_direction, result.second);
+        auto near_child = left <= right ? node.first : node.first + 1;
+        auto far_child = left <= right ? node.first + 1 : node.first;
+        if (std::max(left, right) != std::numeric_limits<float>::infinity())
+            stack[top++] = far_child;
+        if (std::min(left, right) != std::numeric_limits<float>::infinity())
+            stack[top++] = near_child;
+    }
+    return result;
+}
+
+void gl_bvh::build_node_(std::uint32_t node_index, std::uint32_t first, std::uint32_t count, std::uint32_t depth)
+{
+    gl_aabb box;
+    gl_aabb center_box;
+    for (auto i = first; i < first + count; ++i)
+    {
+        box.merge(boxes_[i]);
+        center_box.merge(centers_[i]);
+    }
+    nodes_[node_index] = { box, first, count };
+    if (count <= max_leaf_size || depth >= max_depth)
+        return;
+
+    auto center_size = center_box.max - center_box.min;
+    auto axis = center_size.x >= center_size.y && center_size.x >= center_size.z ? 0 : (center_size.y >= center_size.z ? 1 : 2);
+    if (center_size[axis] <= 0.0F)
+        return; // all centers are the same point, nothing to split
+
+    // Bin the centers along the axis, and find the split with the lowest SAH cost
+    struct bin
+    {
+        gl_aabb box;
+        std::uint32_t count = 0;
+    };
+    std::array<bin, bin_count> bins {};
+    auto scale = static_cast<float>(bin_count) / center_size[axis];
+    auto bin_of = [&](std::uint32_t i) {
+        return std::min(bin_count - 1, static_cast<std::uint32_t>((centers_[i][axis] - center_box.min[axis]) * scale));
+    };
+    for (auto i = first; i < first + count; ++i)
+    {
+        auto& item_bin = bins[bin_of(i)];
+        item_bin.box.merge(boxes_[i]);
+        ++item_bin.count;
+    }
+
+    std::array<float, bin_count> right_cost {};
+    gl_aabb right_box;
+    std::uint32_t right_count = 0;
+    for (auto i = bin_count - 1; i > 0; --i)
+    {
+        right_box.merge(bins[i].box);
+        right_count += bins[i].count;
+        right_cost[i] = right_count == 0 ? 0.0F : right_box.surface_area() * static_cast<float>(right_count);
+    }
+
+    auto best_cost = std::numeric_limits<float>::max();
+    std::uint32_t best_split = 0;
+    gl_aabb left_box;
+    std::uint32_t left_count = 0;
+    for (std::uint32_t i = 1; i < bin_count; ++i)
+    {
+        left_box.merge(bins[i - 1].box);
+        left_count += bins[i - 1].count;
+        if (left_count == 0 || left_count == count)
+            continue;
+        auto cost = left_box.surface_area() * static_cast<float>(left_count) + right_cost[i];
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            best_split = i;
+        }
+    }
+
+    auto mid = first;
+    if (best_split != 0)
+    {
+        if (best_cost >= box.surface_area() * static_cast<float>(count) && count <= max_sah_leaf_size)
+            return;
+
+        auto last = first + count;
+        while (mid < last)
+        {
+            if (bin_of(mid) < best_split)
+            {
+                ++mid;
+                continue;
+            }
+            --last;
+            std::swap(ids_[mid], ids_[last]);
+            std::swap(boxes_[mid], boxes_[last]);
+            std::swap(centers_[mid], centers_[last]);
+        }
+    } else {
+        // Every center falls into one bin, split at the median instead
+        std::vector<std::uint32_t> order(count);
+        std::iota(order.begin(), order.end(), first);
+        mid = first + count / 2;
+        std::nth_element(order.begin(), order.begin() + count / 2, order.end(), [&](std::uint32_t lhs, std::uint32_t rhs) {
+            return centers_[lhs][axis] < centers_[rhs][axis];
+        });
+
+        std::vector<std::uint32_t> ids(count);
+        std::vector<gl_aabb> boxes(count);
+        std::vector<glm::vec3> centers(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            ids[i] = ids_[order[i]];
+            boxes[i] = boxes_[order[i]];
+            centers[i] = centers_[order[i]];
+        }
+        std::copy(ids.begin(), ids.end(), ids_.begin() + first);
+        std::copy(boxes.begin(), boxes.end(), boxes_.begin() + first);
+        std::copy(centers.begin(), centers.end(), centers_.begin() + first);
+    }
+
+    auto left = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+    nodes_.emplace_back();
+    nodes_[node_index].first = left;
+    nodes_[node_index].count = 0;
+    build_node_(left, first, mid - first, depth + 1);
+    build_node_(left + 1, mid, first + count - mid, depth + 1);
+}
+
+void gl_bvh::refit_nodes_() noexcept
+{
+    for (auto i = nodes_.size(); i-- > 0;)
+    {
+        auto& node = nodes_[i];
+        node.box = {};
+        if (node.count != 0)
+        {
+            for (auto item = node.first; item < node.first + node.count; ++item)
+                node.box.merge(boxes_[item]);
+        } else {
+            node.box.merge(nodes_[node.first].box).merge(nodes_[node.first + 1].box);
+        }
+    }
+}
+
+} // namespace lomegl
@@ -0,0 +1,187 @@
+#include "lomegl/gl_debug.h"
+#include "lomegl/gl_exception.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace lomegl {
+
+[[nodiscard]] std::string_view gl_debug_message::get_text() const noexcept
+{
+    return text.data();
+}
+
+gl_debug_output::gl_debug_output(std::size_t capacity) : slots_(std::make_unique<slot_[]>(std::bit_ceil(std::max<std::size_t>(capacity, 2)))), // NOLINT(cppcoreguidelines-avoid-c-arrays)
+                                                         mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1)
+{
+    for (std::size_t i = 0; i <= mask_; ++i)
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+gl_debug_output::~gl_debug_output()
+{
+    uninstall();
+}
+
+[[nodiscard]] bool gl_debug_output::is_supported() noexcept
+{
+    return GLAD_GL_VERSION_4_3 != 0;
+}
+
+bool gl_debug_output::install(bool synchronous)
+{
+    if (!is_supported())
+        return false;
+    lomeglcall(glEnable, GL_DEBUG_OUTPUT);
+    if (synchronous)
+        lomeglcall(glEnable, GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    else
+        lomeglcall(glDisable, GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    lomeglcall(glDebugMessageCallback, &gl_debug_output::callback_, this);
+    lomeglcall(glDebugMessageControl, GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+    installed_ = true;
+    return true;
+}
+
+gl_debug_output& gl_debug_output::uninstall() noexcept
+{
+    if (!installed_)
+        return *this;
+    installed_ = false;
+    // Another instance, e.g. of another world, may have installed its callback since, leave it running.
+    // Not checked, it's called by the destructor
+    void* user_param = nullptr;
+    glGetPointerv(GL_DEBUG_CALLBACK_USER_PARAM, &user_param);
+    if (user_param != this)
+        return *this;
+    glDebugMessageCallback(nullptr, nullptr);
+    glDisable(GL_DEBUG_OUTPUT);
+    return *this;
+}
+
+[[nodiscard]] bool gl_debug_output::is_installed() const noexcept
+{
+    return installed_;
+}
+
+gl_debug_output& gl_debug_output::set_filter(GLenum source, GLenum severity, bool enable)
+{
+    assert(is_supported());
+    lomeglcall(glDebugMessageControl, source, GL_DONT_CARE, severity, 0, nullptr, enable ? GL_TRUE : GL_FALSE);
+    return *this;
+}
+
+// Bounded queue of Dmitry Vyukov: the sequence of a slot tells whether it's free for the writer of a position
+// or filled for the reader of it, positions are claimed with a CAS
+bool gl_debug_output::pop(gl_debug_message& message) noexcept
+{
+    auto pos = read_pos_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto& slot = slots_[pos & mask_];
+        auto diff = static_cast<std::ptrdiff_t>(slot.sequence.load(std::memory_order_acquire) - (pos + 1));
+        if (diff == 0)
+        {
+            if (read_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                message = slot.message;
+                slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+            return false; // empty
+        else
+            pos = read_pos_.load(std::memory_order_relaxed);
+    }
+}
+
+void gl_debug_output::check_errors()
+{
+    std::string errors;
+    gl_debug_message message;
+    while (pop(message))
+    {
+        if (message.type != GL_DEBUG_TYPE_ERROR)
+            continue;
+        errors += message.get_text();
+        errors += '\n';
+    }
+    if (!errors.empty())
+        throw gl_error("OpenGL debug output errors:\n" + errors);
+}
+
+[[nodiscard]] std::size_t gl_debug_output::get_dropped_count() const noexcept
+{
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+void APIENTRY gl_debug_output::callback_(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, // NOLINT(bugprone-easily-swappable-parameters)
+    const GLchar* message, const void* user_param)
+{
+    auto* output = static_cast<gl_debug_output*>(const_cast<void*>(user_param)); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+    auto size = length >= 0 ? static_cast<std::size_t>(length) : std::strlen(message);
+    output->push_(source, type, id, severity, { message, size });
+}
+
+void gl_debug_output::push_(GLenum source, GLenum type, GLuint id, GLenum severity, std::string_view text) noexcept
+{
+    auto pos = write_pos_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto& slot = slots_[pos & mask_];
+        auto diff = static_cast<std::ptrdiff_t>(slot.sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0)
+        {
+            if (write_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                auto& out = slot.message;
+                out.source = source;
+                out.type = type;
+                out.id = id;
+                out.severity = severity;
+                auto size = std::min(text.size(), out.text.size() - 1);
+                std::memcpy(out.text.data(), text.data(), size);
+                out.text[size] = '\0';
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return;
+            }
+        }
+        else if (diff < 0)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed); // full
+            return;
+        }
+        else
+            pos = write_pos_.load(std::memory_order_relaxed);
+    }
+}
+
+gl_debug_group::gl_debug_group(std::string_view name)
+{
+    if (!gl_debug_output::is_supported())
+        return;
+    lomeglcall(glPushDebugGroup, GL_DEBUG_SOURCE_APPLICATION, 0, static_cast<GLsizei>(name.size()), name.data());
+    pushed_ = true;
+}
+
+gl_debug_group::~gl_debug_group()
+{
+    // Not checked, a destructor must not throw
+    if (pushed_)
+        glPopDebugGroup();
+}
+
+void gl_object_label(GLenum identifier, GLuint name, std::string_view label)
+{
+    if (label.empty() || name == 0 || !gl_debug_output::is_supported())
+        return;
+    // GL_MAX_LABEL_LENGTH is at least 256, including the null terminator
+    constexpr std::size_t max_length = 255;
+    lomeglcall(glObjectLabel, identifier, name, static_cast<GLsizei>(std::min(label.size(), max_length)), label.data());
+}
+
+} // namespace lomegl
@@ -0,0 +1,178 @@
+#include "lomegl/gl_deletion_queue.h"
+#include "lomegl/gl_state_cache.h"
+#include "lomegl/gl_world.h"
+
+#include <utility>
+
+namespace lomegl {
+
+[[nodiscard]] std::shared_ptr<gl_name_owner> gl_current_name_owner()
+{
+    auto* world = gl_world::get_current_world();
+    return world != nullptr ? world->get_deletion_queue().owner_ : nullptr;
+}
+
+void gl_delete_val(gl_val_type type, unsigned int val, const std::shared_ptr<gl_name_owner>& owner)
+{
+    if (owner == nullptr)
+    {
+        gl_deletion_queue::delete_now_(gl_state_cache::get(), type, 1, &val);
+        return;
+    }
+
+    std::lock_guard lock(owner->mutex_);
+    auto* queue = owner->queue_;
+    if (queue == nullptr) // the world is destroyed, and its context with it
+        return;
+    queue->push(type, val);
+    auto* world = gl_world::get_current_world();
+    if (!queue->is_enabled() && world != nullptr && &world->get_deletion_queue() == queue)
+        queue->flush();
+}
+
+gl_deletion_queue::gl_deletion_queue(gl_state_cache& cache) : cache_(&cache), owner_(std::make_shared<gl_name_owner>())
+{
+    owner_->queue_ = this;
+}
+
+gl_deletion_queue::~gl_deletion_queue()
+{
+    {
+        std::lock_guard lock(owner_->mutex_);
+        owner_->queue_ = nullptr;
+    }
+    flush();
+}
+
+gl_deletion_queue& gl_deletion_queue::set_enabled(bool enable)
+{
+    enabled_ = enable;
+    if (!enable)
+        flush();
+    return *this;
+}
+
+[[nodiscard]] bool gl_deletion_queue::is_enabled() const noexcept
+{
+    return enabled_;
+}
+
+void gl_deletion_queue::push(gl_val_type type, unsigned int name)
+{
+    if (name == 0)
+        return;
+    std::lock_guard lock(mutex_);
+    queued_[static_cast<std::size_t>(type)].push_back(name);
+}
+
+gl_deletion_queue& gl_deletion_queue::end_frame()
+{
+    // Fences signal in order, stop at the first one still pending
+    while (!fenced_.empty())
+    {
+        auto status = glClientWaitSync(fenced_.front().fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        glDeleteSync(fenced_.front().fence);
+        delete_names_(fenced_.front().names);
+        fenced_.pop_front();
+    }
+
+    batch_ batch {};
+    {
+        std::lock_guard lock(mutex_);
+        batch.names = std::exchange(queued_, {});
+    }
+    bool empty = true;
+    for (const auto& names : batch.names)
+        empty = empty && names.empty();
+    if (!empty)
+    {
+        batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        fenced_.push_back(std::move(batch));
+    }
+    return *this;
+}
+
+gl_deletion_queue& gl_deletion_queue::flush() noexcept
+{
+    for (auto& batch : fenced_)
+    {
+        glDeleteSync(batch.fence);
+        delete_names_(batch.names);
+    }
+    fenced_.clear();
+
+    names_ names;
+    {
+        std::lock_guard lock(mutex_);
+        names = std::exchange(queued_, {});
+    }
+    delete_names_(names);
+    return *this;
+}
+
+[[nodiscard]] std::size_t gl_deletion_queue::pending_count() const
+{
+    std::size_t count = 0;
+    for (const auto& batch : fenced_)
+    {
+        for (const auto& names : batch.names)
+            count += names.size();
+    }
+    std::lock_guard lock(mutex_);
+    for (const auto& names : queued_)
+        count += names.size();
+    return count;
+}
+
+void gl_deletion_queue::delete_released_() noexcept
+{
+    if (!enabled_)
+        flush();
+}
+
+void gl_deletion_queue::delete_names_(names_& names) noexcept
+{
+    for (std::size_t type = 0; type < type_count_; ++type)
+    {
+        auto& list = names[type];
+        if (!list.empty())
+            delete_now_(*cache_, static_cast<gl_val_type>(type), static_cast<GLsizei>(list.size()), list.data());
+        list.clear();
+    }
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void gl_deletion_queue::delete_now_(gl_state_cache& cache, gl_val_type type, GLsizei count, const unsigned int* names) noexcept
+{
+    // Called from destructors, so errors are not checked
+    cache.forget(type, count, names);
+    using enum gl_val_type;
+    switch (type)
+    {
+    case vao:
+        glDeleteVertexArrays(count, names);
+        break;
+    case vbo:
+    case ebo:
+        glDeleteBuffers(count, names);
+        break;
+    case texture:
+        glDeleteTextures(count, names);
+        break;
+    case query:
+        glDeleteQueries(count, names);
+        break;
+    case program:
+        for (GLsizei i = 0; i < count; ++i)
+            glDeleteProgram(names[i]);
+        break;
+    default: // shaders have no batched delete
+        for (GLsizei i = 0; i < count; ++i)
+            glDeleteShader(names[i]);
+        break;
+    }
+}
+
+} // namespace lomegl
@@ -1 +1,44 @@
-#include "lomegl/gl_exception.h"
\ No newline at end of file
+#include "lomegl/gl_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace lomegl {
+
+void detail::throw_gl_error(unsigned int error_code, const char* filename, int line, const char* funcname)
+{
+    std::stringstream out;
+    out << funcname << " (" << filename << ":" << line << ") " << get_error_content(error_code) << "\n";
+    throw gl_error(out.str());
+}
+
+void set_gl_error_policy(gl_error_policy policy, unsigned int sample_interval) noexcept
+{
+    assert(sample_interval != 0);
+    detail::gl_error_sample_interval = sample_interval;
+    detail::gl_error_policy_value = policy;
+}
+
+[[nodiscard]] gl_error_policy get_gl_error_policy() noexcept
+{
+    return detail::gl_error_policy_value;
+}
+
+void check_gl_errors()
+{
+    // A lost context may report errors forever, so the loop is bounded
+    constexpr int max_errors = 16;
+    std::string errors;
+    for (int i = 0; i < max_errors; ++i)
+    {
+        auto error_code = glGetError();
+        if (error_code == GL_NO_ERROR)
+            break;
+        errors += get_error_content(error_code);
+        errors += '\n';
+    }
+    if (!errors.empty())
+        throw gl_error("OpenGL errors since the last check:\n" + errors);
+}
+
+} // namespace lomegl
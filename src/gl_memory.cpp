@@ -0,0 +1,198 @@
+#include "lomegl/gl_memory.h"
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <fstream>
+#include <ios>
+#include <stdexcept>
+#include <utility>
+
+namespace lomegl {
+
+gl_evicted_copy::~gl_evicted_copy()
+{
+    remove_spill_();
+}
+
+gl_evicted_copy::gl_evicted_copy(gl_evicted_copy&& other) noexcept
+    : data_(std::move(other.data_))
+    , spill_path_(std::exchange(other.spill_path_, {}))
+{
+}
+
+gl_evicted_copy& gl_evicted_copy::operator=(gl_evicted_copy&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+    remove_spill_();
+    data_ = std::move(other.data_);
+    spill_path_ = std::exchange(other.spill_path_, {});
+    return *this;
+}
+
+void gl_evicted_copy::store(std::vector<unsigned char> data, const std::string& spill_path)
+{
+    if (spill_path.empty())
+    {
+        remove_spill_();
+        data_ = std::move(data);
+        return;
+    }
+
+    std::ofstream file(spill_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size())); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (!file)
+        throw std::runtime_error("Can't write the evicted resource to " + spill_path);
+    if (spill_path_ != spill_path)
+        remove_spill_();
+    data_.clear();
+    spill_path_ = spill_path;
+}
+
+[[nodiscard]] std::vector<unsigned char> gl_evicted_copy::take()
+{
+    if (spill_path_.empty())
+        return std::exchange(data_, {});
+
+    std::ifstream file(spill_path_, std::ios::binary | std::ios::ate);
+    if (!file)
+        throw std::runtime_error("Can't read the evicted resource from " + spill_path_);
+    std::vector<unsigned char> data(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (!file)
+        throw std::runtime_error("Can't read the evicted resource from " + spill_path_);
+    file.close();
+    remove_spill_();
+    return data;
+}
+
+void gl_evicted_copy::remove_spill_() noexcept
+{
+    if (spill_path_.empty())
+        return;
+    std::remove(spill_path_.c_str());
+    spill_path_.clear();
+}
+
+[[nodiscard]] std::size_t get_texel_size(int internal_format) noexcept
+{
+    switch (internal_format)
+    {
+    case GL_RED:
+    case GL_R8:
+    case GL_R8I:
+    case GL_R8UI:
+    case GL_STENCIL_INDEX8:
+        return 1;
+    case GL_RG:
+    case GL_RG8:
+    case GL_R16:
+    case GL_R16F:
+    case GL_R16I:
+    case GL_R16UI:
+    case GL_DEPTH_COMPONENT16:
+        return 2;
+    case GL_RGB:
+    case GL_RGB8:
+    case GL_SRGB8:
+        return 3;
+    case GL_RG16:
+    case GL_RG16F:
+    case GL_R32F:
+    case GL_R32I:
+    case GL_R32UI:
+    case GL_R11F_G11F_B10F:
+    case GL_RGB10_A2:
+    case GL_DEPTH_COMPONENT:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+    case GL_DEPTH24_STENCIL8:
+        return 4;
+    case GL_RGB16F:
+        return 6;
+    case GL_RGBA16:
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGB32F:
+        return 12;
+    case GL_RGBA32F:
+    case GL_RGBA32I:
+    case GL_RGBA32UI:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+[[nodiscard]] std::size_t get_pixel_size(unsigned int format, unsigned int type) noexcept
+{
+    // Packed types hold a whole pixel
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE_3_3_2:
+    case GL_UNSIGNED_BYTE_2_3_3_REV:
+        return 1;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_5_6_5_REV:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+    case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+        return 2;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_10_10_10_2:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_24_8:
+    case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    case GL_UNSIGNED_INT_5_9_9_9_REV:
+        return 4;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+        return 8;
+    default:
+        break;
+    }
+
+    std::size_t components = 4;
+    switch (format)
+    {
+    case GL_RED:
+    case GL_GREEN:
+    case GL_BLUE:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+    case GL_STENCIL_INDEX:
+        components = 1;
+        break;
+    case GL_RG:
+    case GL_RG_INTEGER:
+        components = 2;
+        break;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+        components = 3;
+        break;
+    default:
+        break;
+    }
+
+    switch (type)
+    {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return components;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        return components * 2;
+    default:
+        return components * 4;
+    }
+}
+
+} // namespace lomegl
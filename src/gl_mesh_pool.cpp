@@ -0,0 +1,148 @@
+#include "lomegl/gl_mesh_pool.h"
+#include "lomegl/gl_exception.h"
+#include "lomegl/gl_state_cache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lomegl {
+
+gl_range_allocator::gl_range_allocator(std::uint32_t capacity) : capacity_(capacity)
+{
+    if (capacity != 0)
+        free_.push_back({ 0, capacity });
+}
+
+[[nodiscard]] std::uint32_t gl_range_allocator::allocate(std::uint32_t count)
+{
+    assert(count != 0);
+    for (auto it = free_.begin(); it != free_.end(); ++it)
+    {
+        if (it->count < count)
+            continue;
+
+        auto offset = it->offset;
+        if (it->count == count)
+        {
+            free_.erase(it);
+        } else {
+            it->offset += count;
+            it->count -= count;
+        }
+        used_ += count;
+        return offset;
+    }
+    return npos;
+}
+
+void gl_range_allocator::free(std::uint32_t offset, std::uint32_t count)
+{
+    assert(count != 0 && offset + count <= capacity_ && used_ >= count);
+    auto next = std::lower_bound(free_.begin(), free_.end(), offset, [](const block_& block, std::uint32_t value) {
+        return block.offset < value;
+    });
+    assert(next == free_.end() || offset + count <= next->offset);
+
+    used_ -= count;
+    auto merge_prev = next != free_.begin() && std::prev(next)->offset + std::prev(next)->count == offset;
+    auto merge_next = next != free_.end() && offset + count == next->offset;
+
+    if (merge_prev && merge_next)
+    {
+        std::prev(next)->count += count + next->count;
+        free_.erase(next);
+    } else if (merge_prev)
+    {
+        std::prev(next)->count += count;
+    } else if (merge_next)
+    {
+        next->offset = offset;
+        next->count += count;
+    } else {
+        free_.insert(next, { offset, count });
+    }
+}
+
+[[nodiscard]] std::uint32_t gl_range_allocator::capacity() const noexcept
+{
+    return capacity_;
+}
+
+[[nodiscard]] std::uint32_t gl_range_allocator::used() const noexcept
+{
+    return used_;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_mesh_pool::gl_mesh_pool(GLsizei vertex_stride, std::uint32_t vertex_capacity, std::uint32_t index_capacity)
+    : vertex_stride_(vertex_stride), vertices_(vertex_capacity), indices_(index_capacity)
+{
+    assert(vertex_stride > 0);
+    if (!uses_dsa())
+        bind_this();
+    bind_array_buffer_data(nullptr, static_cast<GLsizeiptr>(vertex_stride) * vertex_capacity, GL_STATIC_DRAW, 0);
+    bind_elemnt_buffer_data(nullptr, static_cast<GLsizeiptr>(sizeof(GLuint)) * index_capacity, GL_STATIC_DRAW, 0);
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+[[nodiscard]] gl_mesh_range gl_mesh_pool::add_mesh(const void* vertices, std::uint32_t vertex_count, const GLuint* indices, std::uint32_t index_count)
+{
+    assert(vertex_count != 0 && index_count != 0);
+    auto base_vertex = vertices_.allocate(vertex_count);
+    if (base_vertex == gl_range_allocator::npos)
+        throw std::runtime_error("Mesh pool " + get_id() + " is out of vertex space");
+
+    auto first_index = indices_.allocate(index_count);
+    if (first_index == gl_range_allocator::npos)
+    {
+        vertices_.free(base_vertex, vertex_count);
+        throw std::runtime_error("Mesh pool " + get_id() + " is out of index space");
+    }
+
+    make_resident();
+    if (uses_dsa())
+    {
+        lomeglcall(glNamedBufferSubData, vbo(), static_cast<GLintptr>(base_vertex) * vertex_stride_,
+            static_cast<GLsizeiptr>(vertex_count) * vertex_stride_, vertices);
+        lomeglcall(glNamedBufferSubData, ebo(), static_cast<GLintptr>(first_index * sizeof(GLuint)),
+            static_cast<GLsizeiptr>(index_count * sizeof(GLuint)), indices);
+        return { first_index, index_count, static_cast<std::int32_t>(base_vertex), vertex_count };
+    }
+
+    // The element buffer binding is part of the VAO
+    bind_this();
+    gl_state_cache::get().bind_buffer(GL_ARRAY_BUFFER, vbo());
+    lomeglcall(glBufferSubData, GL_ARRAY_BUFFER, static_cast<GLintptr>(base_vertex) * vertex_stride_,
+        static_cast<GLsizeiptr>(vertex_count) * vertex_stride_, vertices);
+    gl_state_cache::get().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ebo());
+    lomeglcall(glBufferSubData, GL_ELEMENT_ARRAY_BUFFER, static_cast<GLintptr>(first_index * sizeof(GLuint)),
+        static_cast<GLsizeiptr>(index_count * sizeof(GLuint)), indices);
+
+    return { first_index, index_count, static_cast<std::int32_t>(base_vertex), vertex_count };
+}
+
+gl_mesh_pool& gl_mesh_pool::remove_mesh(const gl_mesh_range& range)
+{
+    assert(!range.empty());
+    vertices_.free(static_cast<std::uint32_t>(range.base_vertex), range.vertex_count);
+    indices_.free(range.first_index, range.index_count);
+    return *this;
+}
+
+[[nodiscard]] GLsizei gl_mesh_pool::vertex_stride() const noexcept
+{
+    return vertex_stride_;
+}
+
+[[nodiscard]] const gl_range_allocator& gl_mesh_pool::vertex_allocator() const noexcept
+{
+    return vertices_;
+}
+
+[[nodiscard]] const gl_range_allocator& gl_mesh_pool::index_allocator() const noexcept
+{
+    return indices_;
+}
+
+} // namespace lomegl
@@ -6,11 +6,27 @@
 #include "lomegl/gl_world.h"
 
 #include <string>
+#include <utility>
 
-#include <glm/gtc/type_ptr.hpp>
 
 namespace lomegl {
 
+namespace {
+
+    thread_local gl_transform_store* pending_store = nullptr;
+
+} // namespace
+
+gl_object::store_scope_::store_scope_(gl_transform_store* store) noexcept
+{
+    pending_store = store;
+}
+
+gl_object::store_scope_::~store_scope_()
+{
+    pending_store = nullptr;
+}
+
 gl_object::gl_object() : gl_object(glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec3(1, 1, 1))
 {
 }
@@ -25,121 +41,217 @@ gl_object::gl_object(const glm::vec3& pos, const glm::vec3& angle) : gl_object(p
 
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 gl_object::gl_object(const glm::vec3& pos, const glm::vec3& angle, const glm::vec3& scale)
-    : pos_(pos), obj_front_(world_front), obj_right_(world_right), obj_up_(world_up), rotate_(),
-      scale_(scale), model_no_scale_(), model_(), view_()
+    : store_(take_store_()), slot_(store_->allocate())
+{
+    init_transform_(pos, angle, scale);
+}
+
+// A moved-from object has no transform, copying it gives the default one
+gl_object::gl_object(const gl_object& other)
+    : string_id(other), store_(take_store_()),
+      slot_(other.store_ != nullptr ? store_->allocate_copy(*other.store_, other.slot_) : store_->allocate())
 {
+    if (other.store_ == nullptr)
+        init_transform_(glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec3(1, 1, 1));
+}
+
+gl_object& gl_object::operator=(const gl_object& other)
+{
+    if (this != &other)
+    {
+        string_id::operator=(other);
+        // A moved-from object gets a slot again
+        if (store_ == nullptr)
+        {
+            store_ = take_store_();
+            slot_ = store_->allocate();
+        }
+        if (other.store_ != nullptr)
+            store_->copy(*other.store_, other.slot_, slot_);
+        else
+            init_transform_(glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec3(1, 1, 1));
+    }
+    return *this;
+}
+
+gl_object::gl_object(gl_object&& other) noexcept
+    : string_id(std::move(other)), own_store_(std::move(other.own_store_)),
+      store_(std::exchange(other.store_, nullptr)), slot_(other.slot_)
+{
+}
+
+gl_object& gl_object::operator=(gl_object&& other) noexcept
+{
+    if (this != &other)
+    {
+        release_slot_();
+        string_id::operator=(std::move(other));
+        own_store_ = std::move(other.own_store_);
+        store_ = std::exchange(other.store_, nullptr);
+        slot_ = other.slot_;
+    }
+    return *this;
+}
+
+gl_object::~gl_object()
+{
+    release_slot_();
+}
+
+void gl_object::attach_transform_store_(gl_transform_store& store)
+{
+    if (&store == store_)
+        return;
+    auto moved_from = store_ == nullptr;
+    auto new_slot = moved_from ? store.allocate() : store.allocate_copy(*store_, slot_);
+    release_slot_();
+    own_store_.reset();
+    store_ = &store;
+    slot_ = new_slot;
+    if (moved_from)
+        init_transform_(glm::vec3(0, 0, 0), glm::vec3(0, 0, 0), glm::vec3(1, 1, 1));
+}
+
+[[nodiscard]] gl_transform_store* gl_object::take_store_()
+{
+    // Taken by the first object only, objects it constructs as members get their own store
+    if (auto* store = std::exchange(pending_store, nullptr); store != nullptr)
+        return store;
+    own_store_ = std::make_unique<gl_transform_store>();
+    return own_store_.get();
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void gl_object::init_transform_(const glm::vec3& pos, const glm::vec3& angle, const glm::vec3& scale)
+{
+    store_->pos(slot_) = pos;
+    store_->scale(slot_) = scale;
     set_angle(angle);
     update_matrix();
 }
 
-gl_object::~gl_object() = default;
+void gl_object::release_slot_() noexcept
+{
+    // The own store releases everything by itself
+    if (store_ != nullptr && !own_store_)
+        store_->release(slot_);
+}
 
 glm::mat4& gl_object::get_model_mat()
 {
-    if (is_transform_)
-        update_matrix();
-    return model_;
+    update_matrix();
+    return store_->model(slot_);
 }
 
 glm::mat4& gl_object::get_model_mat_no_scale()
 {
-    if (is_transform_)
-        update_matrix();
-    return model_no_scale_;
+    update_matrix();
+    return store_->model_no_scale(slot_);
 }
 
 glm::mat4& gl_object::get_view_mat()
 {
-    if (is_transform_)
-        update_matrix();
-    return view_;
+    update_matrix();
+    return store_->view(slot_);
 }
 
 glm::vec3 gl_object::from_world(const glm::vec3& world_pos)
 {
-    if (is_transform_)
-        update_matrix();
-    return view_ * glm::vec4(world_pos, 0);
+    update_matrix();
+    return store_->view(slot_) * glm::vec4(world_pos, 0);
 }
 
 glm::vec3 gl_object::to_world(const glm::vec3& local_pos)
 {
-    if (is_transform_)
-        update_matrix();
-    return model_no_scale_ * glm::vec4(local_pos, 0);
+    update_matrix();
+    return store_->model_no_scale(slot_) * glm::vec4(local_pos, 0);
 }
 
 void gl_object::update_matrix()
 {
-    if (is_transform_)
-    {
+    store_->update(slot_);
+}
 
-        // model_no_scale_ = glm::mat4(1.0F);
-        // model_no_scale_ = glm::translate(model_no_scale_, pos_);
-        // model_no_scale_ = model_no_scale_ * glm::toMat4(rotate_);
-        // model_ = glm::scale(model_no_scale_, scale_);
-        view_ = glm::lookAt(pos_, pos_ + obj_front_, obj_up_);
-        model_no_scale_ = glm::inverse(view_);
-        model_ = glm::scale(model_no_scale_, scale_);
-        is_transform_ = false;
+gl_object& gl_object::set_parent(gl_object* parent)
+{
+    if (parent == nullptr)
+    {
+        store_->set_parent(slot_, gl_transform_store::npos);
+        return *this;
     }
+
+    if (parent->store_ != store_)
+        throw std::runtime_error("Set parent fails: the parent is not in the same transform store");
+    store_->set_parent(slot_, parent->slot_);
+    return *this;
+}
+
+[[nodiscard]] bool gl_object::has_parent() const noexcept
+{
+    return store_->get_parent(slot_) != gl_transform_store::npos;
+}
+
+[[nodiscard]] glm::vec3 gl_object::get_world_pos()
+{
+    update_matrix();
+    return glm::vec3(store_->model_no_scale(slot_)[3]);
 }
 
 gl_object& gl_object::set_pos(const glm::vec3& new_pos) noexcept
 {
-    is_transform_ = true;
-    pos_ = new_pos;
+    store_->mark_transform(slot_);
+    store_->pos(slot_) = new_pos;
     return *this;
 }
 
 gl_object& gl_object::add_pos(const glm::vec3& pos) noexcept
 {
-    is_transform_ = true;
-    pos_ += pos;
+    store_->mark_transform(slot_);
+    store_->pos(slot_) += pos;
     return *this;
 }
 
 [[nodiscard]] glm::vec3& gl_object::get_pos() noexcept
 {
-    return pos_;
+    return store_->pos(slot_);
 }
 
 gl_object& gl_object::set_pos(float pos_x, float pos_y, float pos_z) noexcept
 {
-    is_transform_ = true;
-    pos_.x = pos_x;
-    pos_.y = pos_y;
-    pos_.z = pos_z;
+    store_->mark_transform(slot_);
+    store_->pos(slot_).x = pos_x;
+    store_->pos(slot_).y = pos_y;
+    store_->pos(slot_).z = pos_z;
     return *this;
 }
 
 gl_object& gl_object::set_pos_x(float pos_x) noexcept
 {
-    is_transform_ = true;
-    pos_.x = pos_x;
+    store_->mark_transform(slot_);
+    store_->pos(slot_).x = pos_x;
     return *this;
 }
 
 gl_object& gl_object::set_pos_y(float pos_y) noexcept
 {
-    is_transform_ = true;
-    pos_.y = pos_y;
+    store_->mark_transform(slot_);
+    store_->pos(slot_).y = pos_y;
     return *this;
 }
 
 gl_object& gl_object::set_pos_z(float pos_z) noexcept
 {
-    is_transform_ = true;
-    pos_.z = pos_z;
+    store_->mark_transform(slot_);
+    store_->pos(slot_).z = pos_z;
     return *this;
 }
 
 gl_object& gl_object::add_pos(float pos_x, float pos_y, float pos_z) noexcept
 {
-    is_transform_ = true;
-    pos_.x += pos_x;
-    pos_.y += pos_y;
-    pos_.z += pos_z;
+    store_->mark_transform(slot_);
+    store_->pos(slot_).x += pos_x;
+    store_->pos(slot_).y += pos_y;
+    store_->pos(slot_).z += pos_z;
     return *this;
 }
 
@@ -169,7 +281,7 @@ gl_object& gl_object::add_pos_local(const glm::vec3& pos) noexcept
 
 gl_object& gl_object::add_pos_local(float pos_x, float pos_y, float pos_z) noexcept
 {
-    glm::vec3 temp = pos_x * obj_right_ + pos_y * obj_up_ + pos_z * obj_front_;
+    glm::vec3 temp = pos_x * store_->right(slot_) + pos_y * store_->up(slot_) + pos_z * store_->front(slot_);
     add_pos(temp);
     return *this;
 }
@@ -193,21 +305,21 @@ gl_object& gl_object::add_pos_z_local(float pos_z) noexcept
 
 gl_object& gl_object::set_angle(const glm::vec3& new_angle) noexcept
 {
-    is_transform_ = true;
-    rotate_ = glm::quat(new_angle);
-    obj_front_ = rotate_ * world_front;
-    obj_right_ = rotate_ * world_right;
-    obj_up_ = rotate_ * world_up;
+    store_->mark_transform(slot_);
+    store_->rotate(slot_) = glm::quat(new_angle);
+    store_->front(slot_) = store_->rotate(slot_) * world_front;
+    store_->right(slot_) = store_->rotate(slot_) * world_right;
+    store_->up(slot_) = store_->rotate(slot_) * world_up;
     return *this;
 }
 
 gl_object& gl_object::add_angle(const glm::vec3& angle) noexcept
 {
-    is_transform_ = true;
-    rotate_ = glm::quat(angle);
-    obj_front_ = rotate_ * obj_front_;
-    obj_right_ = rotate_ * obj_right_;
-    obj_up_ = rotate_ * obj_up_;
+    store_->mark_transform(slot_);
+    store_->rotate(slot_) = glm::quat(angle);
+    store_->front(slot_) = store_->rotate(slot_) * store_->front(slot_);
+    store_->right(slot_) = store_->rotate(slot_) * store_->right(slot_);
+    store_->up(slot_) = store_->rotate(slot_) * store_->up(slot_);
     // rotate_ = glm::quat(angle) * rotate_;
     // obj_front_ = rotate_ * world_front;
     // obj_right_ = rotate_ * world_right;
@@ -217,17 +329,17 @@ gl_object& gl_object::add_angle(const glm::vec3& angle) noexcept
 
 [[nodiscard]] glm::vec3& gl_object::get_front() noexcept
 {
-    return obj_front_;
+    return store_->front(slot_);
 }
 
 [[nodiscard]] glm::vec3& gl_object::get_right() noexcept
 {
-    return obj_right_;
+    return store_->right(slot_);
 }
 
 [[nodiscard]] glm::vec3& gl_object::get_up() noexcept
 {
-    return obj_up_;
+    return store_->up(slot_);
 }
 
 gl_object& gl_object::set_angle(float roll, float yaw, float pitch) noexcept
@@ -268,11 +380,11 @@ gl_object& gl_object::add_angle_local(const glm::vec3& angle) noexcept
 
 gl_object& gl_object::add_angle_local(float roll, float yaw, float pitch) noexcept
 {
-    is_transform_ = true;
-    rotate_ = glm::angleAxis(glm::degrees(roll), obj_front_) * glm::angleAxis(glm::degrees(yaw), obj_up_) * glm::angleAxis(glm::degrees(pitch), obj_right_);
-    obj_front_ = rotate_ * obj_front_;
-    obj_right_ = rotate_ * obj_right_;
-    obj_up_ = rotate_ * obj_up_;
+    store_->mark_transform(slot_);
+    store_->rotate(slot_) = glm::angleAxis(glm::degrees(roll), store_->front(slot_)) * glm::angleAxis(glm::degrees(yaw), store_->up(slot_)) * glm::angleAxis(glm::degrees(pitch), store_->right(slot_));
+    store_->front(slot_) = store_->rotate(slot_) * store_->front(slot_);
+    store_->right(slot_) = store_->rotate(slot_) * store_->right(slot_);
+    store_->up(slot_) = store_->rotate(slot_) * store_->up(slot_);
     // rotate_ = glm::angleAxis(glm::degrees(roll), obj_front_) * glm::angleAxis(glm::degrees(yaw), obj_up_) * glm::angleAxis(glm::degrees(pitch), obj_right_) * rotate_;
     // obj_front_ = rotate_ * world_front;
     // obj_right_ = rotate_ * world_right;
@@ -298,90 +410,93 @@ gl_object& gl_object::add_angle_roll_local(float roll) noexcept
 
 gl_object& gl_object::set_scale(const glm::vec3& new_scale) noexcept
 {
-    is_transform_ = true;
-    scale_ = new_scale;
+    store_->mark_transform(slot_);
+    store_->scale(slot_) = new_scale;
     return *this;
 }
 
 gl_object& gl_object::add_scale(const glm::vec3& scale) noexcept
 {
-    is_transform_ = true;
-    scale_ += scale;
+    store_->mark_transform(slot_);
+    store_->scale(slot_) += scale;
     return *this;
 }
 
 [[nodiscard]] glm::vec3& gl_object::get_scale() noexcept
 {
-    return scale_;
+    return store_->scale(slot_);
 }
 
 gl_object& gl_object::set_scale(float scale_x, float scale_y, float scale_z) noexcept
 {
-    is_transform_ = true;
-    scale_.x = scale_x;
-    scale_.y = scale_y;
-    scale_.z = scale_z;
+    store_->mark_transform(slot_);
+    store_->scale(slot_).x = scale_x;
+    store_->scale(slot_).y = scale_y;
+    store_->scale(slot_).z = scale_z;
     return *this;
 }
 
 gl_object& gl_object::set_scale_x(float scale_x) noexcept
 {
-    is_transform_ = true;
-    scale_.x = scale_x;
+    store_->mark_transform(slot_);
+    store_->scale(slot_).x = scale_x;
     return *this;
 }
 
 gl_object& gl_object::set_scale_y(float scale_y) noexcept
 {
-    is_transform_ = true;
-    scale_.y = scale_y;
+    store_->mark_transform(slot_);
+    store_->scale(slot_).y = scale_y;
     return *this;
 }
 
 gl_object& gl_object::set_scale_z(float scale_z) noexcept
 {
-    is_transform_ = true;
-    scale_.z = scale_z;
+    store_->mark_transform(slot_);
+    store_->scale(slot_).z = scale_z;
     return *this;
 }
 
 gl_object& gl_object::add_scale(float scale_x, float scale_y, float scale_z) noexcept
 {
-    is_transform_ = true;
-    scale_.x += scale_x;
-    scale_.y += scale_y;
-    scale_.z += scale_z;
+    store_->mark_transform(slot_);
+    store_->scale(slot_).x += scale_x;
+    store_->scale(slot_).y += scale_y;
+    store_->scale(slot_).z += scale_z;
     return *this;
 }
 
 gl_object& gl_object::add_scale_x(float scale_x) noexcept
 {
-    is_transform_ = true;
-    scale_.x += scale_x;
+    store_->mark_transform(slot_);
+    store_->scale(slot_).x += scale_x;
     return *this;
 }
 
 gl_object& gl_object::add_scale_y(float scale_y) noexcept
 {
-    is_transform_ = true;
-    scale_.y += scale_y;
+    store_->mark_transform(slot_);
+    store_->scale(slot_).y += scale_y;
     return *this;
 }
 
 gl_object& gl_object::add_scale_z(float scale_z) noexcept
 {
-    is_transform_ = true;
-    scale_.z += scale_z;
+    store_->mark_transform(slot_);
+    store_->scale(slot_).z += scale_z;
     return *this;
 }
 
 gl_entity::gl_entity(const char* vertex, std::initializer_list<const char*> texture_list)
-    : vertex_(gl_world::get_current_world()->get<gl_vertex, true>(vertex))
+    : gl_entity(*gl_world::get_current_world(), vertex, texture_list)
 {
-    auto&& world_ins = *gl_world::get_current_world();
+}
 
+gl_entity::gl_entity(gl_world& world, const char* vertex, std::initializer_list<const char*> texture_list)
+    : vertex_(world.get<gl_vertex, true>(vertex))
+{
     for (auto&& item : texture_list)
-        texture_.push_back(world_ins.get<gl_texture, true>(item));
+        texture_.push_back(world.get<gl_texture, true>(item));
 }
 
 [[nodiscard]] const std::weak_ptr<gl_vertex>& gl_entity::get_vertex() const noexcept
@@ -396,13 +511,23 @@ gl_entity::gl_entity(const char* vertex, std::initializer_list<const char*> text
 
 gl_entity& gl_entity::set_vertex(const char* vertex)
 {
-    vertex_ = gl_world::get_current_world()->get<gl_vertex, true>(vertex);
+    return set_vertex(*gl_world::get_current_world(), vertex);
+}
+
+gl_entity& gl_entity::set_vertex(gl_world& world, const char* vertex)
+{
+    vertex_ = world.get<gl_vertex, true>(vertex);
     return *this;
 }
 
 gl_entity& gl_entity::add_texture(const char* new_texture)
 {
-    texture_.push_back(gl_world::get_current_world()->get<gl_texture, true>(new_texture));
+    return add_texture(*gl_world::get_current_world(), new_texture);
+}
+
+gl_entity& gl_entity::add_texture(gl_world& world, const char* new_texture)
+{
+    texture_.push_back(world.get<gl_texture, true>(new_texture));
     return *this;
 }
 
@@ -414,17 +539,231 @@ gl_entity& gl_entity::remove_texture(int texture_index)
     return *this;
 }
 
+gl_entity& gl_entity::replace_texture(const char* new_texture, int texture_index)
+{
+    return replace_texture(*gl_world::get_current_world(), new_texture, texture_index);
+}
+
+gl_entity& gl_entity::replace_texture(gl_world& world, const char* new_texture, int texture_index)
+{
+    if (texture_index < 0 || texture_index >= static_cast<int>(texture_.size()))
+        throw std::runtime_error(std::string("Wrong texture index :") + std::to_string(texture_index));
+    texture_[texture_index] = world.get<gl_texture, true>(new_texture);
+    return *this;
+}
+
 gl_entity& gl_entity::clear_texture() noexcept
 {
     texture_.clear();
     return *this;
 }
 
+[[nodiscard]] const gl_mesh_range& gl_entity::get_mesh_range() const noexcept
+{
+    return mesh_range_;
+}
+
+gl_entity& gl_entity::set_mesh_range(const gl_mesh_range& range) noexcept
+{
+    mesh_range_ = range;
+    return *this;
+}
+
+[[nodiscard]] const gl_bounds& gl_entity::get_bounds() const noexcept
+{
+    if (!bounds_.empty())
+        return bounds_;
+
+    auto&& vertex_ptr = vertex_.lock();
+    if (vertex_ptr && mesh_range_.empty())
+        return vertex_ptr->get_bounds();
+    return bounds_;
+}
+
+gl_entity& gl_entity::set_bounds(const gl_bounds& bounds) noexcept
+{
+    bounds_ = bounds;
+    return *this;
+}
+
+[[nodiscard]] gl_sphere gl_entity::get_world_sphere()
+{
+    return get_bounds().sphere.transform(get_model_mat());
+}
+
+[[nodiscard]] gl_aabb gl_entity::get_world_aabb()
+{
+    return get_bounds().box.transform(get_model_mat());
+}
+
+[[nodiscard]] bool gl_entity::is_static() const noexcept
+{
+    return is_static_;
+}
+
+gl_entity& gl_entity::set_static(bool is_static) noexcept
+{
+    is_static_ = is_static;
+    return *this;
+}
+
+gl_entity& gl_entity::add_lod(const char* vertex, float threshold, const gl_mesh_range& range)
+{
+    return add_lod(*gl_world::get_current_world(), vertex, threshold, range);
+}
+
+gl_entity& gl_entity::add_lod(gl_world& world, const char* vertex, float threshold, const gl_mesh_range& range)
+{
+    assert(threshold > 0.0F);
+    lod_.push_back({ world.get<gl_vertex, true>(vertex), range, threshold });
+    assert(lod_coarseness_(lod_.size()) >= lod_coarseness_(lod_.size() - 1));
+    return *this;
+}
+
+gl_entity& gl_entity::clear_lod() noexcept
+{
+    lod_.clear();
+    lod_level_ = lod_fade_from_ = 0;
+    lod_fade_ = 0.0F;
+    return *this;
+}
+
+[[nodiscard]] const std::vector<gl_lod_level>& gl_entity::get_lod_levels() const noexcept
+{
+    return lod_;
+}
+
+gl_entity& gl_entity::set_lod_metric(gl_lod_metric metric) noexcept
+{
+    lod_metric_ = metric;
+    return *this;
+}
+
+gl_entity& gl_entity::set_lod_hysteresis(float hysteresis) noexcept
+{
+    assert(hysteresis >= 0.0F && hysteresis < 1.0F);
+    lod_hysteresis_ = hysteresis;
+    return *this;
+}
+
+gl_entity& gl_entity::set_lod_fade_frames(unsigned int frames) noexcept
+{
+    lod_fade_frames_ = frames;
+    return *this;
+}
+
+gl_entity& gl_entity::update_lod(const glm::vec3& camera_pos, float projection_scale)
+{
+    if (lod_.empty())
+        return *this;
+    select_lod_(camera_pos, projection_scale);
+    advance_lod_fade_();
+    return *this;
+}
+
+gl_entity& gl_entity::update_lod(gl_world& world)
+{
+    auto camera = world.get_current_camera_handle();
+    if (lod_.empty() || !world.exists(camera))
+        return *this;
+    select_lod_(world.get(camera).get_world_pos(), world.get_projection_mat()[1][1]);
+    // Shadow and other passes draw the entity several times per frame.
+    // A world which never starts a new frame has no frames to count, then the fade advances on every call.
+    if (world.get_frame() == 0 || lod_fade_frame_ != world.get_frame() + 1)
+    {
+        lod_fade_frame_ = world.get_frame() + 1;
+        advance_lod_fade_();
+    }
+    return *this;
+}
+
+void gl_entity::select_lod_(const glm::vec3& camera_pos, float projection_scale)
+{
+    auto sphere = get_world_sphere();
+    auto distance = glm::length((sphere.empty() ? get_world_pos() : sphere.center) - camera_pos);
+    auto coarseness = distance;
+    if (lod_metric_ == gl_lod_metric::screen_size)
+    {
+        // Screen size is radius * projection_scale / distance, its inverse grows like a distance
+        auto size = sphere.empty() ? 0.0F : sphere.radius * projection_scale;
+        coarseness = size > 0.0F ? distance / size : 0.0F;
+    }
+
+    // Move a level coarser only past the threshold plus the margin, and finer only below the threshold minus the margin
+    auto level = lod_level_;
+    while (level < lod_.size() && coarseness >= lod_coarseness_(level + 1) * (1.0F + lod_hysteresis_))
+        ++level;
+    while (level > 0 && coarseness < lod_coarseness_(level) * (1.0F - lod_hysteresis_))
+        --level;
+
+    if (level != lod_level_)
+    {
+        lod_fade_from_ = lod_fade_frames_ == 0 ? level : lod_level_;
+        lod_fade_ = 0.0F;
+        lod_level_ = level;
+    }
+}
+
+void gl_entity::advance_lod_fade_() noexcept
+{
+    if (lod_fade_from_ == lod_level_)
+        return;
+    lod_fade_ += 1.0F / static_cast<float>(lod_fade_frames_);
+    if (lod_fade_ >= 1.0F)
+    {
+        lod_fade_from_ = lod_level_;
+        lod_fade_ = 0.0F;
+    }
+}
+
+[[nodiscard]] std::size_t gl_entity::get_lod() const noexcept
+{
+    return lod_level_;
+}
+
+[[nodiscard]] std::size_t gl_entity::get_lod_fade_from() const noexcept
+{
+    return lod_fade_from_;
+}
+
+[[nodiscard]] float gl_entity::get_lod_fade() const noexcept
+{
+    return lod_fade_;
+}
+
+[[nodiscard]] const std::weak_ptr<gl_vertex>& gl_entity::get_lod_vertex(std::size_t level) const noexcept
+{
+    assert(level <= lod_.size());
+    return level == 0 ? vertex_ : lod_[level - 1].vertex;
+}
+
+[[nodiscard]] const gl_mesh_range& gl_entity::get_lod_mesh_range(std::size_t level) const noexcept
+{
+    assert(level <= lod_.size());
+    return level == 0 ? mesh_range_ : lod_[level - 1].mesh_range;
+}
+
+[[nodiscard]] float gl_entity::lod_coarseness_(std::size_t level) const noexcept
+{
+    if (level == 0)
+        return 0.0F;
+    auto threshold = lod_[level - 1].threshold;
+    return lod_metric_ == gl_lod_metric::distance ? threshold : 1.0F / threshold;
+}
+
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 gl_entity& gl_entity::draw(unsigned int draw_type, unsigned int elem_index_type)
 {
-    return draw([](gl_entity* entity) {
-        gl_world::get_current_world()->get_current_shader().uniform(glUniformMatrix4fv, "model", 1, GL_FALSE, glm::value_ptr(entity->get_model_mat()));
+    return draw(*gl_world::get_current_world(), draw_type, elem_index_type);
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_entity& gl_entity::draw(gl_world& world, unsigned int draw_type, unsigned int elem_index_type)
+{
+    auto& shader = world.get_current_shader();
+    auto model_slot = shader.get_model_slot();
+    return draw(world, [&shader, model_slot](gl_entity* entity) {
+        shader.set_uniform(model_slot, entity->get_model_mat());
     },
         draw_type, elem_index_type);
 }
@@ -432,12 +771,45 @@ gl_entity& gl_entity::draw(unsigned int draw_type, unsigned int elem_index_type)
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 gl_entity& gl_entity::draw(const std::function<void(gl_entity*)>& func, unsigned int draw_type, unsigned int elem_index_type)
 {
-    auto&& vertex_ptr = vertex_.lock();
+    return draw(*gl_world::get_current_world(), func, draw_type, elem_index_type);
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_entity& gl_entity::draw(gl_world& world, const std::function<void(gl_entity*)>& func, unsigned int draw_type, unsigned int elem_index_type)
+{
+    if (!world.is_visible(*this))
+        return *this;
+
+    update_lod(world);
+    auto* shader = world.exists(world.get_current_shader_handle()) ? &world.get_current_shader() : nullptr;
+    auto fade_slot = shader != nullptr ? shader->get_lod_fade_slot() : gl_uniform_slot<float> {};
+    // A fade which hasn't advanced yet shows the new level only
+    if (!fade_slot.is_valid() || lod_fade_from_ == lod_level_ || lod_fade_ == 0.0F)
+    {
+        draw_level_(world, lod_level_, func, draw_type, elem_index_type);
+        return *this;
+    }
+
+    // The two levels keep complementary dither patterns
+    shader->set_uniform(fade_slot, lod_fade_);
+    draw_level_(world, lod_level_, func, draw_type, elem_index_type);
+    shader->set_uniform(fade_slot, -lod_fade_);
+    draw_level_(world, lod_fade_from_, func, draw_type, elem_index_type);
+    shader->set_uniform(fade_slot, 0.0F);
+    return *this;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void gl_entity::draw_level_(gl_world& world, std::size_t level, const std::function<void(gl_entity*)>& func, unsigned int draw_type, unsigned int elem_index_type)
+{
+    auto&& vertex_ptr = get_lod_vertex(level).lock();
     if (!vertex_ptr) [[unlikely]]
     {
         throw std::runtime_error("Vertex ref is no longer available");
     }
+    const auto& mesh_range = get_lod_mesh_range(level);
 
+    world.use_resource(*vertex_ptr);
     vertex_ptr->bind_this();
     for (auto&& texture : texture_)
     {
@@ -446,16 +818,19 @@ gl_entity& gl_entity::draw(const std::function<void(gl_entity*)>& func, unsigned
         {
             throw std::runtime_error("Texture ref is no longer available");
         }
+        world.use_resource(*texture_ptr);
         texture_ptr->bind();
     }
 
     func(this);
 
-    if (vertex_ptr->is_ebo_binded())
+    if (!mesh_range.empty())
+        lomeglcall(glDrawElementsBaseVertex, draw_type, static_cast<GLsizei>(mesh_range.index_count), GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(mesh_range.first_index * sizeof(GLuint)), mesh_range.base_vertex); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+    else if (vertex_ptr->is_ebo_binded())
         lomeglcall(glDrawElements, draw_type, vertex_ptr->ebo_counts(), elem_index_type, nullptr); // NOLINT(modernize-use-nullptr)
     else
         lomeglcall(glDrawArrays, draw_type, 0, vertex_ptr->vbo_counts());
-    return *this;
 }
 
 } // namespace lomegl
\ No newline at end of file
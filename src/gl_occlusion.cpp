@@ -0,0 +1,308 @@
+#include "lomegl/gl_occlusion.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    define LOMEGL_OCCLUSION_X86 1
+#    include <immintrin.h>
+#endif
+
+namespace lomegl {
+
+namespace {
+
+    // Clip w below this is treated as crossing the near plane
+    constexpr float min_clip_w = 1e-5F;
+
+} // namespace
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_occlusion_culler::gl_occlusion_culler(int width, int height, std::size_t worker_count)
+    : width_((std::max(width, 1) + tile_size - 1) / tile_size * tile_size),
+      height_((std::max(height, 1) + tile_size - 1) / tile_size * tile_size),
+      tiles_x_(width_ / tile_size),
+      tiles_y_(height_ / tile_size),
+      workers_(std::make_unique<gl_thread_pool>(worker_count))
+{
+    bins_.resize(static_cast<std::size_t>(tiles_x_) * tiles_y_);
+
+    auto level_width = width_;
+    auto level_height = height_;
+    while (true)
+    {
+        level_sizes_.emplace_back(level_width, level_height);
+        levels_.emplace_back(static_cast<std::size_t>(level_width) * level_height, 1.0F);
+        if (level_width == 1 && level_height == 1)
+            break;
+        level_width = (level_width + 1) / 2;
+        level_height = (level_height + 1) / 2;
+    }
+}
+
+gl_occlusion_culler& gl_occlusion_culler::begin_frame(const glm::mat4& view_projection)
+{
+    view_projection_ = view_projection;
+    triangles_.clear();
+    for (auto& bin : bins_)
+        bin.clear();
+    ready_ = false;
+    return *this;
+}
+
+gl_occlusion_culler& gl_occlusion_culler::add_occluder(const gl_occluder_mesh& mesh, const glm::mat4& model)
+{
+    assert(mesh.indices.size() % 3 == 0);
+    auto model_view_projection = view_projection_ * model;
+    for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        setup_triangle_(model_view_projection * glm::vec4(mesh.positions[mesh.indices[i]], 1.0F),
+            model_view_projection * glm::vec4(mesh.positions[mesh.indices[i + 1]], 1.0F),
+            model_view_projection * glm::vec4(mesh.positions[mesh.indices[i + 2]], 1.0F));
+    }
+    return *this;
+}
+
+gl_occlusion_culler& gl_occlusion_culler::rasterize()
+{
+    std::fill(levels_.front().begin(), levels_.front().end(), 1.0F);
+    workers_->parallel_for(bins_.size(), [this](std::size_t tile) { rasterize_tile_(tile); });
+    build_hi_z_();
+    ready_ = true;
+    return *this;
+}
+
+[[nodiscard]] bool gl_occlusion_culler::is_visible(const gl_aabb& world_box) const noexcept
+{
+    if (!ready_ || world_box.empty())
+        return true;
+
+    auto min_x = std::numeric_limits<float>::max();
+    auto min_y = std::numeric_limits<float>::max();
+    auto max_x = std::numeric_limits<float>::lowest();
+    auto max_y = std::numeric_limits<float>::lowest();
+    auto min_z = std::numeric_limits<float>::max();
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        glm::vec3 point((corner & 1) != 0 ? world_box.max.x : world_box.min.x,
+            (corner & 2) != 0 ? world_box.max.y : world_box.min.y,
+            (corner & 4) != 0 ? world_box.max.z : world_box.min.z);
+        auto clip = view_projection_ * glm::vec4(point, 1.0F);
+        if (clip.w <= min_clip_w)
+            return true; // the box crosses the near plane
+
+        auto screen_x = (clip.x / clip.w * 0.5F + 0.5F) * static_cast<float>(width_);
+        auto screen_y = (clip.y / clip.w * 0.5F + 0.5F) * static_cast<float>(height_);
+        min_x = std::min(min_x, screen_x);
+        max_x = std::max(max_x, screen_x);
+        min_y = std::min(min_y, screen_y);
+        max_y = std::max(max_y, screen_y);
+        min_z = std::min(min_z, clip.z / clip.w * 0.5F + 0.5F);
+    }
+
+    // Off screen boxes are left to frustum culling
+    if (max_x < 0.0F || max_y < 0.0F || min_x >= static_cast<float>(width_) || min_y >= static_cast<float>(height_))
+        return true;
+
+    auto x0 = std::max(0, static_cast<int>(std::floor(min_x)));
+    auto y0 = std::max(0, static_cast<int>(std::floor(min_y)));
+    auto x1 = std::min(width_ - 1, static_cast<int>(std::floor(max_x)));
+    auto y1 = std::min(height_ - 1, static_cast<int>(std::floor(max_y)));
+
+    // The coarsest level where the rectangle covers at most 4x4 texels
+    int level = 0;
+    while (level + 1 < level_count() && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3))
+        ++level;
+
+    const auto& depth = levels_[level];
+    auto level_width = level_sizes_[level].first;
+    for (auto y = y0 >> level; y <= (y1 >> level); ++y)
+    {
+        for (auto x = x0 >> level; x <= (x1 >> level); ++x)
+        {
+            if (min_z <= depth[static_cast<std::size_t>(y) * level_width + x])
+                return true;
+        }
+    }
+    return false;
+}
+
+[[nodiscard]] bool gl_occlusion_culler::is_ready() const noexcept
+{
+    return ready_;
+}
+
+[[nodiscard]] int gl_occlusion_culler::width() const noexcept
+{
+    return width_;
+}
+
+[[nodiscard]] int gl_occlusion_culler::height() const noexcept
+{
+    return height_;
+}
+
+[[nodiscard]] std::size_t gl_occlusion_culler::triangle_count() const noexcept
+{
+    return triangles_.size();
+}
+
+[[nodiscard]] const std::vector<float>& gl_occlusion_culler::get_depth(int level) const noexcept
+{
+    assert(level >= 0 && level < level_count());
+    return levels_[level];
+}
+
+[[nodiscard]] int gl_occlusion_culler::level_count() const noexcept
+{
+    return static_cast<int>(levels_.size());
+}
+
+void gl_occlusion_culler::setup_triangle_(const glm::vec4& clip0, const glm::vec4& clip1, const glm::vec4& clip2)
+{
+    // Skipping an occluder is always safe
+    if (clip0.w <= min_clip_w || clip1.w <= min_clip_w || clip2.w <= min_clip_w)
+        return;
+
+    glm::vec3 vertex[3];
+    const glm::vec4* clip[3] = { &clip0, &clip1, &clip2 };
+    for (int i = 0; i < 3; ++i)
+    {
+        auto ndc = glm::vec3(*clip[i]) / clip[i]->w;
+        if (ndc.z < -1.0F)
+            return;
+        vertex[i] = glm::vec3((ndc.x * 0.5F + 0.5F) * static_cast<float>(width_), (ndc.y * 0.5F + 0.5F) * static_cast<float>(height_),
+            std::min(ndc.z * 0.5F + 0.5F, 1.0F));
+    }
+
+    auto area = (vertex[1].x - vertex[0].x) * (vertex[2].y - vertex[0].y) - (vertex[2].x - vertex[0].x) * (vertex[1].y - vertex[0].y);
+    if (area == 0.0F)
+        return;
+    // Both windings are occluders, make it counter-clockwise
+    if (area < 0.0F)
+    {
+        std::swap(vertex[1], vertex[2]);
+        area = -area;
+    }
+
+    triangle_ triangle {};
+    for (int i = 0; i < 3; ++i)
+    {
+        const auto& a = vertex[i];
+        const auto& b = vertex[(i + 1) % 3];
+        triangle.edge_a[i] = a.y - b.y;
+        triangle.edge_b[i] = b.x - a.x;
+        triangle.edge_c[i] = a.x * b.y - a.y * b.x;
+    }
+
+    auto d1 = vertex[1] - vertex[0];
+    auto d2 = vertex[2] - vertex[0];
+    triangle.dzdx = (d1.z * d2.y - d2.z * d1.y) / area;
+    triangle.dzdy = (d2.z * d1.x - d1.z * d2.x) / area;
+    triangle.z0 = vertex[0].z - triangle.dzdx * vertex[0].x - triangle.dzdy * vertex[0].y;
+
+    triangle.min_x = std::max(0, static_cast<int>(std::floor(std::min({ vertex[0].x, vertex[1].x, vertex[2].x }))));
+    triangle.min_y = std::max(0, static_cast<int>(std::floor(std::min({ vertex[0].y, vertex[1].y, vertex[2].y }))));
+    triangle.max_x = std::min(width_ - 1, static_cast<int>(std::ceil(std::max({ vertex[0].x, vertex[1].x, vertex[2].x }))));
+    triangle.max_y = std::min(height_ - 1, static_cast<int>(std::ceil(std::max({ vertex[0].y, vertex[1].y, vertex[2].y }))));
+    if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+        return;
+
+    auto index = static_cast<std::uint32_t>(triangles_.size());
+    triangles_.push_back(triangle);
+    for (auto tile_y = triangle.min_y / tile_size; tile_y <= triangle.max_y / tile_size; ++tile_y)
+    {
+        for (auto tile_x = triangle.min_x / tile_size; tile_x <= triangle.max_x / tile_size; ++tile_x)
+            bins_[static_cast<std::size_t>(tile_y) * tiles_x_ + tile_x].push_back(index);
+    }
+}
+
+void gl_occlusion_culler::rasterize_tile_(std::size_t tile) noexcept
+{
+    auto tile_x0 = static_cast<int>(tile % tiles_x_) * tile_size;
+    auto tile_y0 = static_cast<int>(tile / tiles_x_) * tile_size;
+    auto& depth = levels_.front();
+
+    for (auto index : bins_[tile])
+    {
+        const auto& triangle = triangles_[index];
+        // The tile is 4 pixels aligned, so the 4 pixel groups never leave it
+        auto x0 = std::max(triangle.min_x, tile_x0) & ~3;
+        auto x1 = std::min(triangle.max_x, tile_x0 + tile_size - 1);
+        auto y0 = std::max(triangle.min_y, tile_y0);
+        auto y1 = std::min(triangle.max_y, tile_y0 + tile_size - 1);
+
+        for (auto y = y0; y <= y1; ++y)
+        {
+            auto pixel_y = static_cast<float>(y) + 0.5F;
+            auto* row = depth.data() + static_cast<std::size_t>(y) * width_;
+#ifdef LOMEGL_OCCLUSION_X86
+            __m128 edge_a[3];
+            __m128 edge_row[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                edge_a[i] = _mm_set1_ps(triangle.edge_a[i]);
+                edge_row[i] = _mm_set1_ps(triangle.edge_b[i] * pixel_y + triangle.edge_c[i]);
+            }
+            auto dzdx = _mm_set1_ps(triangle.dzdx);
+            auto z_row = _mm_set1_ps(triangle.z0 + triangle.dzdy * pixel_y);
+            auto zero = _mm_setzero_ps();
+            auto one = _mm_set1_ps(1.0F);
+
+            for (auto x = x0; x <= x1; x += 4)
+            {
+                auto pixel_x = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), _mm_set_ps(3.5F, 2.5F, 1.5F, 0.5F));
+                auto inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edge_a[0], pixel_x), edge_row[0]), zero);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edge_a[1], pixel_x), edge_row[1]), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edge_a[2], pixel_x), edge_row[2]), zero));
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                auto z = _mm_min_ps(_mm_max_ps(_mm_add_ps(z_row, _mm_mul_ps(dzdx, pixel_x)), zero), one);
+                auto old_depth = _mm_loadu_ps(row + x);
+                auto new_depth = _mm_min_ps(old_depth, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_depth), _mm_andnot_ps(inside, old_depth)));
+            }
+#else
+            for (auto x = x0; x <= x1; ++x)
+            {
+                auto pixel_x = static_cast<float>(x) + 0.5F;
+                auto is_inside = true;
+                for (int i = 0; i < 3; ++i)
+                    is_inside = is_inside && triangle.edge_a[i] * pixel_x + triangle.edge_b[i] * pixel_y + triangle.edge_c[i] >= 0.0F;
+                if (is_inside)
+                    row[x] = std::min(row[x], std::clamp(triangle.z0 + triangle.dzdx * pixel_x + triangle.dzdy * pixel_y, 0.0F, 1.0F));
+            }
+#endif
+        }
+    }
+}
+
+void gl_occlusion_culler::build_hi_z_() noexcept
+{
+    for (std::size_t level = 1; level < levels_.size(); ++level)
+    {
+        const auto& source = levels_[level - 1];
+        auto& target = levels_[level];
+        auto [source_width, source_height] = level_sizes_[level - 1];
+        auto [target_width, target_height] = level_sizes_[level];
+
+        for (int y = 0; y < target_height; ++y)
+        {
+            auto y0 = static_cast<std::size_t>(y * 2);
+            auto y1 = static_cast<std::size_t>(std::min(y * 2 + 1, source_height - 1));
+            for (int x = 0; x < target_width; ++x)
+            {
+                auto x0 = static_cast<std::size_t>(x * 2);
+                auto x1 = static_cast<std::size_t>(std::min(x * 2 + 1, source_width - 1));
+                target[static_cast<std::size_t>(y) * target_width + x] = std::max({ source[y0 * source_width + x0], source[y0 * source_width + x1],
+                    source[y1 * source_width + x0], source[y1 * source_width + x1] });
+            }
+        }
+    }
+}
+
+} // namespace lomegl
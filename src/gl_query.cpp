@@ -0,0 +1,243 @@
+#include "lomegl/gl_query.h"
+#include "lomegl/gl_debug.h"
+#include "lomegl/gl_exception.h"
+#include "lomegl/gl_object.h"
+#include "lomegl/gl_shader.h"
+#include "lomegl/gl_state_cache.h"
+#include "lomegl/gl_texture.h"
+#include "lomegl/gl_vertex.h"
+#include "lomegl/gl_world.h"
+
+#include <algorithm>
+
+
+namespace lomegl {
+
+namespace {
+
+    constexpr const char* box_vertex_source = R"(#version 330 core
+layout(location = 0) in vec3 position;
+uniform mat4 box_mvp;
+void main()
+{
+    gl_Position = box_mvp * vec4(position, 1.0);
+}
+)";
+
+    constexpr const char* box_fragment_source = R"(#version 330 core
+out vec4 color;
+void main()
+{
+    color = vec4(1.0);
+}
+)";
+
+    constexpr gl_name box_mvp_name = "box_mvp";
+
+} // namespace
+
+[[nodiscard]] unsigned int gl_query_pool::acquire()
+{
+    if (free_.empty())
+    {
+        queries_.push_back(gl_val_factory<gl_val_type::query>());
+        return queries_.back().get();
+    }
+
+    auto query = free_.back();
+    free_.pop_back();
+    return query;
+}
+
+void gl_query_pool::release(unsigned int query)
+{
+    assert(query != 0);
+    free_.push_back(query);
+}
+
+[[nodiscard]] std::size_t gl_query_pool::size() const noexcept
+{
+    return queries_.size();
+}
+
+gl_occlusion_queries::gl_occlusion_queries(gl_world& world) : world_(&world)
+{
+}
+
+gl_occlusion_queries::~gl_occlusion_queries() = default;
+
+gl_occlusion_queries& gl_occlusion_queries::begin_frame()
+{
+    std::erase_if(orphaned_, [this](unsigned int query) {
+        GLuint available = 0;
+        lomeglcall(glGetQueryObjectuiv, query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0)
+            return false;
+        pool_.release(query);
+        --pending_;
+        return true;
+    });
+
+    removed_.clear();
+    states_.for_each([this](std::uint32_t atom, state_& state) {
+        if (state.query != 0)
+        {
+            GLuint available = 0;
+            lomeglcall(glGetQueryObjectuiv, state.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available != 0)
+            {
+                GLuint samples = 0;
+                lomeglcall(glGetQueryObjectuiv, state.query, GL_QUERY_RESULT, &samples);
+                state.visible = samples != 0;
+                state.query = 0;
+                --pending_;
+            }
+        }
+
+        if (!world_->exists_atom<gl_object>(atom))
+            removed_.push_back(atom);
+    });
+
+    for (auto atom : removed_)
+    {
+        auto& state = *states_.find(atom);
+        // A query still in flight can't be reused yet, it stays pending until its result is available
+        if (state.query != 0)
+            orphaned_.push_back(state.query);
+        else if (state.last_query != 0)
+            pool_.release(state.last_query);
+        states_.erase(atom);
+    }
+    return *this;
+}
+
+[[nodiscard]] bool gl_occlusion_queries::was_visible(const gl_entity& entity) const noexcept
+{
+    const auto* state = states_.find(entity.get_atom());
+    return state == nullptr || state->visible;
+}
+
+gl_occlusion_queries& gl_occlusion_queries::query_bounds(const std::vector<gl_entity*>& entities)
+{
+    if (entities.empty())
+        return *this;
+    gl_debug_group group("gl_occlusion_queries::query_bounds");
+    if (box_shader_ == nullptr)
+        create_box_resources_();
+
+    // Boxes containing the camera would be clipped by the near plane, they are always visible
+    const auto& projection = world_->get_projection_mat();
+    auto near = std::max(0.0F, projection[3][2] / (projection[2][2] - 1.0F));
+    auto camera = world_->get_current_camera_handle();
+    auto has_camera = world_->exists(camera);
+    auto camera_pos = has_camera ? world_->get(camera).get_world_pos() : glm::vec3(0.0F);
+    auto view_projection = projection * world_->get_view_mat();
+
+    // Restored below, read from the cache instead of stalling on glGet every frame
+    auto& cache = gl_state_cache::get();
+    auto color_mask = cache.get_color_mask();
+    auto depth_mask = cache.get_depth_mask();
+    auto cull_face = cache.is_capability_enabled(GL_CULL_FACE);
+    cache.color_mask(false, false, false, false).depth_mask(false).set_capability(GL_CULL_FACE, false);
+
+    box_shader_->use();
+    box_vertex_->bind_this();
+    for (auto* entity : entities)
+    {
+        auto& state = states_[entity->get_atom()];
+        if (state.query != 0)
+            continue;
+
+        auto box = entity->get_world_aabb();
+        auto near_box = gl_aabb { box.min - glm::vec3(near), box.max + glm::vec3(near) };
+        if (box.empty() || (has_camera && near_box.overlaps(gl_aabb { camera_pos, camera_pos })))
+        {
+            state.visible = true;
+            continue;
+        }
+
+        glm::mat4 box_mat(1.0F);
+        auto extent = box.extent();
+        box_mat[0][0] = extent.x;
+        box_mat[1][1] = extent.y;
+        box_mat[2][2] = extent.z;
+        box_mat[3] = glm::vec4(box.center(), 1.0F);
+        box_shader_->set_uniform(box_mvp_slot_, view_projection * box_mat);
+
+        if (state.last_query != 0)
+            pool_.release(state.last_query);
+        state.query = state.last_query = pool_.acquire();
+        ++pending_;
+
+        lomeglcall(glBeginQuery, target_, state.query);
+        lomeglcall(glDrawElements, GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, nullptr); // NOLINT(modernize-use-nullptr)
+        lomeglcall(glEndQuery, target_);
+    }
+
+    cache.color_mask(color_mask[0], color_mask[1], color_mask[2], color_mask[3])
+        .depth_mask(depth_mask)
+        .set_capability(GL_CULL_FACE, cull_face);
+    if (world_->exists(world_->get_current_shader_handle()))
+        world_->use_shader(world_->get_current_shader_handle());
+    return *this;
+}
+
+gl_occlusion_queries& gl_occlusion_queries::draw_conditional(const gl_entity& entity, const std::function<void()>& func)
+{
+    const auto* state = states_.find(entity.get_atom());
+    if (state == nullptr || state->last_query == 0)
+    {
+        func();
+        return *this;
+    }
+
+    // Never wait for the result, the GPU draws if it's not ready
+    lomeglcall(glBeginConditionalRender, state->last_query, GL_QUERY_NO_WAIT);
+    try
+    {
+        func();
+    } catch (...)
+    {
+        glEndConditionalRender();
+        throw;
+    }
+    lomeglcall(glEndConditionalRender);
+    return *this;
+}
+
+[[nodiscard]] std::size_t gl_occlusion_queries::pending_count() const noexcept
+{
+    return pending_;
+}
+
+void gl_occlusion_queries::create_box_resources_()
+{
+    // Conservative queries never miss a covered sample, they are preferred if available
+    target_ = GLAD_GL_VERSION_4_3 != 0 ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+
+    box_shader_ = std::make_unique<gl_shader>();
+    box_shader_->add_vertex(box_vertex_source).add_fragment(box_fragment_source).link_shader();
+    box_mvp_slot_ = box_shader_->find_uniform<glm::mat4>(box_mvp_name);
+
+    static constexpr float positions[] = {
+        -1.0F, -1.0F, -1.0F, 1.0F, -1.0F, -1.0F, 1.0F, 1.0F, -1.0F, -1.0F, 1.0F, -1.0F,
+        -1.0F, -1.0F, 1.0F, 1.0F, -1.0F, 1.0F, 1.0F, 1.0F, 1.0F, -1.0F, 1.0F, 1.0F
+    };
+    static constexpr unsigned char indices[] = {
+        0, 2, 1, 0, 3, 2, // back
+        4, 5, 6, 4, 6, 7, // front
+        0, 1, 5, 0, 5, 4, // bottom
+        3, 7, 6, 3, 6, 2, // top
+        0, 4, 7, 0, 7, 3, // left
+        1, 2, 6, 1, 6, 5  // right
+    };
+
+    box_vertex_ = std::make_unique<gl_vertex>();
+    box_vertex_->bind_this()
+        .bind_array_buffer_data(positions, sizeof(positions), GL_STATIC_DRAW, 8)
+        .vertex_attrib_pointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr)
+        .enable_vertex_attrib_array(0)
+        .bind_elemnt_buffer_data(indices, sizeof(indices), GL_STATIC_DRAW, 36);
+}
+
+} // namespace lomegl
@@ -0,0 +1,429 @@
+#include "lomegl/gl_render_queue.h"
+#include "lomegl/gl_debug.h"
+#include "lomegl/gl_exception.h"
+#include "lomegl/gl_object.h"
+#include "lomegl/gl_occlusion.h"
+#include "lomegl/gl_query.h"
+#include "lomegl/gl_shader.h"
+#include "lomegl/gl_state_cache.h"
+#include "lomegl/gl_texture.h"
+#include "lomegl/gl_vertex.h"
+#include "lomegl/gl_world.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace lomegl {
+
+gl_render_queue::gl_render_queue(gl_world& world) : world_(&world),
+                                                     indirect_buffer_(gl_val_factory<gl_val_type::vbo>(0))
+{
+    // 0 is a invaild value
+    indirect_buffer_.release();
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_render_queue& gl_render_queue::push(gl_entity& entity, unsigned int draw_type, unsigned int elem_index_type)
+{
+    return push(entity, world_->get_current_shader_handle(), draw_type, elem_index_type);
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_render_queue& gl_render_queue::push(gl_entity& entity, gl_handle<gl_shader> shader, unsigned int draw_type, unsigned int elem_index_type)
+{
+    // Squared distance to the camera, only used for ordering
+    float depth = 0;
+    auto camera = world_->get_current_camera_handle();
+    if (world_->exists(camera))
+    {
+        auto offset = entity.get_world_pos() - world_->get(camera).get_world_pos();
+        depth = glm::dot(offset, offset);
+    }
+
+    entity.update_lod(*world_);
+    auto fade = world_->get(shader).get_lod_fade_loc() != -1 ? entity.get_lod_fade() : 0.0F;
+    push_level_(entity, shader, entity.get_lod(), draw_type, elem_index_type, depth, fade);
+    // The level fading out keeps the complementary dither pattern
+    if (fade != 0.0F)
+        push_level_(entity, shader, entity.get_lod_fade_from(), draw_type, elem_index_type, depth, -fade);
+    is_sorted_ = false;
+    return *this;
+}
+
+gl_render_queue& gl_render_queue::sort()
+{
+    cull_();
+    auto count = static_cast<std::uint32_t>(packets_.size());
+    sorted_.resize(count);
+    scratch_.resize(count);
+
+    // Histograms of all 8 digits in one pass
+    std::array<std::array<std::uint32_t, 256>, 8> histograms {};
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        auto key = packets_[i].key;
+        sorted_[i] = { key, i };
+        for (int digit = 0; digit < 8; ++digit)
+            ++histograms[digit][(key >> (digit * 8)) & 0xFF];
+    }
+
+    // LSD radix sort, stable, digits shared by every key are skipped
+    for (int digit = 0; digit < 8 && count != 0; ++digit)
+    {
+        auto& histogram = histograms[digit];
+        auto shift = digit * 8;
+        if (histogram[(sorted_[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        std::uint32_t offset = 0;
+        for (auto& bucket : histogram)
+        {
+            auto bucket_count = bucket;
+            bucket = offset;
+            offset += bucket_count;
+        }
+        for (const auto& item : sorted_)
+            scratch_[histogram[(item.key >> shift) & 0xFF]++] = item;
+        sorted_.swap(scratch_);
+    }
+
+    is_sorted_ = true;
+    return *this;
+}
+
+gl_render_queue& gl_render_queue::submit()
+{
+    gl_debug_group group("gl_render_queue::submit");
+    if (!is_sorted_)
+        sort();
+
+    gl_shader* current_shader = nullptr;
+    gl_vertex* current_vertex = nullptr;
+    std::vector<gl_texture*> current_textures;
+
+    for (std::size_t first = 0; first < sorted_.size();)
+    {
+        const auto& packet = packets_[sorted_[first].index];
+
+        if (packet.shader != current_shader)
+        {
+            reset_lod_fade_(current_shader);
+            world_->use_shader(packet.shader_handle);
+            current_shader = packet.shader;
+        }
+
+        if (packet.vertex != current_vertex)
+        {
+            packet.vertex->bind_this();
+            current_vertex = packet.vertex;
+        }
+
+        const auto& textures = texture_sets_[packet.texture_set];
+        if (current_textures.size() < textures.size())
+            current_textures.resize(textures.size(), nullptr);
+        for (std::size_t unit = 0; unit < textures.size(); ++unit)
+        {
+            if (current_textures[unit] != textures[unit])
+            {
+                textures[unit]->active_texture_unit(GL_TEXTURE0 + static_cast<unsigned int>(unit)).bind();
+                current_textures[unit] = textures[unit];
+            }
+        }
+
+        auto last = first + 1;
+        if (packet.shader->get_instance_model_loc() != -1)
+        {
+            while (last < sorted_.size() && can_instance_(packet, packets_[sorted_[last].index]))
+                ++last;
+            draw_instanced_(first, last);
+        } else {
+            draw_packet_(packet);
+        }
+        first = last;
+    }
+
+    if (current_textures.size() > 1)
+        gl_state_cache::get().active_texture(GL_TEXTURE0);
+    reset_lod_fade_(current_shader);
+
+    // After the draws the depth buffer holds the occluders of this frame
+    if (occlusion_queries_ != nullptr)
+        occlusion_queries_->query_bounds(occlusion_tested_);
+
+    clear();
+    return *this;
+}
+
+gl_render_queue& gl_render_queue::clear() noexcept
+{
+    packets_.clear();
+    sorted_.clear();
+    shader_ids_.clear();
+    vertex_ids_.clear();
+    texture_set_ids_.clear();
+    texture_sets_.clear();
+    is_sorted_ = true;
+    return *this;
+}
+
+gl_render_queue& gl_render_queue::set_occlusion_queries(gl_occlusion_queries* queries) noexcept
+{
+    occlusion_queries_ = queries;
+    return *this;
+}
+
+gl_render_queue& gl_render_queue::set_multi_draw_enabled(bool enabled) noexcept
+{
+    multi_draw_enabled_ = enabled;
+    return *this;
+}
+
+[[nodiscard]] const std::vector<gl_draw_packet>& gl_render_queue::get_packets() const noexcept
+{
+    return packets_;
+}
+
+[[nodiscard]] std::size_t gl_render_queue::size() const noexcept
+{
+    return packets_.size();
+}
+
+[[nodiscard]] std::size_t gl_render_queue::get_culled_count() const noexcept
+{
+    return culled_count_;
+}
+
+void gl_render_queue::cull_()
+{
+    culled_count_ = 0;
+    occlusion_tested_.clear();
+    auto use_frustum = world_->is_frustum_culling_enabled() && world_->has_frustum();
+    if ((!use_frustum && occlusion_queries_ == nullptr) || packets_.empty())
+        return;
+
+    auto count = packets_.size();
+    const auto* occlusion_culler = use_frustum ? world_->get_occlusion_culler() : nullptr;
+    cull_visible_.assign(count, 1);
+    if (use_frustum)
+        cull_frustum_();
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto* entity = packets_[i].entity;
+        // Only the survivors of the frustum test are tested against the Hi-Z
+        auto visible = cull_visible_[i] != 0 && (occlusion_culler == nullptr || occlusion_culler->is_visible(entity->get_world_aabb()));
+        // Entities hidden in the last query results are skipped, but tested again after the draws
+        if (visible && occlusion_queries_ != nullptr)
+        {
+            occlusion_tested_.push_back(entity);
+            visible = occlusion_queries_->was_visible(*entity);
+        }
+        if (visible)
+            packets_[kept++] = packets_[i];
+    }
+    culled_count_ = count - kept;
+    packets_.resize(kept);
+}
+
+void gl_render_queue::cull_frustum_()
+{
+    auto count = packets_.size();
+    cull_spheres_.resize(count * 4);
+    cull_visible_.resize(count);
+    auto* center_x = cull_spheres_.data();
+    auto* center_y = center_x + count;
+    auto* center_z = center_y + count;
+    auto* radius = center_z + count;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto sphere = packets_[i].entity->get_world_sphere();
+        if (sphere.empty())
+        {
+            // Unknown bounds, never culled
+            center_x[i] = center_y[i] = center_z[i] = 0.0F;
+            radius[i] = std::numeric_limits<float>::infinity();
+            continue;
+        }
+        center_x[i] = sphere.center.x;
+        center_y[i] = sphere.center.y;
+        center_z[i] = sphere.center.z;
+        radius[i] = sphere.radius;
+    }
+    world_->get_frustum().cull_spheres(center_x, center_y, center_z, radius, static_cast<std::uint32_t>(count), cull_visible_.data());
+}
+
+[[nodiscard]] std::uint32_t gl_render_queue::get_texture_set_(const gl_entity& entity)
+{
+    std::vector<gl_texture*> textures;
+    textures.reserve(entity.get_texture_list().size());
+
+    // FNV-1a over the texture addresses
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (auto&& texture : entity.get_texture_list())
+    {
+        auto&& texture_ptr = texture.lock();
+        if (!texture_ptr) [[unlikely]]
+        {
+            throw std::runtime_error("Texture ref is no longer available");
+        }
+        world_->use_resource(*texture_ptr);
+        textures.push_back(texture_ptr.get());
+        hash = (hash ^ reinterpret_cast<std::uintptr_t>(texture_ptr.get())) * 1099511628211ULL; // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    }
+
+    auto&& [id, inserted] = texture_set_ids_.emplace(hash, static_cast<std::uint32_t>(texture_sets_.size()));
+    if (!inserted && texture_sets_[*id] == textures)
+        return *id;
+
+    // A new set, or a hash collision which is just kept as another set
+    texture_sets_.push_back(std::move(textures));
+    return static_cast<std::uint32_t>(texture_sets_.size() - 1);
+}
+
+[[nodiscard]] std::uint64_t gl_render_queue::make_key_(const gl_draw_packet& packet, float depth)
+{
+    // Ids beyond the field width share the last value, the draws are still correct but less grouped
+    auto field = [](auto& ids, std::uint32_t name, int bits) {
+        auto id = *ids.emplace(name, static_cast<std::uint32_t>(ids.size())).first;
+        return static_cast<std::uint64_t>(std::min(id, (1U << bits) - 1));
+    };
+
+    auto shader_id = field(shader_ids_, packet.shader->shader(), shader_bits);
+    auto vertex_id = field(vertex_ids_, packet.vertex->vao(), vertex_bits);
+    auto texture_set_id = static_cast<std::uint64_t>(std::min(packet.texture_set, (1U << texture_set_bits) - 1));
+
+    // The bits of a non-negative float are ordered like the float itself
+    auto depth_id = static_cast<std::uint64_t>(std::bit_cast<std::uint32_t>(std::max(depth, 0.0F)) >> (32 - depth_bits));
+
+    return (shader_id << (vertex_bits + texture_set_bits + depth_bits))
+        | (vertex_id << (texture_set_bits + depth_bits))
+        | (texture_set_id << depth_bits)
+        | depth_id;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void gl_render_queue::push_level_(gl_entity& entity, gl_handle<gl_shader> shader, std::size_t level, unsigned int draw_type,
+    unsigned int elem_index_type, float depth, float lod_fade)
+{
+    auto&& vertex_ptr = entity.get_lod_vertex(level).lock();
+    if (!vertex_ptr) [[unlikely]]
+    {
+        throw std::runtime_error("Vertex ref is no longer available");
+    }
+    world_->use_resource(*vertex_ptr);
+
+    const auto& mesh_range = entity.get_lod_mesh_range(level);
+    gl_draw_packet packet { 0, &entity, &world_->get(shader), shader, vertex_ptr.get(), get_texture_set_(entity), draw_type,
+        mesh_range.empty() ? elem_index_type : GL_UNSIGNED_INT, mesh_range, lod_fade };
+
+    packet.key = make_key_(packet, depth);
+    packets_.push_back(packet);
+}
+
+void gl_render_queue::set_lod_fade_(const gl_draw_packet& packet)
+{
+    auto slot = packet.shader->get_lod_fade_slot();
+    // `set_uniform` skips the value the program already has
+    if (slot.is_valid())
+        packet.shader->set_uniform(slot, packet.lod_fade);
+}
+
+void gl_render_queue::reset_lod_fade_(gl_shader* shader)
+{
+    // Don't leave a dither on the shader for later draws
+    if (shader != nullptr && shader->get_lod_fade_slot().is_valid())
+        shader->set_uniform(shader->get_lod_fade_slot(), 0.0F);
+}
+
+void gl_render_queue::draw_packet_(const gl_draw_packet& packet)
+{
+    set_lod_fade_(packet);
+    packet.shader->set_uniform(packet.shader->get_model_slot(), packet.entity->get_model_mat());
+
+    if (!packet.mesh_range.empty())
+        lomeglcall(glDrawElementsBaseVertex, packet.draw_type, static_cast<GLsizei>(packet.mesh_range.index_count), GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(packet.mesh_range.first_index * sizeof(GLuint)), packet.mesh_range.base_vertex); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+    else if (packet.vertex->is_ebo_binded())
+        lomeglcall(glDrawElements, packet.draw_type, packet.vertex->ebo_counts(), packet.elem_index_type, nullptr); // NOLINT(modernize-use-nullptr)
+    else
+        lomeglcall(glDrawArrays, packet.draw_type, 0, packet.vertex->vbo_counts());
+}
+
+void gl_render_queue::draw_instanced_(std::size_t first, std::size_t last)
+{
+    const auto& packet = packets_[sorted_[first].index];
+    auto count = static_cast<GLsizei>(last - first);
+
+    instance_models_.clear();
+    commands_.clear();
+    for (auto i = first; i < last; ++i)
+    {
+        const auto& item = packets_[sorted_[i].index];
+        instance_models_.push_back(item.entity->get_model_mat());
+        if (item.mesh_range.empty())
+            continue;
+
+        // Adjacent draws of the same mesh share a command
+        auto instance = static_cast<GLuint>(i - first);
+        const auto& range = item.mesh_range;
+        if (!commands_.empty() && commands_.back().first_index == range.first_index && commands_.back().base_vertex == range.base_vertex
+            && commands_.back().count == range.index_count && commands_.back().base_instance + commands_.back().instance_count == instance)
+            ++commands_.back().instance_count;
+        else
+            commands_.push_back({ range.index_count, 1, range.first_index, range.base_vertex, instance });
+    }
+    packet.vertex->upload_instance_models(glm::value_ptr(instance_models_.front()), count,
+        static_cast<GLuint>(packet.shader->get_instance_model_loc()));
+    set_lod_fade_(packet);
+
+    if (!packet.mesh_range.empty())
+        draw_indirect_(packet);
+    else if (packet.vertex->is_ebo_binded())
+        lomeglcall(glDrawElementsInstanced, packet.draw_type, packet.vertex->ebo_counts(), packet.elem_index_type, nullptr, count); // NOLINT(modernize-use-nullptr)
+    else
+        lomeglcall(glDrawArraysInstanced, packet.draw_type, 0, packet.vertex->vbo_counts(), count);
+}
+
+void gl_render_queue::draw_indirect_(const gl_draw_packet& packet)
+{
+    if (multi_draw_enabled_ && GLAD_GL_VERSION_4_3 != 0)
+    {
+        if (indirect_buffer_.get() == 0)
+            indirect_buffer_ = gl_val_factory<gl_val_type::vbo>();
+
+        auto size = static_cast<GLsizeiptr>(commands_.size() * sizeof(gl_draw_indirect_command));
+        if (size > indirect_capacity_)
+            indirect_capacity_ = std::max(size, indirect_capacity_ * 2);
+        gl_state_cache::get().bind_buffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_.get());
+        lomeglcall(glBufferData, GL_DRAW_INDIRECT_BUFFER, indirect_capacity_, nullptr, GL_STREAM_DRAW);
+        lomeglcall(glBufferSubData, GL_DRAW_INDIRECT_BUFFER, 0, size, commands_.data());
+        lomeglcall(glMultiDrawElementsIndirect, packet.draw_type, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(commands_.size()), 0); // NOLINT(modernize-use-nullptr)
+        gl_state_cache::get().bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return;
+    }
+
+    if (GLAD_GL_VERSION_4_2 == 0) [[unlikely]]
+        throw gl_error("Instanced draws of mesh ranges need OpenGL 4.2");
+
+    for (const auto& command : commands_)
+        lomeglcall(glDrawElementsInstancedBaseVertexBaseInstance, packet.draw_type, static_cast<GLsizei>(command.count), GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(command.first_index * sizeof(GLuint)), static_cast<GLsizei>(command.instance_count), // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+            command.base_vertex, command.base_instance);
+}
+
+[[nodiscard]] bool gl_render_queue::can_instance_(const gl_draw_packet& lhs, const gl_draw_packet& rhs) noexcept
+{
+    // Ranges of the same pool can be merged, mixing ranged and whole vertex draws can't
+    return lhs.shader == rhs.shader && lhs.vertex == rhs.vertex && lhs.texture_set == rhs.texture_set
+        && lhs.draw_type == rhs.draw_type && lhs.elem_index_type == rhs.elem_index_type
+        && lhs.mesh_range.empty() == rhs.mesh_range.empty() && lhs.lod_fade == rhs.lod_fade;
+}
+
+} // namespace lomegl
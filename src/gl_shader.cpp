@@ -1,12 +1,50 @@
 #include <glad/glad.h>
 
+#include "lomegl/gl_debug.h"
 #include "lomegl/gl_exception.h"
 #include "lomegl/gl_shader.h"
+#include "lomegl/gl_state_cache.h"
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
 
 namespace lomegl {
 
+namespace {
+
+    // Arrays are reported as `name[0]`
+    std::string_view strip_array_suffix(std::string_view name) noexcept
+    {
+        constexpr std::string_view suffix = "[0]";
+        if (name.size() > suffix.size() && name.substr(name.size() - suffix.size()) == suffix)
+            name.remove_suffix(suffix.size());
+        return name;
+    }
+
+    // Built-in inputs such as gl_VertexID are active attributes without a location
+    bool is_builtin_name(std::string_view name) noexcept
+    {
+        return name.starts_with("gl_");
+    }
+
+    // A binary of another format(e.g. saved by another driver) raises GL_INVALID_ENUM instead of failing the link
+    bool is_binary_format_supported(unsigned int binary_format)
+    {
+        GLint count = 0;
+        lomeglcall(glGetIntegerv, GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+        if (count <= 0)
+            return false;
+        std::vector<GLint> formats(static_cast<std::size_t>(count));
+        lomeglcall(glGetIntegerv, GL_PROGRAM_BINARY_FORMATS, formats.data());
+        return std::ranges::find(formats, static_cast<GLint>(binary_format)) != formats.end();
+    }
+
+} // namespace
+
 gl_shader::gl_shader() : shader_program_(gl_val_factory<gl_val_type::program>()),
                          vertex_shader_(gl_val_factory<gl_val_type::vertex_shader>(0)),
                          fragment_shader_(gl_val_factory<gl_val_type::fragment_shader>(0)),
@@ -36,11 +74,24 @@ gl_shader::~gl_shader() = default;
     return glGetUniformLocation(shader_program_.get(), uniform_name);
 }
 
+[[nodiscard]] int gl_shader::get_instance_model_loc() const noexcept
+{
+    assert(is_vaild());
+    return instance_model_loc_;
+}
+
+[[nodiscard]] int gl_shader::get_lod_fade_loc() const noexcept
+{
+    assert(is_vaild());
+    return lod_fade_loc_;
+}
+
 gl_shader& gl_shader::add_vertex(const char* vertex_source)
 {
     assert(!is_linked_ && vertex_shader_.get() == 0);
     vertex_shader_ = gl_val_factory<gl_val_type::vertex_shader>();
     add_source_(vertex_shader_, "vertex shader", vertex_source);
+    vertex_source_ = vertex_source;
     return *this;
 }
 
@@ -49,6 +100,7 @@ gl_shader& gl_shader::add_geometry(const char* geometry_source)
     assert(!is_linked_ && geometry_shader_.get() == 0);
     geometry_shader_ = gl_val_factory<gl_val_type::geometry_shader>();
     add_source_(geometry_shader_, "geometry shader", geometry_source);
+    geometry_source_ = geometry_source;
     return *this;
 }
 
@@ -57,12 +109,15 @@ gl_shader& gl_shader::add_fragment(const char* fragment_source)
     assert(!is_linked_ && fragment_shader_.get() == 0);
     fragment_shader_ = gl_val_factory<gl_val_type::fragment_shader>();
     add_source_(fragment_shader_, "fragment shader", fragment_source);
+    fragment_source_ = fragment_source;
     return *this;
 }
 
 gl_shader& gl_shader::link_shader()
 {
     assert(!is_linked_ && vertex_shader_.get() != 0 && fragment_shader_.get() != 0);
+    if (GLAD_GL_VERSION_4_1 != 0)
+        lomeglcall(glProgramParameteri, shader_program_.get(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     lomeglcall(glLinkProgram, shader_program_.get());
 
     int success = 0;
@@ -88,13 +143,343 @@ gl_shader& gl_shader::link_shader()
     fragment_shader_.release();
     vertex_shader_.get() = fragment_shader_.get() = 0;
     is_linked_ = true;
+    reflect_();
+    return *this;
+}
+
+bool gl_shader::load_binary(unsigned int binary_format, const void* binary, int size)
+{
+    assert(!is_linked_ && vertex_shader_.get() == 0 && fragment_shader_.get() == 0);
+    if (GLAD_GL_VERSION_4_1 == 0 || size == 0 || !is_binary_format_supported(binary_format))
+        return false;
+
+    // A rejected binary should only fail the link, but some drivers also raise an error.
+    // It's taken here, so the next checked call doesn't throw it and the caller can compile the sources.
+    // Errors raised before are reported first, so they aren't mistaken for the rejection and dropped.
+    if (get_gl_error_policy() != gl_error_policy::off)
+        check_gl_errors();
+    glProgramBinary(shader_program_.get(), binary_format, binary, size);
+    if (glGetError() != GL_NO_ERROR)
+        return false;
+    int success = 0;
+    lomeglcall(glGetProgramiv, shader_program_.get(), GL_LINK_STATUS, &success);
+    if (success == 0)
+        return false;
+
+    is_linked_ = true;
+    reflect_();
+    return true;
+}
+
+[[nodiscard]] std::vector<unsigned char> gl_shader::get_binary(unsigned int& binary_format) const
+{
+    assert(is_vaild());
+    binary_format = 0;
+    if (GLAD_GL_VERSION_4_1 == 0)
+        return {};
+
+    int length = 0;
+    lomeglcall(glGetProgramiv, shader_program_.get(), GL_PROGRAM_BINARY_LENGTH, &length);
+    std::vector<unsigned char> binary(static_cast<std::size_t>(length));
+    if (length != 0)
+        lomeglcall(glGetProgramBinary, shader_program_.get(), length, nullptr, &binary_format, binary.data());
+    return binary;
+}
+
+gl_shader& gl_shader::set_sources(std::string vertex_source, std::string geometry_source, std::string fragment_source)
+{
+    vertex_source_ = std::move(vertex_source);
+    geometry_source_ = std::move(geometry_source);
+    fragment_source_ = std::move(fragment_source);
+    return *this;
+}
+
+[[nodiscard]] const std::string& gl_shader::get_vertex_source() const noexcept
+{
+    return vertex_source_;
+}
+
+[[nodiscard]] const std::string& gl_shader::get_geometry_source() const noexcept
+{
+    return geometry_source_;
+}
+
+[[nodiscard]] const std::string& gl_shader::get_fragment_source() const noexcept
+{
+    return fragment_source_;
+}
+
+gl_shader& gl_shader::label_objects()
+{
+    // glCreateProgram creates the object at once
+    gl_object_label(GL_PROGRAM, shader_program_.get(), get_id());
     return *this;
 }
 
+[[nodiscard]] const std::vector<gl_shader_resource>& gl_shader::get_resources() const noexcept
+{
+    return resources_;
+}
+
+[[nodiscard]] const gl_shader_resource* gl_shader::find_resource(gl_shader_resource_kind kind, gl_name name) const noexcept
+{
+    auto index = find_resource_index_(kind, name);
+    return index != gl_uniform_slot<glm::mat4>::invalid_index ? &resources_[index] : nullptr;
+}
+
+[[nodiscard]] gl_uniform_slot<glm::mat4> gl_shader::get_model_slot() const
+{
+    return get_matrix_slot_(model_index_, model_name);
+}
+
+[[nodiscard]] gl_uniform_slot<glm::mat4> gl_shader::get_view_slot() const
+{
+    return get_matrix_slot_(view_index_, view_name);
+}
+
+[[nodiscard]] gl_uniform_slot<glm::mat4> gl_shader::get_projection_slot() const
+{
+    return get_matrix_slot_(projection_index_, projection_name);
+}
+
+[[nodiscard]] gl_uniform_slot<float> gl_shader::get_lod_fade_slot() const noexcept
+{
+    if (lod_fade_index_ == gl_uniform_slot<float>::invalid_index || resources_[lod_fade_index_].location == -1)
+        return {};
+    assert(resources_[lod_fade_index_].type == GL_FLOAT);
+    return gl_uniform_slot<float>(lod_fade_index_, shader_program_.get());
+}
+
+[[nodiscard]] const gl_uniform_stats& gl_shader::get_uniform_stats() const noexcept
+{
+    return uniform_stats_;
+}
+
+gl_shader& gl_shader::reset_uniform_stats() noexcept
+{
+    uniform_stats_ = {};
+    return *this;
+}
+
+gl_shader& gl_shader::invalidate_uniform_values() noexcept
+{
+    for (auto& value : uniform_values_)
+        value.known_count = 0;
+    return *this;
+}
+
+[[nodiscard]] int gl_shader::find_uniform_loc_(gl_name uniform_name)
+{
+    // Keyed by the precomputed hash, so a hit doesn't lock the atom table
+    const auto* cached = uniform_loc_map.find(uniform_name.hash);
+    if (cached != nullptr && cached->name == uniform_name.view())
+        return cached->location;
+
+    // Elements of arrays and members of structs are not in the resource table
+    const auto* resource = find_resource(gl_shader_resource_kind::uniform, uniform_name);
+    auto loc = resource != nullptr ? resource->location : get_uniform_loc(uniform_name);
+    if (loc == -1)
+        throw shader_error(std::string("Can't find uniform name ") + uniform_name.str);
+    // A name colliding with a cached one is looked up each time
+    if (cached == nullptr)
+        uniform_loc_map.emplace(uniform_name.hash, uniform_loc_ { uniform_name.str, loc });
+    return loc;
+}
+
+void gl_shader::reflect_()
+{
+    resources_.clear();
+    if (GLAD_GL_VERSION_4_3 != 0)
+        reflect_interfaces_();
+    else
+        reflect_active_();
+    std::sort(resources_.begin(), resources_.end(), [](const gl_shader_resource& lhs, const gl_shader_resource& rhs) {
+        return std::tie(lhs.kind, lhs.atom) < std::tie(rhs.kind, rhs.atom);
+    });
+
+    const auto* instance_model = find_resource(gl_shader_resource_kind::attribute, instance_model_name);
+    const auto* lod_fade = find_resource(gl_shader_resource_kind::uniform, lod_fade_name);
+    instance_model_loc_ = instance_model != nullptr ? instance_model->location : -1;
+    lod_fade_loc_ = lod_fade != nullptr ? lod_fade->location : -1;
+    model_index_ = find_resource_index_(gl_shader_resource_kind::uniform, model_name);
+    view_index_ = find_resource_index_(gl_shader_resource_kind::uniform, view_name);
+    projection_index_ = find_resource_index_(gl_shader_resource_kind::uniform, projection_name);
+    lod_fade_index_ = find_resource_index_(gl_shader_resource_kind::uniform, lod_fade_name);
+    reset_uniform_values_();
+}
+
+void gl_shader::reset_uniform_values_()
+{
+    uniform_values_.assign(resources_.size(), {});
+    location_indices_.clear();
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < resources_.size(); ++i)
+    {
+        const auto& resource = resources_[i];
+        if (resource.kind == gl_shader_resource_kind::uniform && resource.location != -1)
+        {
+            // Elements of an array have consecutive locations from the one of the array
+            auto end = static_cast<std::size_t>(resource.location) + static_cast<std::size_t>(resource.array_size);
+            if (location_indices_.size() < end)
+                location_indices_.resize(end, gl_uniform_slot<float>::invalid_index);
+            std::fill(location_indices_.begin() + resource.location, location_indices_.begin() + static_cast<std::ptrdiff_t>(end), static_cast<std::uint32_t>(i));
+        }
+        auto element_size = get_uniform_type_size(resource.type);
+        // Members of blocks are set through their buffer
+        if (resource.kind != gl_shader_resource_kind::uniform || resource.location == -1 || element_size == 0)
+            continue;
+        uniform_values_[i].offset = static_cast<std::uint32_t>(size);
+        uniform_values_[i].element_size = static_cast<std::uint32_t>(element_size);
+        size += element_size * static_cast<std::size_t>(resource.array_size);
+    }
+    uniform_bytes_.assign(size, 0);
+}
+
+void gl_shader::forget_uniform_value_(int location) noexcept
+{
+    if (location < 0 || static_cast<std::size_t>(location) >= location_indices_.size())
+        return;
+    auto index = location_indices_[location];
+    if (index != gl_uniform_slot<float>::invalid_index)
+        uniform_values_[index].known_count = 0;
+}
+
+void gl_shader::reflect_interfaces_()
+{
+    constexpr std::array interfaces {
+        std::pair { GLenum { GL_UNIFORM }, gl_shader_resource_kind::uniform },
+        std::pair { GLenum { GL_UNIFORM_BLOCK }, gl_shader_resource_kind::uniform_block },
+        std::pair { GLenum { GL_PROGRAM_INPUT }, gl_shader_resource_kind::attribute },
+        std::pair { GLenum { GL_SHADER_STORAGE_BLOCK }, gl_shader_resource_kind::storage_block },
+    };
+
+    auto program = shader_program_.get();
+    std::string name;
+    for (auto [interface, kind] : interfaces)
+    {
+        GLint count = 0;
+        GLint max_length = 0;
+        lomeglcall(glGetProgramInterfaceiv, program, interface, GL_ACTIVE_RESOURCES, &count);
+        lomeglcall(glGetProgramInterfaceiv, program, interface, GL_MAX_NAME_LENGTH, &max_length);
+        name.resize(static_cast<std::size_t>(std::max(max_length, 1)));
+        for (GLuint index = 0; index < static_cast<GLuint>(count); ++index)
+        {
+            GLsizei length = 0;
+            lomeglcall(glGetProgramResourceName, program, interface, index, max_length, &length, name.data());
+            std::string_view view(name.data(), static_cast<std::size_t>(length));
+            if (is_builtin_name(view))
+                continue;
+
+            gl_shader_resource resource;
+            resource.kind = kind;
+            resource.atom = gl_atom_table::intern(strip_array_suffix(view));
+            if (kind == gl_shader_resource_kind::uniform || kind == gl_shader_resource_kind::attribute)
+            {
+                // GL_OFFSET and GL_BLOCK_INDEX are only properties of uniforms
+                constexpr std::array<GLenum, 5> props { GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE, GL_OFFSET, GL_BLOCK_INDEX };
+                std::array<GLint, 5> values { 0, -1, 1, -1, -1 };
+                auto prop_count = static_cast<GLsizei>(kind == gl_shader_resource_kind::uniform ? 5 : 3);
+                lomeglcall(glGetProgramResourceiv, program, interface, index, prop_count, props.data(), prop_count, nullptr, values.data());
+                resource.type = static_cast<GLenum>(values[0]);
+                resource.location = values[1];
+                resource.array_size = values[2];
+                resource.offset = values[3];
+                resource.block_index = values[4];
+            } else {
+                constexpr std::array<GLenum, 2> props { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+                std::array<GLint, 2> values {};
+                lomeglcall(glGetProgramResourceiv, program, interface, index, 2, props.data(), 2, nullptr, values.data());
+                resource.location = -1;
+                resource.binding = values[0];
+                resource.data_size = values[1];
+            }
+            resources_.push_back(resource);
+        }
+    }
+}
+
+void gl_shader::reflect_active_()
+{
+    auto program = shader_program_.get();
+    std::string name;
+    auto read_count = [program, &name](GLenum count_pname, GLenum length_pname) {
+        GLint count = 0;
+        GLint max_length = 0;
+        lomeglcall(glGetProgramiv, program, count_pname, &count);
+        lomeglcall(glGetProgramiv, program, length_pname, &max_length);
+        name.resize(static_cast<std::size_t>(std::max(max_length, 1)));
+        return static_cast<GLuint>(count);
+    };
+
+    auto uniform_count = read_count(GL_ACTIVE_UNIFORMS, GL_ACTIVE_UNIFORM_MAX_LENGTH);
+    for (GLuint index = 0; index < uniform_count; ++index)
+    {
+        gl_shader_resource resource;
+        GLsizei length = 0;
+        lomeglcall(glGetActiveUniform, program, index, static_cast<GLsizei>(name.size()), &length, &resource.array_size, &resource.type, name.data());
+        std::string_view view(name.data(), static_cast<std::size_t>(length));
+        if (is_builtin_name(view))
+            continue;
+        resource.kind = gl_shader_resource_kind::uniform;
+        resource.atom = gl_atom_table::intern(strip_array_suffix(view));
+        resource.location = glGetUniformLocation(program, name.c_str());
+        lomeglcall(glGetActiveUniformsiv, program, 1, &index, GL_UNIFORM_OFFSET, &resource.offset);
+        lomeglcall(glGetActiveUniformsiv, program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &resource.block_index);
+        resources_.push_back(resource);
+    }
+
+    auto block_count = read_count(GL_ACTIVE_UNIFORM_BLOCKS, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH);
+    for (GLuint index = 0; index < block_count; ++index)
+    {
+        gl_shader_resource resource;
+        GLsizei length = 0;
+        lomeglcall(glGetActiveUniformBlockName, program, index, static_cast<GLsizei>(name.size()), &length, name.data());
+        resource.kind = gl_shader_resource_kind::uniform_block;
+        resource.atom = gl_atom_table::intern(strip_array_suffix({ name.data(), static_cast<std::size_t>(length) }));
+        lomeglcall(glGetActiveUniformBlockiv, program, index, GL_UNIFORM_BLOCK_BINDING, &resource.binding);
+        lomeglcall(glGetActiveUniformBlockiv, program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &resource.data_size);
+        resources_.push_back(resource);
+    }
+
+    auto attribute_count = read_count(GL_ACTIVE_ATTRIBUTES, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH);
+    for (GLuint index = 0; index < attribute_count; ++index)
+    {
+        gl_shader_resource resource;
+        GLsizei length = 0;
+        lomeglcall(glGetActiveAttrib, program, index, static_cast<GLsizei>(name.size()), &length, &resource.array_size, &resource.type, name.data());
+        std::string_view view(name.data(), static_cast<std::size_t>(length));
+        if (is_builtin_name(view))
+            continue;
+        resource.kind = gl_shader_resource_kind::attribute;
+        resource.atom = gl_atom_table::intern(strip_array_suffix(view));
+        resource.location = glGetAttribLocation(program, name.c_str());
+        resources_.push_back(resource);
+    }
+}
+
+[[nodiscard]] std::uint32_t gl_shader::find_resource_index_(gl_shader_resource_kind kind, gl_name name) const noexcept
+{
+    auto atom = gl_atom_table::find(name);
+    auto it = std::lower_bound(resources_.begin(), resources_.end(), std::pair { kind, atom }, [](const gl_shader_resource& resource, const auto& key) {
+        return std::tie(resource.kind, resource.atom) < std::tie(key.first, key.second);
+    });
+    if (it == resources_.end() || it->kind != kind || it->atom != atom)
+        return gl_uniform_slot<glm::mat4>::invalid_index;
+    return static_cast<std::uint32_t>(it - resources_.begin());
+}
+
+[[nodiscard]] gl_uniform_slot<glm::mat4> gl_shader::get_matrix_slot_(std::uint32_t index, gl_name uniform_name) const
+{
+    if (index == gl_uniform_slot<glm::mat4>::invalid_index || resources_[index].location == -1)
+        throw shader_error(std::string("Can't find uniform name ") + uniform_name.str);
+    assert(resources_[index].type == GL_FLOAT_MAT4);
+    return gl_uniform_slot<glm::mat4>(index, shader_program_.get());
+}
+
 gl_shader& gl_shader::use()
 {
     assert(is_vaild());
-    lomeglcall(glUseProgram, shader_program_.get());
+    gl_state_cache::get().use_program(shader_program_.get());
     return *this;
 }
 } // namespace lomegl
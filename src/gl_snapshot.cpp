@@ -0,0 +1,823 @@
+#include "lomegl/gl_snapshot.h"
+#include "lomegl/gl_exception.h"
+#include "lomegl/gl_object.h"
+#include "lomegl/gl_shader.h"
+#include "lomegl/gl_state_cache.h"
+#include "lomegl/gl_texture.h"
+#include "lomegl/gl_vertex.h"
+#include "lomegl/gl_world.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lomegl {
+
+gl_mapped_file::gl_mapped_file(const std::string& path)
+{
+#ifdef _WIN32
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) // NOLINT(cppcoreguidelines-pro-type-cstyle-cast, performance-no-int-to-ptr)
+    {
+        file_ = nullptr;
+        throw std::runtime_error("Can't open file " + path);
+    }
+
+    LARGE_INTEGER file_size {};
+    if (GetFileSizeEx(file_, &file_size) == 0)
+    {
+        close_();
+        throw std::runtime_error("Can't get the size of file " + path);
+    }
+    size_ = static_cast<std::size_t>(file_size.QuadPart);
+    if (size_ == 0)
+        return;
+
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ != nullptr)
+        data_ = static_cast<const unsigned char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr)
+    {
+        close_();
+        throw std::runtime_error("Can't map file " + path);
+    }
+#else
+    auto file = open(path.c_str(), O_RDONLY); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (file == -1)
+        throw std::runtime_error("Can't open file " + path);
+
+    struct stat file_stat {};
+    if (fstat(file, &file_stat) != 0)
+    {
+        close(file);
+        throw std::runtime_error("Can't get the size of file " + path);
+    }
+    size_ = static_cast<std::size_t>(file_stat.st_size);
+    if (size_ == 0)
+    {
+        close(file);
+        return;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    auto* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapped == MAP_FAILED) // NOLINT(cppcoreguidelines-pro-type-cstyle-cast, performance-no-int-to-ptr)
+    {
+        size_ = 0;
+        throw std::runtime_error("Can't map file " + path);
+    }
+    data_ = static_cast<const unsigned char*>(mapped);
+#endif
+}
+
+gl_mapped_file::~gl_mapped_file()
+{
+    close_();
+}
+
+gl_mapped_file::gl_mapped_file(gl_mapped_file&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+gl_mapped_file& gl_mapped_file::operator=(gl_mapped_file&& other) noexcept
+{
+    if (this != &other)
+    {
+        close_();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+        file_ = std::exchange(other.file_, nullptr);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+    }
+    return *this;
+}
+
+[[nodiscard]] const unsigned char* gl_mapped_file::data() const noexcept
+{
+    return data_;
+}
+
+[[nodiscard]] std::size_t gl_mapped_file::size() const noexcept
+{
+    return size_;
+}
+
+void gl_mapped_file::close_() noexcept
+{
+#ifdef _WIN32
+    if (data_ != nullptr)
+        UnmapViewOfFile(data_);
+    if (mapping_ != nullptr)
+        CloseHandle(mapping_);
+    if (file_ != nullptr)
+        CloseHandle(file_);
+    file_ = mapping_ = nullptr;
+#else
+    if (data_ != nullptr)
+        munmap(const_cast<unsigned char*>(data_), size_); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+namespace {
+
+    [[nodiscard]] constexpr std::size_t align_snapshot(std::size_t size) noexcept
+    {
+        return (size + gl_snapshot::alignment - 1) / gl_snapshot::alignment * gl_snapshot::alignment;
+    }
+
+    // Build the file in memory: tables are reserved first, blobs are appended after them
+    class snapshot_writer
+    {
+    public:
+        std::uint64_t reserve(std::size_t size)
+        {
+            auto offset = data_.size();
+            data_.resize(align_snapshot(offset + size), 0);
+            return offset;
+        }
+
+        gl_snapshot::blob_ref append(const void* data, std::size_t size)
+        {
+            auto offset = reserve(size);
+            if (size != 0)
+                std::memcpy(data_.data() + offset, data, size);
+            return { offset, size };
+        }
+
+        // The trailing '\0' is stored but not counted, so names and sources can be used as C strings in place
+        gl_snapshot::blob_ref append_string(std::string_view str)
+        {
+            auto offset = reserve(str.size() + 1);
+            std::memcpy(data_.data() + offset, str.data(), str.size());
+            return { offset, str.size() };
+        }
+
+        template <typename T>
+        std::uint64_t append_array(const std::vector<T>& items)
+        {
+            return append(items.data(), items.size() * sizeof(T)).offset;
+        }
+
+        template <typename T>
+        gl_snapshot::table_ref append_table(const std::vector<T>& records)
+        {
+            return { append_array(records), static_cast<std::uint32_t>(records.size()), 0 };
+        }
+
+        template <typename T>
+        void write(std::uint64_t offset, const T& item) noexcept
+        {
+            std::memcpy(data_.data() + offset, &item, sizeof(T));
+        }
+
+        [[nodiscard]] std::vector<unsigned char>& data() noexcept
+        {
+            return data_;
+        }
+
+    private:
+        std::vector<unsigned char> data_;
+    };
+
+    // Bounds checked views into a mapped snapshot, records are copied out so the mapping needs no alignment
+    class snapshot_reader
+    {
+    public:
+        explicit snapshot_reader(const gl_mapped_file& file) : file_(&file)
+        {
+        }
+
+        [[nodiscard]] const unsigned char* at(std::uint64_t offset, std::uint64_t size) const
+        {
+            if (offset > file_->size() || size > file_->size() - offset)
+                throw std::runtime_error("Corrupted snapshot: data out of the file");
+            return file_->data() + offset;
+        }
+
+        [[nodiscard]] const unsigned char* at(const gl_snapshot::blob_ref& blob) const
+        {
+            return at(blob.offset, blob.size);
+        }
+
+        [[nodiscard]] const char* c_str(const gl_snapshot::blob_ref& blob) const
+        {
+            const auto* str = reinterpret_cast<const char*>(at(blob.offset, blob.size + 1)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            if (str[blob.size] != '\0')
+                throw std::runtime_error("Corrupted snapshot: string is not terminated");
+            return str;
+        }
+
+        template <typename T>
+        [[nodiscard]] T record(std::uint64_t offset, std::uint32_t index) const
+        {
+            T item;
+            std::memcpy(&item, at(offset + static_cast<std::uint64_t>(index) * sizeof(T), sizeof(T)), sizeof(T));
+            return item;
+        }
+
+        template <typename T>
+        [[nodiscard]] T record(const gl_snapshot::table_ref& table, std::uint32_t index) const
+        {
+            return record<T>(table.offset, index);
+        }
+
+    private:
+        const gl_mapped_file* file_;
+    };
+
+    struct pixel_format
+    {
+        GLenum format;
+        GLenum type;
+        int bytes;
+    };
+
+    // Read back format of an uncompressed internal format, unknown ones are read as RGBA floats.
+    // Integer and stencil formats can't be read as floats, they keep their exact type.
+    [[nodiscard]] pixel_format get_pixel_format(GLint internal_format) noexcept
+    {
+        switch (internal_format)
+        {
+        case GL_R8UI:
+            return { GL_RED_INTEGER, GL_UNSIGNED_BYTE, 1 };
+        case GL_R8I:
+            return { GL_RED_INTEGER, GL_BYTE, 1 };
+        case GL_R16UI:
+            return { GL_RED_INTEGER, GL_UNSIGNED_SHORT, 2 };
+        case GL_R16I:
+            return { GL_RED_INTEGER, GL_SHORT, 2 };
+        case GL_R32UI:
+            return { GL_RED_INTEGER, GL_UNSIGNED_INT, 4 };
+        case GL_R32I:
+            return { GL_RED_INTEGER, GL_INT, 4 };
+        case GL_RG8UI:
+            return { GL_RG_INTEGER, GL_UNSIGNED_BYTE, 2 };
+        case GL_RG8I:
+            return { GL_RG_INTEGER, GL_BYTE, 2 };
+        case GL_RG16UI:
+            return { GL_RG_INTEGER, GL_UNSIGNED_SHORT, 4 };
+        case GL_RG16I:
+            return { GL_RG_INTEGER, GL_SHORT, 4 };
+        case GL_RG32UI:
+            return { GL_RG_INTEGER, GL_UNSIGNED_INT, 8 };
+        case GL_RG32I:
+            return { GL_RG_INTEGER, GL_INT, 8 };
+        case GL_RGB8UI:
+            return { GL_RGB_INTEGER, GL_UNSIGNED_BYTE, 3 };
+        case GL_RGB8I:
+            return { GL_RGB_INTEGER, GL_BYTE, 3 };
+        case GL_RGB16UI:
+            return { GL_RGB_INTEGER, GL_UNSIGNED_SHORT, 6 };
+        case GL_RGB16I:
+            return { GL_RGB_INTEGER, GL_SHORT, 6 };
+        case GL_RGB32UI:
+            return { GL_RGB_INTEGER, GL_UNSIGNED_INT, 12 };
+        case GL_RGB32I:
+            return { GL_RGB_INTEGER, GL_INT, 12 };
+        case GL_RGBA8UI:
+            return { GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, 4 };
+        case GL_RGBA8I:
+            return { GL_RGBA_INTEGER, GL_BYTE, 4 };
+        case GL_RGBA16UI:
+            return { GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, 8 };
+        case GL_RGBA16I:
+            return { GL_RGBA_INTEGER, GL_SHORT, 8 };
+        case GL_RGBA32UI:
+            return { GL_RGBA_INTEGER, GL_UNSIGNED_INT, 16 };
+        case GL_RGBA32I:
+            return { GL_RGBA_INTEGER, GL_INT, 16 };
+        case GL_RGB10_A2UI:
+            return { GL_RGBA_INTEGER, GL_UNSIGNED_INT_2_10_10_10_REV, 4 };
+        case GL_RGB10_A2:
+            return { GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, 4 };
+        case GL_R16:
+            return { GL_RED, GL_UNSIGNED_SHORT, 2 };
+        case GL_RG16:
+            return { GL_RG, GL_UNSIGNED_SHORT, 4 };
+        case GL_RGB16:
+            return { GL_RGB, GL_UNSIGNED_SHORT, 6 };
+        case GL_RGBA16:
+            return { GL_RGBA, GL_UNSIGNED_SHORT, 8 };
+        case GL_DEPTH_STENCIL:
+        case GL_DEPTH24_STENCIL8:
+            return { GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4 };
+        case GL_DEPTH32F_STENCIL8:
+            return { GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, 8 };
+        case GL_STENCIL_INDEX8:
+            return { GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, 1 };
+        case GL_RED:
+        case GL_R8:
+            return { GL_RED, GL_UNSIGNED_BYTE, 1 };
+        case GL_RG:
+        case GL_RG8:
+            return { GL_RG, GL_UNSIGNED_BYTE, 2 };
+        case GL_RGB:
+        case GL_RGB8:
+        case GL_SRGB8:
+            return { GL_RGB, GL_UNSIGNED_BYTE, 3 };
+        case GL_RGBA:
+        case GL_RGBA8:
+        case GL_SRGB8_ALPHA8:
+            return { GL_RGBA, GL_UNSIGNED_BYTE, 4 };
+        case GL_R16F:
+        case GL_R32F:
+            return { GL_RED, GL_FLOAT, 4 };
+        case GL_RG16F:
+        case GL_RG32F:
+            return { GL_RG, GL_FLOAT, 8 };
+        case GL_RGB16F:
+        case GL_RGB32F:
+        case GL_R11F_G11F_B10F:
+            return { GL_RGB, GL_FLOAT, 12 };
+        case GL_DEPTH_COMPONENT:
+        case GL_DEPTH_COMPONENT16:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32F:
+            return { GL_DEPTH_COMPONENT, GL_FLOAT, 4 };
+        default:
+            return { GL_RGBA, GL_FLOAT, 16 };
+        }
+    }
+
+    [[nodiscard]] gl_snapshot::bounds to_snapshot(const gl_bounds& bounds) noexcept
+    {
+        return { { bounds.box.min.x, bounds.box.min.y, bounds.box.min.z }, { bounds.box.max.x, bounds.box.max.y, bounds.box.max.z },
+            { bounds.sphere.center.x, bounds.sphere.center.y, bounds.sphere.center.z }, bounds.sphere.radius };
+    }
+
+    [[nodiscard]] gl_bounds from_snapshot(const gl_snapshot::bounds& bounds) noexcept
+    {
+        gl_bounds result;
+        result.box.min = glm::vec3(bounds.box_min[0], bounds.box_min[1], bounds.box_min[2]);
+        result.box.max = glm::vec3(bounds.box_max[0], bounds.box_max[1], bounds.box_max[2]);
+        result.sphere.center = glm::vec3(bounds.sphere_center[0], bounds.sphere_center[1], bounds.sphere_center[2]);
+        result.sphere.radius = bounds.sphere_radius;
+        return result;
+    }
+
+    [[nodiscard]] gl_snapshot::mesh_range to_snapshot(const gl_mesh_range& range) noexcept
+    {
+        return { range.first_index, range.index_count, range.base_vertex, range.vertex_count };
+    }
+
+    [[nodiscard]] gl_mesh_range from_snapshot(const gl_snapshot::mesh_range& range) noexcept
+    {
+        return { range.first_index, range.index_count, range.base_vertex, range.vertex_count };
+    }
+
+    void copy_vec3(float* dst, const glm::vec3& src) noexcept
+    {
+        dst[0] = src.x;
+        dst[1] = src.y;
+        dst[2] = src.z;
+    }
+
+    [[nodiscard]] glm::vec3 make_vec3(const float* src) noexcept
+    {
+        return { src[0], src[1], src[2] };
+    }
+
+    // Restore a pixel store parameter when leaving the scope.
+    // GL_UNPACK_ALIGNMENT goes through the state cache, so the cached value stays right.
+    class pixel_store_guard
+    {
+    public:
+        pixel_store_guard(GLenum pname, GLint value) : pname_(pname)
+        {
+            if (pname_ == GL_UNPACK_ALIGNMENT)
+            {
+                auto& cache = gl_state_cache::get();
+                old_value_ = cache.get_unpack_alignment();
+                cache.unpack_alignment(value);
+                return;
+            }
+            lomeglcall(glGetIntegerv, pname_, &old_value_);
+            lomeglcall(glPixelStorei, pname_, value);
+        }
+
+        ~pixel_store_guard()
+        {
+            if (pname_ == GL_UNPACK_ALIGNMENT)
+                gl_state_cache::get().unpack_alignment(old_value_);
+            else
+                glPixelStorei(pname_, old_value_);
+        }
+
+        pixel_store_guard(const pixel_store_guard&) = delete;
+        pixel_store_guard(pixel_store_guard&&) = delete;
+        pixel_store_guard& operator=(const pixel_store_guard&) = delete;
+        pixel_store_guard& operator=(pixel_store_guard&&) = delete;
+
+    private:
+        GLenum pname_;
+        GLint old_value_ = 0;
+    };
+
+} // namespace
+
+gl_world& gl_world::save_snapshot(const std::string& path)
+{
+    snapshot_writer writer;
+    auto header_offset = writer.reserve(sizeof(gl_snapshot::header));
+
+    // Resources are referenced by their index in the tables, looked up by name atom
+    gl_flat_map<std::uint32_t, std::uint32_t> texture_index;
+    gl_flat_map<std::uint32_t, std::uint32_t> vertex_index;
+    gl_flat_map<std::uint32_t, std::uint32_t> object_index;
+    auto name_ref = [&writer](const string_id& item) {
+        return writer.append_string(gl_atom_table::name_of(item.get_atom()));
+    };
+
+    std::vector<gl_snapshot::texture> textures;
+    std::vector<gl_snapshot::texture_level> levels;
+    std::vector<unsigned char> pixels;
+    {
+        pixel_store_guard pack_alignment(GL_PACK_ALIGNMENT, 1);
+        GLint max_size = 0;
+        lomeglcall(glGetIntegerv, GL_MAX_TEXTURE_SIZE, &max_size);
+        auto max_level = static_cast<int>(std::bit_width(static_cast<unsigned int>(std::max(max_size, 1))));
+
+        texture_.slots.for_each([&](std::uint32_t /*handle_value*/, gl_texture& texture) {
+            if (texture.get_texture_type() != GL_TEXTURE_2D)
+                throw std::runtime_error("Only 2D textures can be saved in a snapshot: " + gl_atom_table::name_of(texture.get_atom()));
+
+            gl_snapshot::texture record {};
+            record.name = name_ref(texture);
+            record.target = GL_TEXTURE_2D;
+            // An evicted texture is uploaded again to be read back
+            texture.make_resident().bind();
+            lomeglcall(glGetTexParameteriv, GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &record.min_filter);
+            lomeglcall(glGetTexParameteriv, GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &record.mag_filter);
+            lomeglcall(glGetTexParameteriv, GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &record.wrap_s);
+            lomeglcall(glGetTexParameteriv, GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &record.wrap_t);
+
+            levels.clear();
+            for (int level = 0; level < max_level; ++level)
+            {
+                gl_snapshot::texture_level level_record {};
+                GLint internal_format = 0;
+                GLint compressed = 0;
+                lomeglcall(glGetTexLevelParameteriv, GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &level_record.width);
+                if (level_record.width == 0)
+                    break;
+                lomeglcall(glGetTexLevelParameteriv, GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &level_record.height);
+                lomeglcall(glGetTexLevelParameteriv, GL_TEXTURE_2D, level, GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+                lomeglcall(glGetTexLevelParameteriv, GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+                level_record.internal_format = static_cast<std::uint32_t>(internal_format);
+
+                // Compressed payloads are kept as they are, the driver doesn't need to encode them again
+                if (compressed != 0)
+                {
+                    GLint size = 0;
+                    lomeglcall(glGetTexLevelParameteriv, GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+                    pixels.resize(static_cast<std::size_t>(size));
+                    lomeglcall(glGetCompressedTexImage, GL_TEXTURE_2D, level, pixels.data());
+                } else {
+                    auto format = get_pixel_format(internal_format);
+                    level_record.format = format.format;
+                    level_record.type = format.type;
+                    pixels.resize(static_cast<std::size_t>(level_record.width) * static_cast<std::size_t>(level_record.height) * static_cast<std::size_t>(format.bytes));
+                    lomeglcall(glGetTexImage, GL_TEXTURE_2D, level, format.format, format.type, pixels.data());
+                }
+                level_record.pixels = writer.append(pixels.data(), pixels.size());
+                levels.push_back(level_record);
+            }
+            record.level_count = static_cast<std::uint32_t>(levels.size());
+            record.levels = writer.append_array(levels);
+
+            texture_index.emplace(texture.get_atom(), static_cast<std::uint32_t>(textures.size()));
+            textures.push_back(record);
+        });
+    }
+
+    std::vector<gl_snapshot::shader> shaders;
+    shader_.slots.for_each([&](std::uint32_t /*handle_value*/, gl_shader& shader) {
+        gl_snapshot::shader record {};
+        record.name = name_ref(shader);
+        auto binary = shader.get_binary(record.binary_format);
+        record.binary = writer.append(binary.data(), binary.size());
+        record.vertex_source = writer.append_string(shader.get_vertex_source());
+        record.geometry_source = writer.append_string(shader.get_geometry_source());
+        record.fragment_source = writer.append_string(shader.get_fragment_source());
+        shaders.push_back(record);
+    });
+
+    std::vector<gl_snapshot::vertex> vertices;
+    std::vector<unsigned char> buffer;
+    auto read_buffer = [&](GLenum target, GLuint name) {
+        GLint size = 0;
+        gl_state_cache::get().bind_buffer(target, name);
+        lomeglcall(glGetBufferParameteriv, target, GL_BUFFER_SIZE, &size);
+        buffer.resize(static_cast<std::size_t>(size));
+        if (size != 0)
+            lomeglcall(glGetBufferSubData, target, 0, size, buffer.data());
+        return writer.append(buffer.data(), buffer.size());
+    };
+    GLint max_attribs = 0;
+    lomeglcall(glGetIntegerv, GL_MAX_VERTEX_ATTRIBS, &max_attribs);
+    vertex_.slots.for_each([&](std::uint32_t /*handle_value*/, gl_vertex& vertex) {
+        vertex.make_resident();
+        gl_snapshot::vertex record {};
+        record.name = name_ref(vertex);
+        record.vbo_counts = vertex.vbo_counts();
+        record.ebo_counts = vertex.ebo_counts();
+        record.local_bounds = to_snapshot(vertex.get_bounds());
+
+        vertex.bind_this();
+        if (vertex.is_ebo_binded())
+            record.ebo = read_buffer(GL_ELEMENT_ARRAY_BUFFER, vertex.ebo());
+        if (vertex.is_vbo_binded())
+        {
+            record.vbo = read_buffer(GL_ARRAY_BUFFER, vertex.vbo());
+            // Only the attributes sourced from the vbo, the instance attributes are set up when drawing.
+            // The layout recorded by the vertex is used, the attribute state queried from a DSA vao lacks the stride and offset.
+            for (const auto& source : vertex.get_attribs())
+            {
+                if (!source.enabled || source.index >= static_cast<GLuint>(std::min<GLint>(max_attribs, gl_snapshot::max_attribs)))
+                    continue;
+
+                auto& attrib = record.attribs[record.attrib_count++];
+                attrib.index = source.index;
+                attrib.size = source.size;
+                attrib.type = source.type;
+                attrib.normalized = source.normalized;
+                attrib.stride = source.stride;
+                attrib.offset = static_cast<std::uint32_t>(source.offset);
+            }
+        }
+
+        vertex_index.emplace(vertex.get_atom(), static_cast<std::uint32_t>(vertices.size()));
+        vertices.push_back(record);
+    });
+    gl_state_cache::get().bind_vertex_array(0);
+
+    // Parents are found by their slot in the world's store
+    std::vector<gl_object*> objects;
+    gl_flat_map<std::uint32_t, std::uint32_t> slot_index;
+    object_.slots.for_each([&](std::uint32_t /*handle_value*/, gl_object& object) {
+        if (object.store_ == &transforms_)
+            slot_index.emplace(object.slot_, static_cast<std::uint32_t>(objects.size()));
+        object_index.emplace(object.get_atom(), static_cast<std::uint32_t>(objects.size()));
+        objects.push_back(&object);
+    });
+
+    auto index_of = [](const auto& index, const auto& weak) {
+        auto&& item = weak.lock();
+        const auto* result = item ? index.find(item->get_atom()) : nullptr;
+        return result != nullptr ? *result : gl_snapshot::npos;
+    };
+    std::vector<gl_snapshot::object> object_records;
+    std::vector<std::uint32_t> texture_refs;
+    std::vector<gl_snapshot::lod_level> lod_refs;
+    for (auto* object : objects)
+    {
+        gl_snapshot::object record {};
+        record.name = name_ref(*object);
+        record.kind = gl_snapshot::object_kind_object;
+        record.vertex = gl_snapshot::npos;
+
+        auto& store = *object->store_;
+        auto slot = object->slot_;
+        auto parent = store.get_parent(slot);
+        const auto* parent_index = parent != gl_transform_store::npos && object->store_ == &transforms_ ? slot_index.find(parent) : nullptr;
+        record.parent = parent_index != nullptr ? *parent_index : gl_snapshot::npos;
+        copy_vec3(record.pos, store.pos(slot));
+        copy_vec3(record.front, store.front(slot));
+        copy_vec3(record.right, store.right(slot));
+        copy_vec3(record.up, store.up(slot));
+        copy_vec3(record.scale, store.scale(slot));
+        const auto& rotate = store.rotate(slot);
+        record.rotate[0] = rotate.x;
+        record.rotate[1] = rotate.y;
+        record.rotate[2] = rotate.z;
+        record.rotate[3] = rotate.w;
+
+        auto* entity = dynamic_cast<gl_entity*>(object);
+        if (entity != nullptr)
+        {
+            record.kind = gl_snapshot::object_kind_entity;
+            record.vertex = index_of(vertex_index, entity->get_vertex());
+            record.is_static = entity->is_static() ? 1 : 0;
+            record.range = to_snapshot(entity->get_mesh_range());
+            record.local_bounds = to_snapshot(entity->get_bounds());
+
+            texture_refs.clear();
+            for (const auto& texture : entity->get_texture_list())
+                texture_refs.push_back(index_of(texture_index, texture));
+            record.texture_count = static_cast<std::uint32_t>(texture_refs.size());
+            record.textures = writer.append_array(texture_refs);
+
+            lod_refs.clear();
+            for (const auto& level : entity->get_lod_levels())
+                lod_refs.push_back({ index_of(vertex_index, level.vertex), level.threshold, to_snapshot(level.mesh_range) });
+            record.lod_count = static_cast<std::uint32_t>(lod_refs.size());
+            record.lods = writer.append_array(lod_refs);
+        }
+        object_records.push_back(record);
+    }
+
+    gl_snapshot::header header {};
+    std::memcpy(header.magic, gl_snapshot::magic, sizeof(header.magic));
+    header.version = gl_snapshot::version;
+    header.byte_order_mark = gl_snapshot::byte_order_mark;
+    header.textures = writer.append_table(textures);
+    header.shaders = writer.append_table(shaders);
+    header.vertices = writer.append_table(vertices);
+    header.objects = writer.append_table(object_records);
+    if (exists(current_camera_))
+        header.current_camera = name_ref(get(current_camera_));
+    if (exists(current_shader_))
+        header.current_shader = name_ref(get(current_shader_));
+    header.file_size = writer.data().size();
+    writer.write(header_offset, header);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(writer.data().data()), static_cast<std::streamsize>(writer.data().size())); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (!out)
+        throw std::runtime_error("Can't write snapshot " + path);
+    return *this;
+}
+
+gl_world& gl_world::load_snapshot(const std::string& path)
+{
+    gl_mapped_file file(path);
+    snapshot_reader reader(file);
+
+    auto header = reader.record<gl_snapshot::header>(0, 0);
+    if (std::memcmp(header.magic, gl_snapshot::magic, sizeof(header.magic)) != 0)
+        throw std::runtime_error("Not a snapshot: " + path);
+    if (header.byte_order_mark != gl_snapshot::byte_order_mark)
+        throw std::runtime_error("Snapshot of another byte order: " + path);
+    if (header.version != gl_snapshot::version)
+        throw std::runtime_error("Unsupported snapshot version " + std::to_string(header.version) + ": " + path);
+    if (header.file_size != file.size())
+        throw std::runtime_error("Truncated snapshot: " + path);
+
+    {
+        pixel_store_guard unpack_alignment(GL_UNPACK_ALIGNMENT, 1);
+        for (std::uint32_t i = 0; i < header.textures.count; ++i)
+        {
+            auto record = reader.record<gl_snapshot::texture>(header.textures, i);
+            auto& texture = create<gl_texture>(reader.c_str(record.name), record.target);
+            if (!texture.uses_dsa())
+                texture.bind();
+            texture.tex_parameteri(GL_TEXTURE_MIN_FILTER, record.min_filter)
+                .tex_parameteri(GL_TEXTURE_MAG_FILTER, record.mag_filter)
+                .tex_parameteri(GL_TEXTURE_WRAP_S, record.wrap_s)
+                .tex_parameteri(GL_TEXTURE_WRAP_T, record.wrap_t);
+
+            for (std::uint32_t level = 0; level < record.level_count; ++level)
+            {
+                auto level_record = reader.record<gl_snapshot::texture_level>(record.levels, level);
+                const auto* pixels = reader.at(level_record.pixels);
+                if (level_record.format == 0)
+                    texture.add_compressed_image_data_to(static_cast<int>(level), level_record.internal_format, level_record.width, level_record.height,
+                        static_cast<int>(level_record.pixels.size), pixels);
+                else
+                    texture.add_image_data_to(static_cast<int>(level), static_cast<int>(level_record.internal_format), level_record.width, level_record.height,
+                        0, level_record.format, level_record.type, pixels);
+            }
+            if (record.level_count > 0)
+                texture.tex_parameteri(GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(record.level_count - 1));
+        }
+    }
+
+    for (std::uint32_t i = 0; i < header.shaders.count; ++i)
+    {
+        auto record = reader.record<gl_snapshot::shader>(header.shaders, i);
+        const auto* name = reader.c_str(record.name);
+        const auto* vertex_source = reader.c_str(record.vertex_source);
+        const auto* geometry_source = reader.c_str(record.geometry_source);
+        const auto* fragment_source = reader.c_str(record.fragment_source);
+        auto& shader = create<gl_shader>(name);
+
+        // Binaries are only valid for the same driver, compile the sources otherwise
+        if (shader.load_binary(record.binary_format, reader.at(record.binary), static_cast<int>(record.binary.size)))
+        {
+            shader.set_sources(vertex_source, geometry_source, fragment_source);
+            continue;
+        }
+        if (record.vertex_source.size == 0 || record.fragment_source.size == 0)
+            throw shader_error(std::string("Program binary of ") + name + " is rejected and it has no source");
+        shader.add_vertex(vertex_source);
+        if (record.geometry_source.size != 0)
+            shader.add_geometry(geometry_source);
+        shader.add_fragment(fragment_source).link_shader();
+    }
+
+    std::vector<const char*> vertex_names(header.vertices.count);
+    for (std::uint32_t i = 0; i < header.vertices.count; ++i)
+    {
+        auto record = reader.record<gl_snapshot::vertex>(header.vertices, i);
+        vertex_names[i] = reader.c_str(record.name);
+        auto& vertex = create<gl_vertex>(vertex_names[i]);
+        if (!vertex.uses_dsa())
+            vertex.bind_this();
+        if (record.vbo.size != 0)
+        {
+            vertex.bind_array_buffer_data(reader.at(record.vbo), static_cast<GLsizeiptr>(record.vbo.size), GL_STATIC_DRAW, record.vbo_counts);
+            for (std::uint32_t attrib_index = 0; attrib_index < std::min<std::uint32_t>(record.attrib_count, gl_snapshot::max_attribs); ++attrib_index)
+            {
+                const auto& attrib = record.attribs[attrib_index];
+                vertex.vertex_attrib_pointer(attrib.index, attrib.size, attrib.type, static_cast<GLboolean>(attrib.normalized), attrib.stride,
+                          reinterpret_cast<const void*>(static_cast<std::uintptr_t>(attrib.offset))) // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+                    .enable_vertex_attrib_array(attrib.index);
+            }
+        }
+        if (record.ebo.size != 0)
+            vertex.bind_elemnt_buffer_data(reader.at(record.ebo), static_cast<GLsizeiptr>(record.ebo.size), GL_STATIC_DRAW, record.ebo_counts);
+        vertex.set_bounds(from_snapshot(record.local_bounds));
+    }
+    gl_state_cache::get().bind_vertex_array(0);
+
+    auto vertex_name = [&vertex_names](std::uint32_t index) {
+        if (index >= vertex_names.size())
+            throw std::runtime_error("Corrupted snapshot: wrong vertex index");
+        return vertex_names[index];
+    };
+    std::vector<gl_object*> objects(header.objects.count);
+    for (std::uint32_t i = 0; i < header.objects.count; ++i)
+    {
+        auto record = reader.record<gl_snapshot::object>(header.objects, i);
+        const auto* name = reader.c_str(record.name);
+        if (record.kind == gl_snapshot::object_kind_entity)
+        {
+            auto& entity = create<gl_entity>(name);
+            if (record.vertex != gl_snapshot::npos)
+                entity.set_vertex(*this, vertex_name(record.vertex));
+            for (std::uint32_t texture = 0; texture < record.texture_count; ++texture)
+            {
+                auto index = reader.record<std::uint32_t>(record.textures, texture);
+                if (index >= header.textures.count)
+                    throw std::runtime_error("Corrupted snapshot: wrong texture index");
+                entity.add_texture(*this, reader.c_str(reader.record<gl_snapshot::texture>(header.textures, index).name));
+            }
+            for (std::uint32_t level = 0; level < record.lod_count; ++level)
+            {
+                auto lod = reader.record<gl_snapshot::lod_level>(record.lods, level);
+                entity.add_lod(*this, vertex_name(lod.vertex), lod.threshold, from_snapshot(lod.range));
+            }
+            entity.set_mesh_range(from_snapshot(record.range)).set_static(record.is_static != 0).set_bounds(from_snapshot(record.local_bounds));
+            objects[i] = &entity;
+        } else {
+            objects[i] = &create<gl_object>(name);
+        }
+
+        auto& store = *objects[i]->store_;
+        auto slot = objects[i]->slot_;
+        store.pos(slot) = make_vec3(record.pos);
+        store.front(slot) = make_vec3(record.front);
+        store.right(slot) = make_vec3(record.right);
+        store.up(slot) = make_vec3(record.up);
+        store.scale(slot) = make_vec3(record.scale);
+        store.rotate(slot) = glm::quat(record.rotate[3], record.rotate[0], record.rotate[1], record.rotate[2]);
+        store.mark_transform(slot);
+    }
+
+    // The saved transforms of children are already local
+    for (std::uint32_t i = 0; i < header.objects.count; ++i)
+    {
+        auto parent = reader.record<gl_snapshot::object>(header.objects, i).parent;
+        if (parent == gl_snapshot::npos)
+            continue;
+        if (parent >= objects.size())
+            throw std::runtime_error("Corrupted snapshot: wrong parent index");
+        objects[i]->set_parent(objects[parent]);
+    }
+
+    if (header.current_camera.size != 0)
+        set_current_camera(reader.c_str(header.current_camera));
+    if (header.current_shader.size != 0)
+        use_shader(reader.c_str(header.current_shader));
+    return *this;
+}
+
+} // namespace lomegl
@@ -0,0 +1,422 @@
+#include "lomegl/gl_state_cache.h"
+#include "lomegl/gl_exception.h"
+#include "lomegl/gl_world.h"
+
+#include <cassert>
+
+namespace lomegl {
+
+namespace {
+
+    // Indexed like `texture_target_index_`
+    constexpr std::array<GLenum, 11> texture_binding_pnames = { GL_TEXTURE_BINDING_1D, GL_TEXTURE_BINDING_1D_ARRAY,
+        GL_TEXTURE_BINDING_2D, GL_TEXTURE_BINDING_2D_ARRAY, GL_TEXTURE_BINDING_2D_MULTISAMPLE, GL_TEXTURE_BINDING_2D_MULTISAMPLE_ARRAY,
+        GL_TEXTURE_BINDING_3D, GL_TEXTURE_BINDING_BUFFER, GL_TEXTURE_BINDING_CUBE_MAP, GL_TEXTURE_BINDING_CUBE_MAP_ARRAY,
+        GL_TEXTURE_BINDING_RECTANGLE };
+
+} // namespace
+
+[[nodiscard]] gl_state_cache& gl_state_cache::get() noexcept
+{
+    auto* world = gl_world::get_current_world();
+    if (world != nullptr)
+        return world->get_state_cache();
+
+    thread_local gl_state_cache pass_through;
+    pass_through.enabled_ = false;
+    return pass_through;
+}
+
+gl_state_cache& gl_state_cache::set_enabled(bool enable) noexcept
+{
+    enabled_ = enable;
+    return *this;
+}
+
+[[nodiscard]] bool gl_state_cache::is_enabled() const noexcept
+{
+    return enabled_;
+}
+
+gl_state_cache& gl_state_cache::invalidate() noexcept
+{
+    program_ = vao_ = array_buffer_ = element_buffer_ = unpack_buffer_ = active_unit_ = unknown_;
+    for (auto& unit : textures_)
+        unit.fill(unknown_);
+    capabilities_.fill(unknown_);
+    blend_source_ = blend_destination_ = depth_func_ = depth_mask_ = color_mask_ = cull_face_ = unpack_alignment_ = unknown_;
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::forget(gl_val_type type, GLsizei count, const unsigned int* names) noexcept
+{
+    auto forget_name = [](GLuint& state, GLuint name) {
+        if (state == name)
+            state = unknown_;
+    };
+
+    using enum gl_val_type;
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        switch (type)
+        {
+        case vao:
+            forget_name(vao_, names[i]);
+            break;
+        case vbo:
+        case ebo:
+            forget_name(array_buffer_, names[i]);
+            forget_name(element_buffer_, names[i]);
+            forget_name(unpack_buffer_, names[i]);
+            break;
+        case program:
+            forget_name(program_, names[i]);
+            break;
+        case texture:
+            for (auto& unit : textures_)
+            {
+                for (auto& binding : unit)
+                    forget_name(binding, names[i]);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::use_program(GLuint program)
+{
+    if (change_(program_, program))
+        lomeglcall(glUseProgram, program);
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::bind_vertex_array(GLuint vao)
+{
+    if (change_(vao_, vao))
+    {
+        lomeglcall(glBindVertexArray, vao);
+        element_buffer_ = unknown_;
+    }
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::bind_buffer(GLenum target, GLuint buffer)
+{
+    GLuint* state = nullptr;
+    if (target == GL_ARRAY_BUFFER)
+        state = &array_buffer_;
+    else if (target == GL_ELEMENT_ARRAY_BUFFER && vao_ != unknown_) // it belongs to the vao, so it's unknown with the vao
+        state = &element_buffer_;
+    else if (target == GL_PIXEL_UNPACK_BUFFER)
+        state = &unpack_buffer_;
+
+    if (state == nullptr)
+        ++stats_.issued;
+    else if (!change_(*state, buffer))
+        return *this;
+    lomeglcall(glBindBuffer, target, buffer);
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::active_texture(GLenum unit)
+{
+    assert(unit >= GL_TEXTURE0);
+    if (change_(active_unit_, unit - GL_TEXTURE0))
+        lomeglcall(glActiveTexture, unit);
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::bind_texture(GLenum target, GLuint texture)
+{
+    auto index = texture_target_index_(target);
+    if (active_unit_ == unknown_ || index == texture_target_count_)
+    {
+        ++stats_.issued;
+        lomeglcall(glBindTexture, target, texture);
+        return *this;
+    }
+
+    if (active_unit_ >= textures_.size())
+    {
+        unit_bindings_ unknown_unit;
+        unknown_unit.fill(unknown_);
+        textures_.resize(active_unit_ + 1, unknown_unit);
+    }
+    if (change_(textures_[active_unit_][index], texture))
+        lomeglcall(glBindTexture, target, texture);
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::set_capability(GLenum capability, bool enable)
+{
+    auto index = capability_index_(capability);
+    if (index == capabilities_.size())
+        ++stats_.issued;
+    else if (!change_(capabilities_[index], enable ? 1 : 0))
+        return *this;
+
+    if (enable)
+        lomeglcall(glEnable, capability);
+    else
+        lomeglcall(glDisable, capability);
+    return *this;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_state_cache& gl_state_cache::blend_func(GLenum source_factor, GLenum destination_factor)
+{
+    // Both are compared, change_ would count two calls
+    if (enabled_ && blend_source_ == source_factor && blend_destination_ == destination_factor)
+    {
+        ++stats_.elided;
+        return *this;
+    }
+    ++stats_.issued;
+    blend_source_ = source_factor;
+    blend_destination_ = destination_factor;
+    lomeglcall(glBlendFunc, source_factor, destination_factor);
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::depth_func(GLenum func)
+{
+    if (change_(depth_func_, func))
+        lomeglcall(glDepthFunc, func);
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::depth_mask(bool enable)
+{
+    if (change_(depth_mask_, enable ? 1 : 0))
+        lomeglcall(glDepthMask, enable ? GL_TRUE : GL_FALSE);
+    return *this;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_state_cache& gl_state_cache::color_mask(bool red, bool green, bool blue, bool alpha)
+{
+    auto bits = (red ? 1U : 0U) | (green ? 2U : 0U) | (blue ? 4U : 0U) | (alpha ? 8U : 0U);
+    if (change_(color_mask_, bits))
+        lomeglcall(glColorMask, red ? GL_TRUE : GL_FALSE, green ? GL_TRUE : GL_FALSE, blue ? GL_TRUE : GL_FALSE, alpha ? GL_TRUE : GL_FALSE);
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::cull_face(GLenum mode)
+{
+    if (change_(cull_face_, mode))
+        lomeglcall(glCullFace, mode);
+    return *this;
+}
+
+gl_state_cache& gl_state_cache::unpack_alignment(GLint alignment)
+{
+    if (change_(unpack_alignment_, static_cast<GLuint>(alignment)))
+        lomeglcall(glPixelStorei, GL_UNPACK_ALIGNMENT, alignment);
+    return *this;
+}
+
+[[nodiscard]] bool gl_state_cache::is_capability_enabled(GLenum capability)
+{
+    auto index = capability_index_(capability);
+    if (index == capabilities_.size())
+        return glIsEnabled(capability) == GL_TRUE;
+    if (capabilities_[index] == unknown_)
+        capabilities_[index] = glIsEnabled(capability) == GL_TRUE ? 1 : 0;
+    return capabilities_[index] != 0;
+}
+
+[[nodiscard]] bool gl_state_cache::get_depth_mask()
+{
+    if (depth_mask_ == unknown_)
+    {
+        GLboolean mask = GL_TRUE;
+        lomeglcall(glGetBooleanv, GL_DEPTH_WRITEMASK, &mask);
+        depth_mask_ = mask == GL_TRUE ? 1 : 0;
+    }
+    return depth_mask_ != 0;
+}
+
+[[nodiscard]] std::array<bool, 4> gl_state_cache::get_color_mask()
+{
+    if (color_mask_ == unknown_)
+    {
+        std::array<GLboolean, 4> mask {};
+        lomeglcall(glGetBooleanv, GL_COLOR_WRITEMASK, mask.data());
+        color_mask_ = 0;
+        for (std::size_t i = 0; i < mask.size(); ++i)
+            color_mask_ |= mask[i] == GL_TRUE ? 1U << i : 0U;
+    }
+    return { (color_mask_ & 1U) != 0, (color_mask_ & 2U) != 0, (color_mask_ & 4U) != 0, (color_mask_ & 8U) != 0 };
+}
+
+[[nodiscard]] GLint gl_state_cache::get_unpack_alignment()
+{
+    if (unpack_alignment_ == unknown_)
+    {
+        GLint alignment = 4;
+        lomeglcall(glGetIntegerv, GL_UNPACK_ALIGNMENT, &alignment);
+        unpack_alignment_ = static_cast<GLuint>(alignment);
+    }
+    return static_cast<GLint>(unpack_alignment_);
+}
+
+[[nodiscard]] GLuint gl_state_cache::get_texture_binding(GLenum target)
+{
+    static_assert(texture_binding_pnames.size() == texture_target_count_);
+    auto index = texture_target_index_(target);
+    assert(index != texture_target_count_);
+    if (active_unit_ == unknown_)
+    {
+        GLint unit = GL_TEXTURE0;
+        lomeglcall(glGetIntegerv, GL_ACTIVE_TEXTURE, &unit);
+        active_unit_ = static_cast<GLuint>(unit) - GL_TEXTURE0;
+    }
+    if (active_unit_ >= textures_.size())
+    {
+        unit_bindings_ unknown_unit;
+        unknown_unit.fill(unknown_);
+        textures_.resize(active_unit_ + 1, unknown_unit);
+    }
+    auto& state = textures_[active_unit_][index];
+    if (state == unknown_)
+    {
+        GLint texture = 0;
+        lomeglcall(glGetIntegerv, texture_binding_pnames[index], &texture);
+        state = static_cast<GLuint>(texture);
+    }
+    return state;
+}
+
+[[nodiscard]] GLuint gl_state_cache::get_unpack_buffer()
+{
+    if (unpack_buffer_ == unknown_)
+    {
+        GLint buffer = 0;
+        lomeglcall(glGetIntegerv, GL_PIXEL_UNPACK_BUFFER_BINDING, &buffer);
+        unpack_buffer_ = static_cast<GLuint>(buffer);
+    }
+    return unpack_buffer_;
+}
+
+[[nodiscard]] const gl_state_stats& gl_state_cache::get_stats() const noexcept
+{
+    return stats_;
+}
+
+gl_state_cache& gl_state_cache::reset_stats() noexcept
+{
+    stats_ = {};
+    return *this;
+}
+
+void gl_state_cache::set_validation_mode(gl_validation_mode mode) noexcept
+{
+    validation_mode_ = mode;
+}
+
+[[nodiscard]] gl_validation_mode gl_state_cache::get_validation_mode() noexcept
+{
+    return validation_mode_;
+}
+
+[[nodiscard]] bool gl_state_cache::is_program_current(GLuint program) const
+{
+    return check_binding_(program_, GL_CURRENT_PROGRAM, program);
+}
+
+[[nodiscard]] bool gl_state_cache::is_vertex_array_bound(GLuint vao) const
+{
+    return check_binding_(vao_, GL_VERTEX_ARRAY_BINDING, vao);
+}
+
+[[nodiscard]] bool gl_state_cache::is_buffer_bound(GLenum target, GLuint buffer) const
+{
+    assert(target == GL_ARRAY_BUFFER || target == GL_ELEMENT_ARRAY_BUFFER);
+    if (target == GL_ARRAY_BUFFER)
+        return check_binding_(array_buffer_, GL_ARRAY_BUFFER_BINDING, buffer);
+    return check_binding_(vao_ == unknown_ ? unknown_ : element_buffer_, GL_ELEMENT_ARRAY_BUFFER_BINDING, buffer);
+}
+
+[[nodiscard]] bool gl_state_cache::is_texture_bound(GLenum target, GLuint texture) const
+{
+    auto index = texture_target_index_(target);
+    if (index == texture_target_count_)
+        return false;
+    auto state = active_unit_ < textures_.size() ? textures_[active_unit_][index] : unknown_;
+    return check_binding_(state, texture_binding_pnames[index], texture);
+}
+
+[[nodiscard]] bool gl_state_cache::change_(GLuint& state, GLuint value) noexcept
+{
+    if (enabled_ && state == value)
+    {
+        ++stats_.elided;
+        return false;
+    }
+    ++stats_.issued;
+    state = value;
+    return true;
+}
+
+[[nodiscard]] bool gl_state_cache::check_binding_(GLuint state, GLenum pname, GLuint name)
+{
+    if (name == 0)
+        return false;
+    if (validation_mode_ == gl_validation_mode::shadow)
+        return state == unknown_ || state == name;
+
+    GLint current = 0;
+    lomeglcall(glGetIntegerv, pname, &current);
+    return static_cast<GLuint>(current) == name;
+}
+
+[[nodiscard]] std::size_t gl_state_cache::texture_target_index_(GLenum target) noexcept
+{
+    switch (target)
+    {
+    case GL_TEXTURE_1D:
+        return 0;
+    case GL_TEXTURE_1D_ARRAY:
+        return 1;
+    case GL_TEXTURE_2D:
+        return 2;
+    case GL_TEXTURE_2D_ARRAY:
+        return 3;
+    case GL_TEXTURE_2D_MULTISAMPLE:
+        return 4;
+    case GL_TEXTURE_2D_MULTISAMPLE_ARRAY:
+        return 5;
+    case GL_TEXTURE_3D:
+        return 6;
+    case GL_TEXTURE_BUFFER:
+        return 7;
+    case GL_TEXTURE_CUBE_MAP:
+        return 8;
+    case GL_TEXTURE_CUBE_MAP_ARRAY:
+        return 9;
+    case GL_TEXTURE_RECTANGLE:
+        return 10;
+    default:
+        return texture_target_count_;
+    }
+}
+
+[[nodiscard]] std::size_t gl_state_cache::capability_index_(GLenum capability) noexcept
+{
+    switch (capability)
+    {
+    case GL_BLEND:
+        return 0;
+    case GL_DEPTH_TEST:
+        return 1;
+    case GL_CULL_FACE:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+} // namespace lomegl
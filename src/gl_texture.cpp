@@ -1,12 +1,87 @@
 #include <cassert>
 #include <glad/glad.h>
 
+#include "lomegl/gl_debug.h"
 #include "lomegl/gl_exception.h"
+#include "lomegl/gl_state_cache.h"
 #include "lomegl/gl_texture.h"
 
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
 namespace lomegl {
 
-gl_texture::gl_texture(unsigned int texture_type) : texture_(lomegl::gl_val_factory<gl_val_type::texture>()),
+namespace {
+
+    // Without a pixel unpack buffer, a null image only allocates storage
+    bool is_unpack_buffer_bound()
+    {
+        return gl_state_cache::get().get_unpack_buffer() != 0;
+    }
+
+    // Bind a DSA texture for the calls without a DSA form, the binding of the active unit is restored after them.
+    // So setting up a texture doesn't clobber the bindings used by drawing. It does nothing without DSA.
+    class dsa_bind_guard
+    {
+    public:
+        dsa_bind_guard(bool dsa, GLenum target, GLuint texture) : target_(target)
+        {
+            if (!dsa)
+                return;
+            auto& cache = gl_state_cache::get();
+            previous_ = cache.get_texture_binding(target_);
+            cache.bind_texture(target_, texture);
+            restore_ = true;
+        }
+
+        ~dsa_bind_guard()
+        {
+            if (restore_)
+                gl_state_cache::get().bind_texture(target_, previous_);
+        }
+
+        dsa_bind_guard(const dsa_bind_guard&) = delete;
+        dsa_bind_guard(dsa_bind_guard&&) = delete;
+        dsa_bind_guard& operator=(const dsa_bind_guard&) = delete;
+        dsa_bind_guard& operator=(dsa_bind_guard&&) = delete;
+
+    private:
+        GLenum target_;
+        GLuint previous_ = 0;
+        bool restore_ = false;
+    };
+
+    // glTextureStorage2D only takes sized formats
+    int get_sized_format(int internal_format) noexcept
+    {
+        switch (internal_format)
+        {
+        case GL_RED:
+            return GL_R8;
+        case GL_RG:
+            return GL_RG8;
+        case GL_RGB:
+            return GL_RGB8;
+        case GL_RGBA:
+            return GL_RGBA8;
+        case GL_SRGB:
+            return GL_SRGB8;
+        case GL_SRGB_ALPHA:
+            return GL_SRGB8_ALPHA8;
+        case GL_DEPTH_COMPONENT:
+            return GL_DEPTH_COMPONENT24;
+        case GL_DEPTH_STENCIL:
+            return GL_DEPTH24_STENCIL8;
+        default:
+            return internal_format;
+        }
+    }
+
+} // namespace
+
+gl_texture::gl_texture(unsigned int texture_type) : dsa_(is_dsa_enabled()),
+                                                    texture_(create_texture_(texture_type, dsa_)),
                                                     texture_type_(texture_type)
 {
     // Make sure target_type is vaild
@@ -25,54 +100,304 @@ gl_texture::gl_texture(unsigned int texture_type) : texture_(lomegl::gl_val_fact
     return texture_;
 }
 
+[[nodiscard]] unsigned int gl_texture::get_texture_type() const noexcept
+{
+    return texture_type_;
+}
+
+[[nodiscard]] bool gl_texture::uses_dsa() const noexcept
+{
+    return dsa_;
+}
+
 gl_texture& gl_texture::active_texture_unit(unsigned int texture_unit)
 {
     assert(GL_TEXTURE0 <= texture_unit && texture_unit < GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS);
-    lomeglcall(glActiveTexture, texture_unit);
+    gl_state_cache::get().active_texture(texture_unit);
     return *this;
 }
 
 gl_texture& gl_texture::bind()
 {
-    lomeglcall(glBindTexture, texture_type_, texture_.get());
+    gl_state_cache::get().bind_texture(texture_type_, texture_.get());
+    if (label_pending_) [[unlikely]]
+    {
+        label_pending_ = false;
+        gl_object_label(GL_TEXTURE, texture_.get(), get_id());
+    }
     return *this;
 }
 
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 gl_texture& gl_texture::tex_parameteri(unsigned int pname, int param)
 {
-    assert(check_texture_bind_());
-    lomeglcall(glTexParameteri, texture_type_, pname, param);
+    if (!dsa_)
+    {
+        assert(check_texture_bind_());
+        lomeglcall(glTexParameteri, texture_type_, pname, param);
+        return *this;
+    }
+
+    lomeglcall(glTextureParameteri, texture_.get(), pname, param);
+    return *this;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_texture& gl_texture::allocate_storage(int levels, int internal_format, int width, int height)
+{
+    if (!dsa_ || texture_type_ != GL_TEXTURE_2D)
+        return *this;
+    if (storage_levels_ != 0 || !levels_.empty())
+        throw std::runtime_error("Texture " + get_id() + " already has storage");
+
+    assert(levels > 0);
+    storage_levels_ = levels;
+    storage_format_ = get_sized_format(internal_format);
+    storage_width_ = width;
+    storage_height_ = height;
+    lomeglcall(glTextureStorage2D, texture_.get(), levels, static_cast<GLenum>(storage_format_), width, height);
     return *this;
 }
 
+[[nodiscard]] bool gl_texture::has_immutable_storage() const noexcept
+{
+    return storage_levels_ != 0;
+}
+
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 gl_texture& gl_texture::add_image_data_to(int level, int internal_format,
     int width, int height, int dummy, unsigned int data_format,
     unsigned int data_type, const void* image)
 {
-    assert(check_texture_bind_());
-    lomeglcall(glTexImage2D, texture_type_, level, internal_format, width,
-        height, dummy, data_format, data_type, image);
+    assert(dsa_ || check_texture_bind_());
+    make_resident();
+    if (has_immutable_storage())
+    {
+        check_storage_(level, internal_format, width, height);
+        if (image != nullptr || is_unpack_buffer_bound())
+            lomeglcall(glTextureSubImage2D, texture_.get(), level, 0, 0, width, height, data_format, data_type, image);
+    } else {
+        dsa_bind_guard guard(dsa_, texture_type_, texture_.get());
+        lomeglcall(glTexImage2D, texture_type_, level, internal_format, width,
+            height, dummy, data_format, data_type, image);
+    }
+    set_level_(level, { internal_format, width, height, data_format, data_type, 0 });
+    return *this;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_texture& gl_texture::add_compressed_image_data_to(int level, unsigned int internal_format,
+    int width, int height, int image_size, const void* image)
+{
+    assert(dsa_ || check_texture_bind_());
+    make_resident();
+    if (has_immutable_storage())
+    {
+        check_storage_(level, static_cast<int>(internal_format), width, height);
+        if (image != nullptr || is_unpack_buffer_bound())
+            lomeglcall(glCompressedTextureSubImage2D, texture_.get(), level, 0, 0, width, height, internal_format, image_size, image);
+    } else {
+        dsa_bind_guard guard(dsa_, texture_type_, texture_.get());
+        lomeglcall(glCompressedTexImage2D, texture_type_, level, internal_format, width, height, 0, image_size, image);
+    }
+    set_level_(level, { static_cast<int>(internal_format), width, height, 0, 0, image_size });
     return *this;
 }
 
 gl_texture& gl_texture::generate_mipmap()
 {
-    assert(check_texture_bind_());
-    lomeglcall(glGenerateMipmap, texture_type_);
+    assert(dsa_ || check_texture_bind_());
+    make_resident();
+    if (dsa_)
+        lomeglcall(glGenerateTextureMipmap, texture_.get());
+    else
+        lomeglcall(glGenerateMipmap, texture_type_);
+    has_mipmap_ = true;
     return *this;
 }
 
-bool gl_texture::check_texture_bind_()
+[[nodiscard]] std::size_t gl_texture::get_memory_size() const noexcept
+{
+    std::size_t size = 0;
+    for (int level = 0; level < storage_level_count_(); ++level)
+    {
+        if (level < static_cast<int>(levels_.size()) && levels_[level].width != 0)
+        {
+            const auto& info = levels_[level];
+            size += info.compressed_size != 0
+                ? static_cast<std::size_t>(info.compressed_size)
+                : static_cast<std::size_t>(info.width) * static_cast<std::size_t>(info.height) * get_texel_size(info.internal_format);
+        } else if (!levels_.empty()) {
+            // A generated mipmap has the format of level 0
+            const auto& base = levels_[0];
+            auto width = static_cast<std::size_t>(std::max(base.width >> level, 1));
+            auto height = static_cast<std::size_t>(std::max(base.height >> level, 1));
+            size += base.compressed_size != 0
+                ? static_cast<std::size_t>(base.compressed_size) >> (2 * level)
+                : width * height * get_texel_size(base.internal_format);
+        }
+    }
+    return size;
+}
+
+[[nodiscard]] bool gl_texture::is_resident() const noexcept
+{
+    return resident_;
+}
+
+gl_texture& gl_texture::evict(const std::string& spill_path)
+{
+    if (!resident_)
+        return *this;
+    if (texture_type_ != GL_TEXTURE_2D)
+        throw std::runtime_error("Only 2D textures can be evicted");
+    if (has_immutable_storage())
+        throw std::runtime_error("Texture " + get_id() + " has immutable storage, it can't be evicted");
+
+    if (!dsa_)
+        bind();
+    GLint pack_alignment = 0;
+    lomeglcall(glGetIntegerv, GL_PACK_ALIGNMENT, &pack_alignment);
+    lomeglcall(glPixelStorei, GL_PACK_ALIGNMENT, 1);
+    std::vector<unsigned char> data;
+    for (int level = 0; level < static_cast<int>(levels_.size()); ++level)
+    {
+        const auto& info = levels_[level];
+        if (info.width == 0)
+            continue;
+        auto offset = data.size();
+        if (info.compressed_size != 0)
+        {
+            data.resize(offset + static_cast<std::size_t>(info.compressed_size));
+            if (dsa_)
+                lomeglcall(glGetCompressedTextureImage, texture_.get(), level, info.compressed_size, data.data() + offset);
+            else
+                lomeglcall(glGetCompressedTexImage, GL_TEXTURE_2D, level, data.data() + offset);
+        } else {
+            data.resize(offset + static_cast<std::size_t>(info.width) * static_cast<std::size_t>(info.height) * get_pixel_size(info.data_format, info.data_type));
+            if (dsa_)
+                lomeglcall(glGetTextureImage, texture_.get(), level, info.data_format, info.data_type, static_cast<GLsizei>(data.size() - offset),
+                    data.data() + offset);
+            else
+                lomeglcall(glGetTexImage, GL_TEXTURE_2D, level, info.data_format, info.data_type, data.data() + offset);
+        }
+    }
+    lomeglcall(glPixelStorei, GL_PACK_ALIGNMENT, pack_alignment);
+    evicted_.store(std::move(data), spill_path);
+
+    // An empty image frees the storage of a level
+    dsa_bind_guard guard(dsa_, GL_TEXTURE_2D, texture_.get());
+    for (int level = 0; level < storage_level_count_(); ++level)
+        lomeglcall(glTexImage2D, GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    resident_ = false;
+    return *this;
+}
+
+gl_texture& gl_texture::make_resident()
+{
+    if (resident_)
+        return *this;
+
+    auto data = evicted_.take();
+    resident_ = true;
+    if (!dsa_)
+        bind();
+    dsa_bind_guard guard(dsa_, GL_TEXTURE_2D, texture_.get());
+    auto& cache = gl_state_cache::get();
+    auto unpack_alignment = cache.get_unpack_alignment();
+    cache.unpack_alignment(1);
+    std::size_t offset = 0;
+    for (int level = 0; level < static_cast<int>(levels_.size()); ++level)
+    {
+        const auto& info = levels_[level];
+        if (info.width == 0)
+            continue;
+        if (info.compressed_size != 0)
+        {
+            lomeglcall(glCompressedTexImage2D, GL_TEXTURE_2D, level, static_cast<GLenum>(info.internal_format), info.width, info.height, 0,
+                info.compressed_size, data.data() + offset);
+            offset += static_cast<std::size_t>(info.compressed_size);
+        } else {
+            lomeglcall(glTexImage2D, GL_TEXTURE_2D, level, info.internal_format, info.width, info.height, 0, info.data_format, info.data_type,
+                data.data() + offset);
+            offset += static_cast<std::size_t>(info.width) * static_cast<std::size_t>(info.height) * get_pixel_size(info.data_format, info.data_type);
+        }
+    }
+    cache.unpack_alignment(unpack_alignment);
+    if (has_mipmap_ && dsa_)
+        lomeglcall(glGenerateTextureMipmap, texture_.get());
+    else if (has_mipmap_)
+        lomeglcall(glGenerateMipmap, GL_TEXTURE_2D);
+    return *this;
+}
+
+[[nodiscard]] std::uint64_t gl_texture::get_last_used_frame() const noexcept
+{
+    return last_used_frame_;
+}
+
+gl_texture& gl_texture::set_last_used_frame(std::uint64_t frame) noexcept
+{
+    last_used_frame_ = frame;
+    return *this;
+}
+
+gl_texture& gl_texture::set_pinned(bool pinned) noexcept
+{
+    pinned_ = pinned;
+    return *this;
+}
+
+[[nodiscard]] bool gl_texture::is_pinned() const noexcept
 {
-    int current_bind_texture = 0;
-    auto current_bind_type_pname = get_texture_pname_from_type_(texture_type_);
-    if (current_bind_type_pname == 0)
-        return false;
-    lomeglcall(glGetIntegerv, current_bind_type_pname, &current_bind_texture);
+    return pinned_;
+}
 
-    return !(current_bind_texture == 0 || current_bind_texture != texture_.get());
+gl_texture& gl_texture::label_objects() noexcept
+{
+    label_pending_ = true;
+    return *this;
+}
+
+void gl_texture::set_level_(int level, const level_& info)
+{
+    assert(level >= 0);
+    if (level >= static_cast<int>(levels_.size()))
+        levels_.resize(static_cast<std::size_t>(level) + 1);
+    levels_[level] = info;
+}
+
+[[nodiscard]] int gl_texture::storage_level_count_() const noexcept
+{
+    auto count = static_cast<int>(levels_.size());
+    if (has_mipmap_ && !levels_.empty())
+    {
+        auto extent = static_cast<unsigned int>(std::max({ levels_[0].width, levels_[0].height, 1 }));
+        count = std::max(count, static_cast<int>(std::bit_width(extent)));
+    }
+    return std::max(count, storage_levels_);
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void gl_texture::check_storage_(int level, int internal_format, int width, int height) const
+{
+    if (level >= storage_levels_ || get_sized_format(internal_format) != storage_format_
+        || std::max(storage_width_ >> level, 1) != width || std::max(storage_height_ >> level, 1) != height)
+        throw std::runtime_error("The level " + std::to_string(level) + " image doesn't fit the immutable storage of texture " + get_id());
+}
+
+[[nodiscard]] unique_texture gl_texture::create_texture_(unsigned int texture_type, bool dsa)
+{
+    if (!dsa)
+        return gl_val_factory<gl_val_type::texture>();
+    unsigned int texture = 0;
+    glCreateTextures(texture_type, 1, &texture);
+    return gl_val_factory<gl_val_type::texture>(texture);
+}
+
+bool gl_texture::check_texture_bind_()
+{
+    return gl_state_cache::get().is_texture_bound(texture_type_, texture_.get());
 }
 
 [[nodiscard]] constexpr unsigned int gl_texture::get_texture_pname_from_type_(unsigned int target_type)
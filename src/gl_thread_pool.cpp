@@ -0,0 +1,109 @@
+#include "lomegl/gl_thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace lomegl {
+
+gl_thread_pool::gl_thread_pool(std::size_t worker_count)
+{
+    workers_.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; ++i)
+        workers_.emplace_back([this] { worker_loop_(); });
+}
+
+gl_thread_pool::~gl_thread_pool()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+void gl_thread_pool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& func)
+{
+    if (workers_.empty() || count <= 1)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            func(i);
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        job_ = &func;
+        job_count_ = count;
+        next_index_.store(0, std::memory_order_relaxed);
+        pending_workers_ = workers_.size();
+        error_ = nullptr;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    run_job_();
+
+    // Every worker must leave the job before `func` goes out of scope
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this] { return pending_workers_ == 0; });
+    job_ = nullptr;
+    if (error_)
+        std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+[[nodiscard]] std::size_t gl_thread_pool::worker_count() const noexcept
+{
+    return workers_.size();
+}
+
+[[nodiscard]] std::size_t gl_thread_pool::default_worker_count() noexcept
+{
+    // The calling thread is a worker too
+    auto hardware = static_cast<std::size_t>(std::thread::hardware_concurrency());
+    return hardware > 1 ? std::min<std::size_t>(hardware - 1, 7) : 0;
+}
+
+void gl_thread_pool::worker_loop_()
+{
+    std::uint64_t seen_generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen_generation; });
+            if (stop_)
+                return;
+            seen_generation = generation_;
+        }
+
+        run_job_();
+
+        std::lock_guard lock(mutex_);
+        if (--pending_workers_ == 0)
+            done_.notify_one();
+    }
+}
+
+void gl_thread_pool::run_job_() noexcept
+{
+    while (true)
+    {
+        auto index = next_index_.fetch_add(1, std::memory_order_relaxed);
+        if (index >= job_count_)
+            return;
+
+        try
+        {
+            (*job_)(index);
+        } catch (...)
+        {
+            std::lock_guard lock(mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+        }
+    }
+}
+
+} // namespace lomegl
@@ -0,0 +1,531 @@
+#include "lomegl/gl_transform.h"
+
+#include <atomic>
+#include <bit>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    define LOMEGL_TRANSFORM_X86 1
+#    include <immintrin.h>
+#    ifdef _MSC_VER
+#        include <intrin.h>
+#        define LOMEGL_TARGET_AVX2
+#    else
+#        define LOMEGL_TARGET_AVX2 __attribute__((target("avx2")))
+#    endif
+#endif
+
+namespace lomegl {
+
+namespace {
+
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::mat4) == 16 * sizeof(float), "glm types must be tightly packed");
+
+    struct kernel_io
+    {
+        const glm::vec3* pos;
+        const glm::vec3* front;
+        const glm::vec3* up;
+        const glm::vec3* scale;
+        glm::mat4* model;
+        glm::mat4* model_no_scale;
+        glm::mat4* view;
+    };
+
+    // The matrices are composed directly from the orthonormal basis and the position, it gives the same result as
+    // view = lookAt(pos, pos + front, up), model_no_scale = inverse(view), model = scale(model_no_scale, scale).
+    // The basis is used instead of the quaternion, because it always holds the accumulated rotation.
+    void compose_scalar(const kernel_io& io, const std::uint32_t* slots, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto slot = slots[i];
+            const auto& pos = io.pos[slot];
+            const auto& scale = io.scale[slot];
+            auto f = glm::normalize(io.front[slot]);
+            auto s = glm::normalize(glm::cross(f, io.up[slot]));
+            auto u = glm::cross(s, f);
+
+            auto& model_no_scale = io.model_no_scale[slot];
+            model_no_scale[0] = glm::vec4(s, 0);
+            model_no_scale[1] = glm::vec4(u, 0);
+            model_no_scale[2] = glm::vec4(-f, 0);
+            model_no_scale[3] = glm::vec4(pos, 1);
+
+            auto& model = io.model[slot];
+            model[0] = glm::vec4(s * scale.x, 0);
+            model[1] = glm::vec4(u * scale.y, 0);
+            model[2] = glm::vec4(-f * scale.z, 0);
+            model[3] = glm::vec4(pos, 1);
+
+            // Affine inverse of a rigid transform: transpose the rotation, rotate back the translation
+            auto& view = io.view[slot];
+            view[0] = glm::vec4(s.x, u.x, -f.x, 0);
+            view[1] = glm::vec4(s.y, u.y, -f.y, 0);
+            view[2] = glm::vec4(s.z, u.z, -f.z, 0);
+            view[3] = glm::vec4(-glm::dot(s, pos), -glm::dot(u, pos), glm::dot(f, pos), 1);
+        }
+    }
+
+#ifdef LOMEGL_TRANSFORM_X86
+
+    // Transpose 4 lanes of (a, b, c, d) and store them as column `column` of the 4 matrices
+    inline void store_column4(glm::mat4* mats, const std::uint32_t* slots, int column, __m128 a, __m128 b, __m128 c, __m128 d)
+    {
+        _MM_TRANSPOSE4_PS(a, b, c, d);
+        _mm_storeu_ps(&mats[slots[0]][column][0], a);
+        _mm_storeu_ps(&mats[slots[1]][column][0], b);
+        _mm_storeu_ps(&mats[slots[2]][column][0], c);
+        _mm_storeu_ps(&mats[slots[3]][column][0], d);
+    }
+
+    // Components of 3d vectors of 4 objects, one object per lane
+    struct vec3x4
+    {
+        __m128 x;
+        __m128 y;
+        __m128 z;
+    };
+
+    inline vec3x4 load_vec3x4(const glm::vec3* base, const std::uint32_t* slots)
+    {
+        const auto& v0 = base[slots[0]];
+        const auto& v1 = base[slots[1]];
+        const auto& v2 = base[slots[2]];
+        const auto& v3 = base[slots[3]];
+        return { _mm_setr_ps(v0.x, v1.x, v2.x, v3.x), _mm_setr_ps(v0.y, v1.y, v2.y, v3.y), _mm_setr_ps(v0.z, v1.z, v2.z, v3.z) };
+    }
+
+    inline __m128 dot4(const vec3x4& a, const vec3x4& b)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+    }
+
+    inline vec3x4 cross4(const vec3x4& a, const vec3x4& b)
+    {
+        return { _mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+            _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+            _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x)) };
+    }
+
+    inline vec3x4 normalize4(const vec3x4& a)
+    {
+        auto inv_len = _mm_div_ps(_mm_set1_ps(1.0F), _mm_sqrt_ps(dot4(a, a)));
+        return { _mm_mul_ps(a.x, inv_len), _mm_mul_ps(a.y, inv_len), _mm_mul_ps(a.z, inv_len) };
+    }
+
+    // Store the matrices of 4 objects from their basis(s, u, f), position and scale
+    inline void store_matrices4(const kernel_io& io, const std::uint32_t* slots, const vec3x4& s, const vec3x4& u, const vec3x4& f,
+        const vec3x4& pos, const vec3x4& scale)
+    {
+        auto zero = _mm_setzero_ps();
+        auto one = _mm_set1_ps(1.0F);
+        vec3x4 nf = { _mm_sub_ps(zero, f.x), _mm_sub_ps(zero, f.y), _mm_sub_ps(zero, f.z) };
+
+        store_column4(io.model_no_scale, slots, 0, s.x, s.y, s.z, zero);
+        store_column4(io.model_no_scale, slots, 1, u.x, u.y, u.z, zero);
+        store_column4(io.model_no_scale, slots, 2, nf.x, nf.y, nf.z, zero);
+        store_column4(io.model_no_scale, slots, 3, pos.x, pos.y, pos.z, one);
+
+        store_column4(io.model, slots, 0, _mm_mul_ps(s.x, scale.x), _mm_mul_ps(s.y, scale.x), _mm_mul_ps(s.z, scale.x), zero);
+        store_column4(io.model, slots, 1, _mm_mul_ps(u.x, scale.y), _mm_mul_ps(u.y, scale.y), _mm_mul_ps(u.z, scale.y), zero);
+        store_column4(io.model, slots, 2, _mm_mul_ps(nf.x, scale.z), _mm_mul_ps(nf.y, scale.z), _mm_mul_ps(nf.z, scale.z), zero);
+        store_column4(io.model, slots, 3, pos.x, pos.y, pos.z, one);
+
+        store_column4(io.view, slots, 0, s.x, u.x, nf.x, zero);
+        store_column4(io.view, slots, 1, s.y, u.y, nf.y, zero);
+        store_column4(io.view, slots, 2, s.z, u.z, nf.z, zero);
+        store_column4(io.view, slots, 3, _mm_sub_ps(zero, dot4(s, pos)), _mm_sub_ps(zero, dot4(u, pos)), dot4(f, pos), one);
+    }
+
+    void compose_sse2(const kernel_io& io, const std::uint32_t* slots, std::size_t count)
+    {
+        std::size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto* batch = slots + i;
+            auto f = normalize4(load_vec3x4(io.front, batch));
+            auto s = normalize4(cross4(f, load_vec3x4(io.up, batch)));
+            auto u = cross4(s, f);
+            store_matrices4(io, batch, s, u, f, load_vec3x4(io.pos, batch), load_vec3x4(io.scale, batch));
+        }
+        compose_scalar(io, slots + i, count - i);
+    }
+
+    struct vec3x8
+    {
+        __m256 x;
+        __m256 y;
+        __m256 z;
+    };
+
+    LOMEGL_TARGET_AVX2 inline vec3x8 load_vec3x8(const glm::vec3* base, __m256i float_index)
+    {
+        const auto* data = &base[0].x;
+        return { _mm256_i32gather_ps(data, float_index, 4), _mm256_i32gather_ps(data + 1, float_index, 4), _mm256_i32gather_ps(data + 2, float_index, 4) };
+    }
+
+    LOMEGL_TARGET_AVX2 inline __m256 dot8(const vec3x8& a, const vec3x8& b)
+    {
+        return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a.x, b.x), _mm256_mul_ps(a.y, b.y)), _mm256_mul_ps(a.z, b.z));
+    }
+
+    LOMEGL_TARGET_AVX2 inline vec3x8 cross8(const vec3x8& a, const vec3x8& b)
+    {
+        return { _mm256_sub_ps(_mm256_mul_ps(a.y, b.z), _mm256_mul_ps(a.z, b.y)),
+            _mm256_sub_ps(_mm256_mul_ps(a.z, b.x), _mm256_mul_ps(a.x, b.z)),
+            _mm256_sub_ps(_mm256_mul_ps(a.x, b.y), _mm256_mul_ps(a.y, b.x)) };
+    }
+
+    LOMEGL_TARGET_AVX2 inline vec3x8 normalize8(const vec3x8& a)
+    {
+        auto inv_len = _mm256_div_ps(_mm256_set1_ps(1.0F), _mm256_sqrt_ps(dot8(a, a)));
+        return { _mm256_mul_ps(a.x, inv_len), _mm256_mul_ps(a.y, inv_len), _mm256_mul_ps(a.z, inv_len) };
+    }
+
+    LOMEGL_TARGET_AVX2 inline vec3x4 half8(const vec3x8& a, bool high)
+    {
+        if (high)
+            return { _mm256_extractf128_ps(a.x, 1), _mm256_extractf128_ps(a.y, 1), _mm256_extractf128_ps(a.z, 1) };
+        return { _mm256_castps256_ps128(a.x), _mm256_castps256_ps128(a.y), _mm256_castps256_ps128(a.z) };
+    }
+
+    LOMEGL_TARGET_AVX2 void compose_avx2(const kernel_io& io, const std::uint32_t* slots, std::size_t count)
+    {
+        std::size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto* batch = slots + i;
+            // Slots are less than 2^20, so the float index never overflows
+            auto float_index = _mm256_mullo_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(batch)), _mm256_set1_epi32(3)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            auto f = normalize8(load_vec3x8(io.front, float_index));
+            auto s = normalize8(cross8(f, load_vec3x8(io.up, float_index)));
+            auto u = cross8(s, f);
+            auto pos = load_vec3x8(io.pos, float_index);
+            auto scale = load_vec3x8(io.scale, float_index);
+
+            // The math is done in 8 lanes, the matrices are written 4 objects at a time
+            store_matrices4(io, batch, half8(s, false), half8(u, false), half8(f, false), half8(pos, false), half8(scale, false));
+            store_matrices4(io, batch + 4, half8(s, true), half8(u, true), half8(f, true), half8(pos, true), half8(scale, true));
+        }
+        compose_sse2(io, slots + i, count - i);
+    }
+
+    gl_simd_level detect_simd_level() noexcept
+    {
+#    ifdef _MSC_VER
+        int info[4] = {};
+        __cpuid(info, 1);
+        bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        if (os_avx && (info[1] & (1 << 5)) != 0)
+            return gl_simd_level::avx2;
+#    else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") != 0)
+            return gl_simd_level::avx2;
+#    endif
+        return gl_simd_level::sse2;
+    }
+
+#else
+
+    gl_simd_level detect_simd_level() noexcept
+    {
+        return gl_simd_level::scalar;
+    }
+
+#endif
+
+    std::atomic<gl_simd_level>& current_simd_level()
+    {
+        static std::atomic<gl_simd_level> level { detect_simd_level() };
+        return level;
+    }
+
+} // namespace
+
+std::uint32_t gl_transform_store::allocate()
+{
+    std::uint32_t slot = 0;
+    if (!free_.empty())
+    {
+        slot = free_.back();
+        free_.pop_back();
+    } else {
+        slot = static_cast<std::uint32_t>(pos_.size());
+        pos_.emplace_back();
+        front_.emplace_back();
+        right_.emplace_back();
+        up_.emplace_back();
+        rotate_.emplace_back();
+        scale_.emplace_back();
+        model_no_scale_.emplace_back();
+        model_.emplace_back();
+        view_.emplace_back();
+        alive_.emplace_back();
+        parent_.emplace_back();
+        child_count_.emplace_back();
+        version_.emplace_back();
+        parent_version_.emplace_back();
+        if (slot / 64 >= dirty_.size())
+            dirty_.push_back(0);
+    }
+
+    alive_[slot] = 1;
+    parent_[slot] = npos;
+    child_count_[slot] = 0;
+    parent_version_[slot] = 0;
+    order_dirty_ = true;
+
+    pos_[slot] = glm::vec3(0, 0, 0);
+    front_[slot] = glm::vec3(0, 0, 1);
+    right_[slot] = glm::vec3(1, 0, 0);
+    up_[slot] = glm::vec3(0, 1, 0);
+    rotate_[slot] = glm::quat(1, 0, 0, 0);
+    scale_[slot] = glm::vec3(1, 1, 1);
+    mark_transform(slot);
+    return slot;
+}
+
+std::uint32_t gl_transform_store::allocate_copy(const gl_transform_store& other, std::uint32_t slot)
+{
+    auto new_slot = allocate();
+    copy(other, slot, new_slot);
+    return new_slot;
+}
+
+void gl_transform_store::release(std::uint32_t slot) noexcept
+{
+    // Children of a released slot become roots
+    if (child_count_[slot] != 0)
+    {
+        for (std::uint32_t child = 0; child < parent_.size(); ++child)
+        {
+            if (alive_[child] != 0 && parent_[child] == slot)
+            {
+                parent_[child] = npos;
+                --parent_count_;
+                mark_transform(child);
+            }
+        }
+        child_count_[slot] = 0;
+    }
+
+    if (parent_[slot] != npos)
+    {
+        --child_count_[parent_[slot]];
+        --parent_count_;
+        parent_[slot] = npos;
+    }
+
+    alive_[slot] = 0;
+    clear_transform_(slot);
+    free_.push_back(slot);
+    order_dirty_ = true;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+void gl_transform_store::copy(const gl_transform_store& other, std::uint32_t other_slot, std::uint32_t slot) noexcept
+{
+    pos_[slot] = other.pos_[other_slot];
+    front_[slot] = other.front_[other_slot];
+    right_[slot] = other.right_[other_slot];
+    up_[slot] = other.up_[other_slot];
+    rotate_[slot] = other.rotate_[other_slot];
+    scale_[slot] = other.scale_[other_slot];
+    mark_transform(slot);
+}
+
+void gl_transform_store::set_parent(std::uint32_t slot, std::uint32_t parent)
+{
+    if (parent_[slot] == parent)
+        return;
+
+    for (auto ancestor = parent; ancestor != npos; ancestor = parent_[ancestor])
+    {
+        if (ancestor == slot)
+            throw std::runtime_error("Set transform parent fails: it makes a cycle");
+    }
+
+    if (parent_[slot] != npos)
+    {
+        --child_count_[parent_[slot]];
+        --parent_count_;
+    }
+    parent_[slot] = parent;
+    if (parent != npos)
+    {
+        ++child_count_[parent];
+        ++parent_count_;
+    }
+    order_dirty_ = true;
+    mark_transform(slot);
+}
+
+void gl_transform_store::update(std::uint32_t slot)
+{
+    auto parent = parent_[slot];
+    if (parent != npos)
+    {
+        update(parent);
+        if (parent_version_[slot] != version_[parent])
+            mark_transform(slot);
+    }
+
+    if (is_transform(slot))
+    {
+        kernel_io io { pos_.data(), front_.data(), up_.data(), scale_.data(), model_.data(), model_no_scale_.data(), view_.data() };
+        compose_scalar(io, &slot, 1);
+        if (parent != npos)
+            apply_parent_(slot);
+        ++version_[slot];
+        clear_transform_(slot);
+    }
+}
+
+void gl_transform_store::update_all()
+{
+    if (parent_count_ != 0)
+    {
+        if (order_dirty_)
+            rebuild_order_();
+
+        // Parents come first in depth-first order, so one pass propagates the flags to the whole subtree
+        for (auto slot : order_)
+        {
+            auto parent = parent_[slot];
+            if (parent != npos && (is_transform(parent) || parent_version_[slot] != version_[parent]))
+                mark_transform(slot);
+        }
+    }
+
+    batch_.clear();
+    for (std::size_t word = 0; word < dirty_.size(); ++word)
+    {
+        for (auto bits = dirty_[word]; bits != 0; bits &= bits - 1)
+            batch_.push_back(static_cast<std::uint32_t>(word * 64 + std::countr_zero(bits)));
+    }
+    if (batch_.empty())
+        return;
+
+    kernel_io io { pos_.data(), front_.data(), up_.data(), scale_.data(), model_.data(), model_no_scale_.data(), view_.data() };
+    switch (get_simd_level())
+    {
+#ifdef LOMEGL_TRANSFORM_X86
+    case gl_simd_level::avx2:
+        compose_avx2(io, batch_.data(), batch_.size());
+        break;
+    case gl_simd_level::sse2:
+        compose_sse2(io, batch_.data(), batch_.size());
+        break;
+#endif
+    default:
+        compose_scalar(io, batch_.data(), batch_.size());
+        break;
+    }
+
+    // The kernel computes local matrices, then children are moved to world space after their parents
+    if (parent_count_ != 0)
+    {
+        for (auto slot : order_)
+        {
+            if (!is_transform(slot))
+                continue;
+            if (parent_[slot] != npos)
+                apply_parent_(slot);
+            ++version_[slot];
+        }
+    } else {
+        for (auto slot : batch_)
+            ++version_[slot];
+    }
+
+    for (auto& word : dirty_)
+        word = 0;
+}
+
+void gl_transform_store::apply_parent_(std::uint32_t slot) noexcept
+{
+    auto parent = parent_[slot];
+
+    // The frame of the parent is (right, up, front, pos), while model_no_scale is (-right, up, -front, pos)
+    glm::mat4 frame = model_no_scale_[parent];
+    frame[0] = frame[0] * -1.0F;
+    frame[2] = frame[2] * -1.0F;
+    model_no_scale_[slot] = frame * model_no_scale_[slot];
+    model_[slot] = frame * model_[slot];
+
+    // Affine inverse of the rigid world transform
+    const auto& world = model_no_scale_[slot];
+    auto& view = view_[slot];
+    glm::vec3 pos(world[3]);
+    for (int column = 0; column < 3; ++column)
+    {
+        glm::vec3 axis(world[column]);
+        view[0][column] = axis.x;
+        view[1][column] = axis.y;
+        view[2][column] = axis.z;
+        view[3][column] = -glm::dot(axis, pos);
+    }
+    view[0][3] = view[1][3] = view[2][3] = 0;
+    view[3][3] = 1;
+
+    parent_version_[slot] = version_[parent];
+}
+
+void gl_transform_store::rebuild_order_()
+{
+    auto count = static_cast<std::uint32_t>(parent_.size());
+
+    // Group the children of every slot with a counting sort
+    std::vector<std::uint32_t> child_begin(count + 1, 0);
+    for (std::uint32_t slot = 0; slot < count; ++slot)
+    {
+        if (alive_[slot] != 0 && parent_[slot] != npos)
+            ++child_begin[parent_[slot] + 1];
+    }
+    for (std::uint32_t slot = 0; slot < count; ++slot)
+        child_begin[slot + 1] += child_begin[slot];
+
+    std::vector<std::uint32_t> children(child_begin[count]);
+    std::vector<std::uint32_t> cursor(child_begin.begin(), child_begin.end() - 1);
+    for (std::uint32_t slot = 0; slot < count; ++slot)
+    {
+        if (alive_[slot] != 0 && parent_[slot] != npos)
+            children[cursor[parent_[slot]]++] = slot;
+    }
+
+    order_.clear();
+    std::vector<std::uint32_t> stack;
+    for (std::uint32_t root = 0; root < count; ++root)
+    {
+        if (alive_[root] == 0 || parent_[root] != npos)
+            continue;
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            auto slot = stack.back();
+            stack.pop_back();
+            order_.push_back(slot);
+            for (auto i = child_begin[slot + 1]; i > child_begin[slot]; --i)
+                stack.push_back(children[i - 1]);
+        }
+    }
+    order_dirty_ = false;
+}
+
+[[nodiscard]] gl_simd_level gl_transform_store::get_simd_level() noexcept
+{
+    return current_simd_level().load(std::memory_order_relaxed);
+}
+
+void gl_transform_store::set_simd_level(gl_simd_level level) noexcept
+{
+    if (level < detect_simd_level())
+        current_simd_level().store(level, std::memory_order_relaxed);
+    else
+        current_simd_level().store(detect_simd_level(), std::memory_order_relaxed);
+}
+
+} // namespace lomegl
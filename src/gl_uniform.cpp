@@ -0,0 +1,30 @@
+#include "lomegl/gl_uniform.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#    define LOMEGL_UNIFORM_X86 1
+#    include <immintrin.h>
+#endif
+
+namespace lomegl {
+
+[[nodiscard]] bool uniform_value_equal(const void* lhs, const void* rhs, std::size_t size) noexcept
+{
+    const auto* a = static_cast<const unsigned char*>(lhs);
+    const auto* b = static_cast<const unsigned char*>(rhs);
+    std::size_t i = 0;
+#ifdef LOMEGL_UNIFORM_X86
+    // Most values are a few vectors, so it beats the setup of a libc memcmp
+    for (; i + 16 <= size; i += 16)
+    {
+        auto diff = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));                        // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        if (_mm_movemask_epi8(diff) != 0xFFFF)
+            return false;
+    }
+#endif
+    return std::memcmp(a + i, b + i, size - i) == 0;
+}
+
+} // namespace lomegl
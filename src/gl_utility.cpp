@@ -19,7 +19,7 @@ std::string get_content_from_file(const char* path)
 
 image_data get_image_from_file(const char* path, bool flip_vertically)
 {
-    stbi_set_flip_vertically_on_load(static_cast<int>(flip_vertically));
+    stbi_set_flip_vertically_on_load_thread(static_cast<int>(flip_vertically));
     int width {};
     int height {};
     int nrChannels {};
@@ -33,7 +33,7 @@ image_data get_image_from_file(const char* path, bool flip_vertically)
 
 image_info get_image_info_from_memory(const unsigned char* buffer, int size, bool flip_vertically)
 {
-    stbi_set_flip_vertically_on_load(static_cast<int>(flip_vertically));
+    stbi_set_flip_vertically_on_load_thread(static_cast<int>(flip_vertically));
     int width {};
     int height {};
     int nrChannels {};
@@ -48,7 +48,7 @@ image_info get_image_info_from_memory(const unsigned char* buffer, int size, boo
 
 image_data get_image_from_memory(const unsigned char* buffer, int size, bool flip_vertically)
 {
-    stbi_set_flip_vertically_on_load(static_cast<int>(flip_vertically));
+    stbi_set_flip_vertically_on_load_thread(static_cast<int>(flip_vertically));
     int width {};
     int height {};
     int nrChannels {};
@@ -1,12 +1,56 @@
 #include "lomegl/gl_vertex.h"
+#include "lomegl/gl_debug.h"
 #include "lomegl/gl_exception.h"
+#include "lomegl/gl_state_cache.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 namespace lomegl {
 
+namespace {
+
+    // Bytes of one attribute, the stride of a tightly packed vbo
+    GLsizei get_attrib_size(GLint size, GLenum type) noexcept
+    {
+        switch (type)
+        {
+        case GL_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_10F_11F_11F_REV:
+            return 4;
+        default:
+            break;
+        }
+
+        auto components = size == GL_BGRA ? 4 : size;
+        switch (type)
+        {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return components;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return components * 2;
+        case GL_DOUBLE:
+            return components * 8;
+        default:
+            return components * 4;
+        }
+    }
+
+} // namespace
+
 gl_vertex::gl_vertex() : VAO_(gl_val_factory<gl_val_type::vao>()),
                          VBO_(gl_val_factory<gl_val_type::vbo>()),
-                         EBO_(gl_val_factory<gl_val_type::ebo>())
+                         EBO_(gl_val_factory<gl_val_type::ebo>()),
+                         instance_VBO_(gl_val_factory<gl_val_type::vbo>(0)),
+                         dsa_(is_dsa_enabled())
 {
+    // 0 is a invaild value
+    instance_VBO_.release();
 }
 
 gl_vertex::~gl_vertex() = default;
@@ -46,65 +90,325 @@ gl_vertex::~gl_vertex() = default;
     return vbo_counts_;
 }
 
+[[nodiscard]] bool gl_vertex::uses_dsa() const noexcept
+{
+    return dsa_;
+}
+
+[[nodiscard]] const gl_bounds& gl_vertex::get_bounds() const noexcept
+{
+    return bounds_;
+}
+
+gl_vertex& gl_vertex::set_bounds(const gl_bounds& bounds) noexcept
+{
+    bounds_ = bounds;
+    return *this;
+}
+
 // Before any operation, call this function
 gl_vertex& gl_vertex::bind_this()
 {
-    glBindVertexArray(VAO_.get());
+    gl_state_cache::get().bind_vertex_array(VAO_.get());
+    if (label_pending_) [[unlikely]]
+    {
+        label_pending_ = false;
+        gl_object_label(GL_VERTEX_ARRAY, VAO_.get(), get_id());
+        if (is_vbo_binded_)
+            gl_object_label(GL_BUFFER, VBO_.get(), get_id() + ".vbo");
+        if (is_ebo_binded_)
+            gl_object_label(GL_BUFFER, EBO_.get(), get_id() + ".ebo");
+    }
     return *this;
 }
 
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 gl_vertex& gl_vertex::bind_elemnt_buffer_data(const void* ebo_data, GLsizeiptr size, GLenum usage, int elemnt_counts)
 {
-    assert(check_vao_bind_());
+    assert(dsa_ || check_vao_bind_());
     // assert(!is_ebo_binded_);
-    lomeglcall(glBindBuffer, GL_ELEMENT_ARRAY_BUFFER, EBO_.get());
-    lomeglcall(glBufferData, GL_ELEMENT_ARRAY_BUFFER, size, ebo_data, usage);
+    make_resident();
+    if (dsa_)
+    {
+        lomeglcall(glNamedBufferData, EBO_.get(), size, ebo_data, usage);
+        lomeglcall(glVertexArrayElementBuffer, VAO_.get(), EBO_.get());
+    } else {
+        gl_state_cache::get().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, EBO_.get());
+        lomeglcall(glBufferData, GL_ELEMENT_ARRAY_BUFFER, size, ebo_data, usage);
+    }
+    if (labeled_ && !is_ebo_binded_)
+        gl_object_label(GL_BUFFER, EBO_.get(), get_id() + ".ebo");
     is_ebo_binded_ = true;
     ebo_counts_ = elemnt_counts;
+    ebo_size_ = size;
+    ebo_usage_ = usage;
     return *this;
 }
 
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
-gl_vertex& gl_vertex::bind_array_buffer_data(const void* vbo_data, GLsizeiptr size, GLenum usage, int vertex_counts)
+gl_vertex& gl_vertex::bind_array_buffer_data(const void* vbo_data, GLsizeiptr size, GLenum usage, int vertex_counts, GLsizei position_stride)
 {
-    assert(check_vao_bind_());
+    assert(dsa_ || check_vao_bind_());
     // assert(!is_vbo_binded_);
-    lomeglcall(glBindBuffer, GL_ARRAY_BUFFER, VBO_.get());
-    lomeglcall(glBufferData, GL_ARRAY_BUFFER, size, vbo_data, usage);
+    make_resident();
+    if (dsa_)
+        lomeglcall(glNamedBufferData, VBO_.get(), size, vbo_data, usage);
+    else {
+        gl_state_cache::get().bind_buffer(GL_ARRAY_BUFFER, VBO_.get());
+        lomeglcall(glBufferData, GL_ARRAY_BUFFER, size, vbo_data, usage);
+    }
+    if (labeled_ && !is_vbo_binded_)
+        gl_object_label(GL_BUFFER, VBO_.get(), get_id() + ".vbo");
     is_vbo_binded_ = true;
     vbo_counts_ = vertex_counts;
+    vbo_size_ = size;
+    vbo_usage_ = usage;
+    if (position_stride != 0 && vbo_data != nullptr)
+    {
+        assert(static_cast<GLsizeiptr>(vertex_counts - 1) * position_stride + 3 * static_cast<GLsizeiptr>(sizeof(float)) <= size);
+        bounds_ = gl_bounds::from_positions(vbo_data, static_cast<std::uint32_t>(vertex_counts), position_stride);
+    }
     return *this;
 }
 
 // NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
 gl_vertex& gl_vertex::vertex_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* start_offset)
 {
-    assert(check_vao_bind_() && check_vbo_bind_());
-    lomeglcall(glVertexAttribPointer, index, size, type, normalized, stride, start_offset);
+    assert(dsa_ || (check_vao_bind_() && check_vbo_bind_()));
+    auto offset = reinterpret_cast<std::uintptr_t>(start_offset); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (dsa_)
+    {
+        // A binding point per attribute keeps the stride and offset of each attribute, like glVertexAttribPointer
+        lomeglcall(glVertexArrayVertexBuffer, VAO_.get(), index, VBO_.get(), static_cast<GLintptr>(offset),
+            stride != 0 ? stride : get_attrib_size(size, type));
+        lomeglcall(glVertexArrayAttribFormat, VAO_.get(), index, size, type, normalized, 0);
+        lomeglcall(glVertexArrayAttribBinding, VAO_.get(), index, index);
+    } else
+        lomeglcall(glVertexAttribPointer, index, size, type, normalized, stride, start_offset);
+
+    auto& attrib = find_attrib_(index);
+    attrib = { index, size, type, normalized, stride, offset, attrib.enabled };
     return *this;
 }
 
 gl_vertex& gl_vertex::enable_vertex_attrib_array(GLuint index)
 {
-    assert(check_vao_bind_() && check_vbo_bind_());
-    lomeglcall(glEnableVertexAttribArray, index);
-    assert(glGetError() == 0);
+    assert(dsa_ || (check_vao_bind_() && check_vbo_bind_()));
+    if (dsa_)
+        lomeglcall(glEnableVertexArrayAttrib, VAO_.get(), index);
+    else
+        lomeglcall(glEnableVertexAttribArray, index);
+    find_attrib_(index).enabled = true;
+    return *this;
+}
+
+[[nodiscard]] const std::vector<gl_vertex_attrib>& gl_vertex::get_attribs() const noexcept
+{
+    return attribs_;
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_vertex& gl_vertex::upload_instance_models(const float* models, int count, GLuint location)
+{
+    assert((dsa_ || check_vao_bind_()) && count >= 0);
+    if (instance_VBO_.get() == 0)
+    {
+        // The path of the vertex, even if DSA was toggled since it was created
+        unsigned int buffer = 0;
+        if (dsa_)
+            lomeglcall(glCreateBuffers, 1, &buffer);
+        else
+            lomeglcall(glGenBuffers, 1, &buffer);
+        instance_VBO_ = gl_val_factory<gl_val_type::vbo>(buffer);
+    }
+
+    auto size = static_cast<GLsizeiptr>(count) * 16 * static_cast<GLsizeiptr>(sizeof(float));
+    // Grow geometrically so a growing scene doesn't reallocate every frame
+    if (size > instance_capacity_)
+        instance_capacity_ = std::max(size, instance_capacity_ * 2);
+    if (dsa_)
+    {
+        lomeglcall(glNamedBufferData, instance_VBO_.get(), instance_capacity_, nullptr, GL_STREAM_DRAW);
+        lomeglcall(glNamedBufferSubData, instance_VBO_.get(), 0, size, models);
+        if (instance_loc_ != static_cast<GLint>(location))
+        {
+            reset_instance_attribs_();
+            // The four columns share the binding point of the first one
+            lomeglcall(glVertexArrayVertexBuffer, VAO_.get(), location, instance_VBO_.get(), 0, static_cast<GLsizei>(16 * sizeof(float)));
+            lomeglcall(glVertexArrayBindingDivisor, VAO_.get(), location, 1);
+            for (GLuint column = 0; column < 4; ++column)
+            {
+                lomeglcall(glVertexArrayAttribFormat, VAO_.get(), location + column, 4, GL_FLOAT, GL_FALSE, column * 4 * static_cast<GLuint>(sizeof(float)));
+                lomeglcall(glVertexArrayAttribBinding, VAO_.get(), location + column, location);
+                lomeglcall(glEnableVertexArrayAttrib, VAO_.get(), location + column);
+            }
+            instance_loc_ = static_cast<GLint>(location);
+        }
+        return *this;
+    }
+
+    gl_state_cache::get().bind_buffer(GL_ARRAY_BUFFER, instance_VBO_.get());
+    // Orphan the old storage, so the upload doesn't wait for the previous draws
+    lomeglcall(glBufferData, GL_ARRAY_BUFFER, instance_capacity_, nullptr, GL_STREAM_DRAW);
+    lomeglcall(glBufferSubData, GL_ARRAY_BUFFER, 0, size, models);
+
+    if (instance_loc_ != static_cast<GLint>(location))
+    {
+        reset_instance_attribs_();
+        for (GLuint column = 0; column < 4; ++column)
+        {
+            lomeglcall(glVertexAttribPointer, location + column, 4, GL_FLOAT, GL_FALSE, static_cast<GLsizei>(16 * sizeof(float)),
+                reinterpret_cast<const void*>(column * 4 * sizeof(float))); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+            lomeglcall(glEnableVertexAttribArray, location + column);
+            lomeglcall(glVertexAttribDivisor, location + column, 1);
+        }
+        instance_loc_ = static_cast<GLint>(location);
+    }
+
+    gl_state_cache::get().bind_buffer(GL_ARRAY_BUFFER, VBO_.get());
+    return *this;
+}
+
+void gl_vertex::reset_instance_attribs_()
+{
+    if (instance_loc_ == -1)
+        return;
+    auto old_location = static_cast<GLuint>(instance_loc_);
+    if (dsa_)
+        lomeglcall(glVertexArrayBindingDivisor, VAO_.get(), old_location, 0);
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        if (dsa_)
+            lomeglcall(glDisableVertexArrayAttrib, VAO_.get(), old_location + column);
+        else
+        {
+            lomeglcall(glDisableVertexAttribArray, old_location + column);
+            lomeglcall(glVertexAttribDivisor, old_location + column, 0);
+        }
+    }
+    instance_loc_ = -1;
+}
+
+[[nodiscard]] std::size_t gl_vertex::get_memory_size() const noexcept
+{
+    return static_cast<std::size_t>(vbo_size_) + static_cast<std::size_t>(ebo_size_);
+}
+
+[[nodiscard]] bool gl_vertex::is_resident() const noexcept
+{
+    return resident_;
+}
+
+gl_vertex& gl_vertex::evict(const std::string& spill_path)
+{
+    if (!resident_)
+        return *this;
+
+    std::vector<unsigned char> data(get_memory_size());
+    if (dsa_)
+    {
+        if (vbo_size_ != 0)
+            lomeglcall(glGetNamedBufferSubData, VBO_.get(), 0, vbo_size_, data.data());
+        if (ebo_size_ != 0)
+            lomeglcall(glGetNamedBufferSubData, EBO_.get(), 0, ebo_size_, data.data() + vbo_size_);
+        evicted_.store(std::move(data), spill_path);
+
+        // Zero sized storage frees the memory, the buffer names stay in the vao
+        lomeglcall(glNamedBufferData, VBO_.get(), 0, nullptr, vbo_usage_);
+        lomeglcall(glNamedBufferData, EBO_.get(), 0, nullptr, ebo_usage_);
+        resident_ = false;
+        return *this;
+    }
+
+    // The ebo binding is a state of the vao
+    bind_this();
+    gl_state_cache::get().bind_buffer(GL_ARRAY_BUFFER, VBO_.get());
+    if (vbo_size_ != 0)
+        lomeglcall(glGetBufferSubData, GL_ARRAY_BUFFER, 0, vbo_size_, data.data());
+    gl_state_cache::get().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, EBO_.get());
+    if (ebo_size_ != 0)
+        lomeglcall(glGetBufferSubData, GL_ELEMENT_ARRAY_BUFFER, 0, ebo_size_, data.data() + vbo_size_);
+    evicted_.store(std::move(data), spill_path);
+
+    lomeglcall(glBufferData, GL_ARRAY_BUFFER, 0, nullptr, vbo_usage_);
+    lomeglcall(glBufferData, GL_ELEMENT_ARRAY_BUFFER, 0, nullptr, ebo_usage_);
+    resident_ = false;
+    return *this;
+}
+
+gl_vertex& gl_vertex::make_resident()
+{
+    if (resident_)
+        return *this;
+
+    auto data = evicted_.take();
+    resident_ = true;
+    if (dsa_)
+    {
+        lomeglcall(glNamedBufferData, VBO_.get(), vbo_size_, data.data(), vbo_usage_);
+        lomeglcall(glNamedBufferData, EBO_.get(), ebo_size_, data.data() + vbo_size_, ebo_usage_);
+        return *this;
+    }
+
+    bind_this();
+    gl_state_cache::get().bind_buffer(GL_ARRAY_BUFFER, VBO_.get());
+    lomeglcall(glBufferData, GL_ARRAY_BUFFER, vbo_size_, data.data(), vbo_usage_);
+    gl_state_cache::get().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, EBO_.get());
+    lomeglcall(glBufferData, GL_ELEMENT_ARRAY_BUFFER, ebo_size_, data.data() + vbo_size_, ebo_usage_);
+    return *this;
+}
+
+[[nodiscard]] std::uint64_t gl_vertex::get_last_used_frame() const noexcept
+{
+    return last_used_frame_;
+}
+
+gl_vertex& gl_vertex::set_last_used_frame(std::uint64_t frame) noexcept
+{
+    last_used_frame_ = frame;
+    return *this;
+}
+
+gl_vertex& gl_vertex::set_pinned(bool pinned) noexcept
+{
+    pinned_ = pinned;
+    return *this;
+}
+
+[[nodiscard]] bool gl_vertex::is_pinned() const noexcept
+{
+    return pinned_;
+}
+
+gl_vertex& gl_vertex::label_objects() noexcept
+{
+    labeled_ = true;
+    label_pending_ = true;
     return *this;
 }
 
+gl_vertex_attrib& gl_vertex::find_attrib_(GLuint index)
+{
+    auto it = std::lower_bound(attribs_.begin(), attribs_.end(), index, [](const gl_vertex_attrib& attrib, GLuint value) {
+        return attrib.index < value;
+    });
+    if (it == attribs_.end() || it->index != index)
+    {
+        gl_vertex_attrib attrib;
+        attrib.index = index;
+        it = attribs_.insert(it, attrib);
+    }
+    return *it;
+}
+
 bool gl_vertex::check_vao_bind_()
 {
-    int current_bind_vao = 0;
-    lomeglcall(glGetIntegerv, GL_VERTEX_ARRAY_BINDING, &current_bind_vao);
-    return !(current_bind_vao == 0 || current_bind_vao != VAO_.get());
+    return gl_state_cache::get().is_vertex_array_bound(VAO_.get());
 }
 
 bool gl_vertex::check_vbo_bind_()
 {
-    int current_bind_vbo = 0;
-    lomeglcall(glGetIntegerv, GL_ARRAY_BUFFER_BINDING, &current_bind_vbo);
-    return !(current_bind_vbo == 0 || current_bind_vbo != VBO_.get());
+    return gl_state_cache::get().is_buffer_bound(GL_ARRAY_BUFFER, VBO_.get());
 }
 
 } // namespace lomegl
\ No newline at end of file
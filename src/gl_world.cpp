@@ -1,10 +1,14 @@
 #include "lomegl/gl_world.h"
 #include "lomegl/gl_object.h"
+#include "lomegl/gl_occlusion.h"
 #include "lomegl/gl_shader.h"
 #include "lomegl/gl_texture.h"
 #include "lomegl/gl_vertex.h"
 
-#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
 
 namespace lomegl {
 
@@ -16,31 +20,50 @@ gl_world::~gl_world()
         get_current_world_() = nullptr;
 }
 
-gl_world& gl_world::set_current_camera(const char* obj_name)
+gl_world& gl_world::set_current_camera(gl_name obj_name)
 {
     assert(exists<gl_object>(obj_name));
-    current_camera_ = obj_name;
+    current_camera_ = get_handle<gl_object>(obj_name);
+    return *this;
+}
+
+gl_world& gl_world::set_current_camera(gl_handle<gl_object> obj)
+{
+    assert(exists(obj));
+    current_camera_ = obj;
     return *this;
 }
 
 [[nodiscard]] gl_shader& gl_world::get_current_shader()
 {
-    assert(!current_shader_.empty());
-    return get<gl_shader>(current_shader_.c_str());
+    assert(current_shader_);
+    return get(current_shader_);
 }
 
 [[nodiscard]] gl_object& gl_world::get_current_camera()
 {
-    assert(!current_camera_.empty());
-    return get<gl_object>(current_camera_.c_str());
+    assert(current_camera_);
+    return get(current_camera_);
 }
 
 [[nodiscard]] std::string gl_world::get_current_shader_name() noexcept
 {
-    return current_shader_;
+    auto* shader = shader_.slots.get(current_shader_.value());
+    return shader == nullptr ? std::string() : shader->get_id();
 }
 
 [[nodiscard]] std::string gl_world::get_current_camera_name() noexcept
+{
+    auto* camera = object_.slots.get(current_camera_.value());
+    return camera == nullptr ? std::string() : camera->get_id();
+}
+
+[[nodiscard]] gl_handle<gl_shader> gl_world::get_current_shader_handle() const noexcept
+{
+    return current_shader_;
+}
+
+[[nodiscard]] gl_handle<gl_object> gl_world::get_current_camera_handle() const noexcept
 {
     return current_camera_;
 }
@@ -70,25 +93,360 @@ int gl_world::get_screen_height() const noexcept
 
 gl_world& gl_world::set_current_shader_view_mat()
 {
-    assert(!current_shader_.empty() && !current_camera_.empty());
-    get<gl_shader>(current_shader_.c_str()).uniform(glUniformMatrix4fv, gl_shader::view_name, 1, GL_FALSE, glm::value_ptr(get<gl_object>(current_camera_.c_str()).get_view_mat()));
+    assert(current_shader_ && current_camera_);
+    view_mat_ = get_current_camera().get_view_mat();
+    has_view_mat_ = true;
+    frustum_ = gl_frustum(projection_mat_ * view_mat_);
+    auto& shader = get_current_shader();
+    shader.set_uniform(shader.get_view_slot(), view_mat_);
     return *this;
 }
 
 gl_world& gl_world::set_current_shader_projection_mat(float fov, float near, float far)
 {
-    assert(!current_shader_.empty());
-    glm::mat4 projection = glm::perspective(fov, static_cast<float>(screen_size_.first) / static_cast<float>(screen_size_.second), near, far);
-    get<gl_shader>(current_shader_.c_str()).uniform(glUniformMatrix4fv, gl_shader::projection_name, 1, GL_FALSE, glm::value_ptr(projection));
+    assert(current_shader_);
+    projection_mat_ = glm::perspective(fov, static_cast<float>(screen_size_.first) / static_cast<float>(screen_size_.second), near, far);
+    has_projection_mat_ = true;
+    frustum_ = gl_frustum(projection_mat_ * view_mat_);
+    auto& shader = get_current_shader();
+    shader.set_uniform(shader.get_projection_slot(), projection_mat_);
+    return *this;
+}
+
+[[nodiscard]] const glm::mat4& gl_world::get_view_mat() const noexcept
+{
+    return view_mat_;
+}
+
+[[nodiscard]] const glm::mat4& gl_world::get_projection_mat() const noexcept
+{
+    return projection_mat_;
+}
+
+[[nodiscard]] bool gl_world::has_frustum() const noexcept
+{
+    return has_view_mat_ && has_projection_mat_;
+}
+
+[[nodiscard]] const gl_frustum& gl_world::get_frustum() const noexcept
+{
+    return frustum_;
+}
+
+gl_world& gl_world::set_frustum_culling_enabled(bool enable) noexcept
+{
+    frustum_culling_enabled_ = enable;
+    return *this;
+}
+
+[[nodiscard]] bool gl_world::is_frustum_culling_enabled() const noexcept
+{
+    return frustum_culling_enabled_;
+}
+
+[[nodiscard]] bool gl_world::is_visible(gl_entity& entity)
+{
+    if (!frustum_culling_enabled_ || !has_frustum())
+        return true;
+
+    auto sphere = entity.get_world_sphere();
+    if (sphere.empty())
+        return true;
+    if (!frustum_.intersects(sphere))
+        return false;
+    return occlusion_culler_ == nullptr || occlusion_culler_->is_visible(entity.get_world_aabb());
+}
+
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+gl_world& gl_world::set_occlusion_culling_enabled(bool enable, int width, int height)
+{
+    if (!enable)
+        occlusion_culler_.reset();
+    else if (occlusion_culler_ == nullptr || occlusion_culler_->width() < width || occlusion_culler_->height() < height)
+        occlusion_culler_ = std::make_unique<gl_occlusion_culler>(width, height);
+    return *this;
+}
+
+[[nodiscard]] gl_occlusion_culler* gl_world::get_occlusion_culler() noexcept
+{
+    return occlusion_culler_.get();
+}
+
+gl_world& gl_world::add_occluder(gl_handle<gl_object> entity, std::shared_ptr<const gl_occluder_mesh> mesh)
+{
+    assert(exists(entity) && mesh != nullptr);
+    remove_occluder(entity);
+    occluders_.emplace_back(entity, std::move(mesh));
     return *this;
 }
 
-gl_world& gl_world::use_shader(const char* shader_name)
+gl_world& gl_world::remove_occluder(gl_handle<gl_object> entity)
+{
+    std::erase_if(occluders_, [&](const auto& item) { return item.first == entity; });
+    return *this;
+}
+
+gl_world& gl_world::update_occlusion()
+{
+    if (occlusion_culler_ == nullptr || !has_frustum())
+        return *this;
+
+    std::erase_if(occluders_, [this](const auto& item) { return !exists(item.first); });
+    occlusion_culler_->begin_frame(projection_mat_ * view_mat_);
+    for (const auto& [handle, mesh] : occluders_)
+    {
+        auto& object = get(handle);
+        auto* entity = dynamic_cast<gl_entity*>(&object);
+        if (entity != nullptr && !entity->get_bounds().empty() && !frustum_.intersects(entity->get_world_sphere()))
+            continue;
+        occlusion_culler_->add_occluder(*mesh, object.get_model_mat());
+    }
+    occlusion_culler_->rasterize();
+    return *this;
+}
+
+gl_world& gl_world::use_shader(gl_name shader_name)
 {
     assert(exists<gl_shader>(shader_name));
-    current_shader_ = shader_name;
-    get<gl_shader>(current_shader_.c_str()).use();
+    return use_shader(get_handle<gl_shader>(shader_name));
+}
+
+gl_world& gl_world::use_shader(gl_handle<gl_shader> shader)
+{
+    assert(exists(shader));
+    current_shader_ = shader;
+    get(current_shader_).use();
     return *this;
 }
 
+gl_world& gl_world::set_transform_store_enabled(bool enable) noexcept
+{
+    transform_store_enabled_ = enable;
+    return *this;
+}
+
+gl_world& gl_world::update_all_transforms()
+{
+    transforms_.update_all();
+    return *this;
+}
+
+[[nodiscard]] gl_transform_store& gl_world::get_transform_store() noexcept
+{
+    return transforms_;
+}
+
+gl_world& gl_world::rebuild_spatial_index()
+{
+    std::vector<std::uint32_t> static_ids;
+    std::vector<gl_aabb> static_boxes;
+    std::vector<std::uint32_t> dynamic_ids;
+    std::vector<gl_aabb> dynamic_boxes;
+
+    object_.slots.for_each([&](std::uint32_t handle_value, gl_object& object) {
+        auto* entity = dynamic_cast<gl_entity*>(&object);
+        if (entity == nullptr || entity->get_bounds().empty())
+            return;
+
+        auto box = entity->get_world_aabb();
+        if (entity->is_static())
+        {
+            static_ids.push_back(handle_value);
+            static_boxes.push_back(box);
+        } else {
+            dynamic_ids.push_back(handle_value);
+            dynamic_boxes.push_back(box);
+        }
+    });
+
+    static_tree_.build(std::move(static_ids), std::move(static_boxes));
+    dynamic_tree_.build(std::move(dynamic_ids), std::move(dynamic_boxes));
+    spatial_index_dirty_ = false;
+    return *this;
+}
+
+gl_world& gl_world::update_spatial_index()
+{
+    if (spatial_index_dirty_)
+        return rebuild_spatial_index();
+
+    dynamic_tree_.refit([this](std::uint32_t handle_value) {
+        return static_cast<gl_entity*>(object_.slots.get(handle_value))->get_world_aabb(); // NOLINT(cppcoreguidelines-pro-type-static-cast-downcast)
+    });
+    return *this;
+}
+
+[[nodiscard]] std::vector<gl_handle<gl_object>> gl_world::query_objects(const gl_frustum& frustum)
+{
+    ensure_spatial_index_();
+    std::vector<gl_handle<gl_object>> result;
+    auto add = [&](std::uint32_t handle_value) { result.push_back(gl_handle<gl_object>::from_value(handle_value)); };
+    static_tree_.query(frustum, add);
+    dynamic_tree_.query(frustum, add);
+    return result;
+}
+
+[[nodiscard]] std::vector<gl_handle<gl_object>> gl_world::query_objects(const gl_aabb& box)
+{
+    ensure_spatial_index_();
+    std::vector<gl_handle<gl_object>> result;
+    auto add = [&](std::uint32_t handle_value) { result.push_back(gl_handle<gl_object>::from_value(handle_value)); };
+    static_tree_.query(box, add);
+    dynamic_tree_.query(box, add);
+    return result;
+}
+
+[[nodiscard]] std::optional<gl_ray_hit> gl_world::raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance)
+{
+    ensure_spatial_index_();
+    auto unit_direction = glm::normalize(direction);
+    auto static_hit = static_tree_.raycast(origin, unit_direction, max_distance);
+    auto dynamic_hit = dynamic_tree_.raycast(origin, unit_direction, static_hit.first == gl_bvh::npos ? max_distance : static_hit.second);
+    const auto& hit = dynamic_hit.first != gl_bvh::npos ? dynamic_hit : static_hit;
+    if (hit.first == gl_bvh::npos)
+        return std::nullopt;
+    return gl_ray_hit { gl_handle<gl_object>::from_value(hit.first), hit.second };
+}
+
+[[nodiscard]] std::optional<gl_ray_hit> gl_world::pick(float screen_x, float screen_y)
+{
+    auto ndc_x = 2.0F * screen_x / static_cast<float>(screen_size_.first) - 1.0F;
+    auto ndc_y = 1.0F - 2.0F * screen_y / static_cast<float>(screen_size_.second);
+    auto inverse = glm::inverse(projection_mat_ * view_mat_);
+
+    auto near = inverse * glm::vec4(ndc_x, ndc_y, -1.0F, 1.0F);
+    auto far = inverse * glm::vec4(ndc_x, ndc_y, 1.0F, 1.0F);
+    auto origin = glm::vec3(near) / near.w;
+    auto direction = glm::vec3(far) / far.w - origin;
+    return raycast(origin, direction, glm::length(direction));
+}
+
+gl_world& gl_world::set_memory_budget(std::size_t bytes, std::string spill_directory)
+{
+    memory_budget_ = bytes;
+    spill_directory_ = std::move(spill_directory);
+    return *this;
+}
+
+[[nodiscard]] std::size_t gl_world::get_memory_budget() const noexcept
+{
+    return memory_budget_;
+}
+
+[[nodiscard]] std::size_t gl_world::get_resident_memory() const
+{
+    std::size_t size = 0;
+    texture_.slots.for_each([&size](std::uint32_t /*handle_value*/, gl_texture& texture) {
+        if (texture.is_resident())
+            size += texture.get_memory_size();
+    });
+    vertex_.slots.for_each([&size](std::uint32_t /*handle_value*/, gl_vertex& vertex) {
+        if (vertex.is_resident())
+            size += vertex.get_memory_size();
+    });
+    return size;
+}
+
+gl_world& gl_world::trim_memory()
+{
+    struct candidate
+    {
+        std::uint64_t last_used_frame;
+        std::size_t size;
+        std::uint32_t handle_value;
+        gl_texture* texture;
+        gl_vertex* vertex;
+    };
+
+    if (memory_budget_ != 0)
+    {
+        std::vector<candidate> candidates;
+        std::size_t resident = 0;
+        texture_.slots.for_each([&](std::uint32_t handle_value, gl_texture& texture) {
+            if (!texture.is_resident())
+                return;
+            resident += texture.get_memory_size();
+            if (texture.get_last_used_frame() != frame_ && !texture.is_pinned() && texture.get_texture_type() == GL_TEXTURE_2D
+                && !texture.has_immutable_storage())
+                candidates.push_back({ texture.get_last_used_frame(), texture.get_memory_size(), handle_value, &texture, nullptr });
+        });
+        vertex_.slots.for_each([&](std::uint32_t handle_value, gl_vertex& vertex) {
+            if (!vertex.is_resident())
+                return;
+            resident += vertex.get_memory_size();
+            if (vertex.get_last_used_frame() != frame_ && !vertex.is_pinned())
+                candidates.push_back({ vertex.get_last_used_frame(), vertex.get_memory_size(), handle_value, nullptr, &vertex });
+        });
+
+        if (resident > memory_budget_)
+        {
+            std::ranges::sort(candidates, {}, &candidate::last_used_frame);
+            for (const auto& item : candidates)
+            {
+                if (resident <= memory_budget_)
+                    break;
+                // The handle value(with its generation) is unique among the resources of a kind in this world
+                std::string spill_path;
+                if (!spill_directory_.empty())
+                {
+                    auto file_name = "lomegl_" + std::to_string(serial_) + (item.texture != nullptr ? "_texture_" : "_vertex_")
+                        + std::to_string(item.handle_value) + ".bin";
+                    spill_path = (std::filesystem::path(spill_directory_) / file_name).string();
+                }
+                if (item.texture != nullptr)
+                    item.texture->evict(spill_path);
+                else
+                    item.vertex->evict(spill_path);
+                resident -= item.size;
+            }
+        }
+    }
+
+    return next_frame();
+}
+
+gl_world& gl_world::next_frame() noexcept
+{
+    ++frame_;
+    return *this;
+}
+
+[[nodiscard]] std::uint64_t gl_world::get_frame() const noexcept
+{
+    return frame_;
+}
+
+gl_world& gl_world::use_resource(gl_texture& texture)
+{
+    texture.set_last_used_frame(frame_).make_resident();
+    return *this;
+}
+
+gl_world& gl_world::use_resource(gl_vertex& vertex)
+{
+    vertex.set_last_used_frame(frame_).make_resident();
+    return *this;
+}
+
+[[nodiscard]] gl_deletion_queue& gl_world::get_deletion_queue() noexcept
+{
+    return deletion_queue_;
+}
+
+[[nodiscard]] gl_state_cache& gl_world::get_state_cache() noexcept
+{
+    return state_cache_;
+}
+
+[[nodiscard]] gl_debug_output& gl_world::get_debug_output() noexcept
+{
+    return debug_output_;
+}
+
+void gl_world::ensure_spatial_index_()
+{
+    if (spatial_index_dirty_)
+        rebuild_spatial_index();
+}
+
 } // namespace lomegl
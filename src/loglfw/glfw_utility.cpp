@@ -1,12 +1,13 @@
 #include "lomegl/loglfw/glfw_utility.h"
+#include "lomegl/gl_exception.h"
 #include "lomegl/gl_object.h"
 #include "lomegl/gl_world.h"
 
 #include <stdexcept>
 
 namespace lomegl {
-float glfw_utility::delta_time = 0;      // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
-float glfw_utility::last_frame_time = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+thread_local float glfw_utility::delta_time = 0;      // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+thread_local float glfw_utility::last_frame_time = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
 
 void glfw_utility::on_window_size_change(GLFWwindow* /*window*/, int width, int height)
 {
@@ -14,9 +15,14 @@ void glfw_utility::on_window_size_change(GLFWwindow* /*window*/, int width, int
 }
 
 void glfw_utility::process_input(GLFWwindow* window)
+{
+    process_input(window, *gl_world::get_current_world());
+}
+
+void glfw_utility::process_input(GLFWwindow* window, gl_world& world)
 {
     float camera_speed = 5.0F * delta_time;
-    auto&& my_camera = lomegl::gl_world::get_current_world()->get_current_camera();
+    auto&& my_camera = world.get_current_camera();
     // if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
     //     glfwSetWindowShouldClose(window, 1);
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
@@ -29,11 +35,14 @@ void glfw_utility::process_input(GLFWwindow* window)
         my_camera.add_pos_x_local(-camera_speed);
 }
 
-GLFWwindow* glfw_utility::init(std::string_view title_name, int width, int height, GLFWmonitor* monitor, GLFWwindow* share, int major_version, int minor_version)
+// NOLINTNEXTLINE(bugprone-easily-swappable-parameters)
+GLFWwindow* glfw_utility::init(std::string_view title_name, int width, int height, GLFWmonitor* monitor, GLFWwindow* share, int major_version, int minor_version,
+    bool no_error)
 {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major_version);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor_version);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_CONTEXT_NO_ERROR, no_error ? GL_TRUE : GL_FALSE);
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
@@ -47,6 +56,9 @@ GLFWwindow* glfw_utility::init(std::string_view title_name, int width, int heigh
     if (gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)) == 0)
         throw std::runtime_error("Failed to initialize GLAD");
 
+    // glGetError of a no error context tells nothing
+    if (no_error)
+        set_gl_error_policy(gl_error_policy::off);
     return window;
 }
 
@@ -57,11 +69,16 @@ void glfw_utility::calulate_frame_time()
     last_frame_time = currentFrame;
 }
 
-void glfw_utility::mouse_callback(GLFWwindow* /*window*/, double xpos, double ypos)
+void glfw_utility::mouse_callback(GLFWwindow* window, double xpos, double ypos)
+{
+    mouse_callback(window, *gl_world::get_current_world(), xpos, ypos);
+}
+
+void glfw_utility::mouse_callback(GLFWwindow* /*window*/, gl_world& world, double xpos, double ypos)
 {
-    static float lastX = 400;
-    static float lastY = 300;
-    static bool firstMouse = true;
+    thread_local float lastX = 400;
+    thread_local float lastY = 300;
+    thread_local bool firstMouse = true;
 
     if (firstMouse) // 这个bool变量初始时是设定为true的
     {
@@ -79,6 +96,6 @@ void glfw_utility::mouse_callback(GLFWwindow* /*window*/, double xpos, double yp
     xoffset *= sensitivity;
     yoffset *= sensitivity;
 
-    lomegl::gl_world::get_current_world()->get_current_camera().add_angle_local(0, glm::radians(xoffset), glm::radians(yoffset));
+    world.get_current_camera().add_angle_local(0, glm::radians(xoffset), glm::radians(yoffset));
 }
 } // namespace lomegl